@@ -0,0 +1,10 @@
+{
+  "targets": [
+    {
+      "target_name": "tunneling",
+      "sources": ["tunneling_addon.c", "tunneling.c"],
+      "cflags_c": ["-O2", "-std=c11"],
+      "libraries": ["-lm", "-pthread"]
+    }
+  ]
+}
@@ -0,0 +1,182 @@
+/**
+ * rolling_stats: EWMA, Welford and P-square estimators; see rolling_stats.h for the API.
+ */
+#include "rolling_stats.h"
+
+#include <math.h>
+#include <stddef.h>
+
+#define RS_DEFAULT_ALPHA 0.05
+#define RS_DEFAULT_SIGMAS 4.0
+#define RS_DEFAULT_WARMUP 32
+
+void rs_ewma_init(rs_ewma *e, double alpha) {
+    e->alpha = alpha > 0.0 && alpha <= 1.0 ? alpha : RS_DEFAULT_ALPHA;
+    e->mean = 0.0;
+    e->variance = 0.0;
+    e->primed = 0;
+}
+
+/* Finch's incremental form (2009): the variance update uses the deviation from the mean
+ * before it moves, scaled by how far it moves, so it stays non-negative. */
+void rs_ewma_push(rs_ewma *e, double x) {
+    if (!e->primed) {
+        e->mean = x;
+        e->variance = 0.0;
+        e->primed = 1;
+        return;
+    }
+    double diff = x - e->mean;
+    double step = e->alpha * diff;
+    e->mean += step;
+    e->variance = (1.0 - e->alpha) * (e->variance + diff * step);
+}
+
+double rs_ewma_mean(const rs_ewma *e) {
+    return e->mean;
+}
+
+double rs_ewma_stddev(const rs_ewma *e) {
+    return sqrt(e->variance);
+}
+
+void rs_welford_init(rs_welford *w) {
+    w->n = 0;
+    w->mean = 0.0;
+    w->m2 = 0.0;
+}
+
+void rs_welford_push(rs_welford *w, double x) {
+    w->n++;
+    double delta = x - w->mean;
+    w->mean += delta / (double)w->n;
+    w->m2 += delta * (x - w->mean);
+}
+
+double rs_welford_variance(const rs_welford *w) {
+    return w->n > 1 ? w->m2 / (double)(w->n - 1) : 0.0;
+}
+
+void rs_p2_init(rs_p2 *q, double p) {
+    q->p = p > 0.0 && p < 1.0 ? p : 0.5;
+    q->count = 0;
+    for (int i = 0; i < 5; i++) {
+        q->height[i] = 0.0;
+        q->position[i] = i + 1;
+    }
+    q->desired[0] = 1.0;
+    q->desired[1] = 1.0 + 2.0 * q->p;
+    q->desired[2] = 1.0 + 4.0 * q->p;
+    q->desired[3] = 3.0 + 2.0 * q->p;
+    q->desired[4] = 5.0;
+    q->increment[0] = 0.0;
+    q->increment[1] = q->p / 2.0;
+    q->increment[2] = q->p;
+    q->increment[3] = (1.0 + q->p) / 2.0;
+    q->increment[4] = 1.0;
+}
+
+static double parabolic(const rs_p2 *q, int i, double d) {
+    const double *h = q->height, *n = q->position;
+    return h[i] + d / (n[i + 1] - n[i - 1]) *
+           ((n[i] - n[i - 1] + d) * (h[i + 1] - h[i]) / (n[i + 1] - n[i]) +
+            (n[i + 1] - n[i] - d) * (h[i] - h[i - 1]) / (n[i] - n[i - 1]));
+}
+
+static double linear(const rs_p2 *q, int i, int d) {
+    return q->height[i] + d * (q->height[i + d] - q->height[i]) /
+           (q->position[i + d] - q->position[i]);
+}
+
+void rs_p2_push(rs_p2 *q, double x) {
+    /* The first five samples are kept sorted and become the markers */
+    if (q->count < 5) {
+        int i = (int)q->count++;
+        while (i > 0 && q->height[i - 1] > x) {
+            q->height[i] = q->height[i - 1];
+            i--;
+        }
+        q->height[i] = x;
+        return;
+    }
+    q->count++;
+
+    /* The cell x falls in, widening the extremes if it lies outside them */
+    int k;
+    if (x < q->height[0]) {
+        q->height[0] = x;
+        k = 0;
+    } else if (x >= q->height[4]) {
+        q->height[4] = x;
+        k = 3;
+    } else {
+        k = 0;
+        while (k < 3 && x >= q->height[k + 1]) k++;
+    }
+    for (int i = k + 1; i < 5; i++) q->position[i] += 1.0;
+    for (int i = 0; i < 5; i++) q->desired[i] += q->increment[i];
+
+    /* Nudge the three middle markers toward their desired positions */
+    for (int i = 1; i <= 3; i++) {
+        double off = q->desired[i] - q->position[i];
+        if ((off >= 1.0 && q->position[i + 1] - q->position[i] > 1.0) ||
+            (off <= -1.0 && q->position[i - 1] - q->position[i] < -1.0)) {
+            int d = off > 0.0 ? 1 : -1;
+            double h = parabolic(q, i, d);
+            if (!(q->height[i - 1] < h && h < q->height[i + 1])) h = linear(q, i, d);
+            q->height[i] = h;
+            q->position[i] += d;
+        }
+    }
+}
+
+double rs_p2_estimate(const rs_p2 *q) {
+    if (q->count == 0) return 0.0;
+    if (q->count < 5) {
+        /* Nearest rank among the samples so far */
+        size_t rank = (size_t)(q->p * (double)(q->count - 1) + 0.5);
+        return q->height[rank];
+    }
+    return q->height[2];
+}
+
+void rs_channel_init(rs_channel *c, const rs_channel_config *config) {
+    rs_channel_config defaults = { 0 };
+    if (!config) config = &defaults;
+    rs_ewma_init(&c->ewma, config->alpha > 0.0 ? config->alpha : RS_DEFAULT_ALPHA);
+    rs_welford_init(&c->all);
+    rs_p2_init(&c->median, 0.5);
+    rs_p2_init(&c->p99, 0.99);
+    c->sigmas = config->sigmas > 0.0 ? config->sigmas : RS_DEFAULT_SIGMAS;
+    c->warmup = config->warmup ? config->warmup : RS_DEFAULT_WARMUP;
+    c->anomalies = 0;
+    c->last = 0.0;
+}
+
+double rs_channel_zscore(const rs_channel *c, double x) {
+    double sd = rs_ewma_stddev(&c->ewma);
+    return sd > 0.0 ? (x - rs_ewma_mean(&c->ewma)) / sd : 0.0;
+}
+
+int rs_channel_push(rs_channel *c, double x) {
+    int verdict = RS_NORMAL;
+    double tracked = x;
+    if (c->all.n >= c->warmup) {
+        double z = rs_channel_zscore(c, x);
+        double limit = c->sigmas * rs_ewma_stddev(&c->ewma);
+        if (z > c->sigmas) {
+            verdict = RS_HIGH;
+            tracked = rs_ewma_mean(&c->ewma) + limit;
+        } else if (z < -c->sigmas) {
+            verdict = RS_LOW;
+            tracked = rs_ewma_mean(&c->ewma) - limit;
+        }
+    }
+    if (verdict != RS_NORMAL) c->anomalies++;
+    rs_ewma_push(&c->ewma, tracked);
+    rs_welford_push(&c->all, x);
+    rs_p2_push(&c->median, x);
+    rs_p2_push(&c->p99, x);
+    c->last = x;
+    return verdict;
+}
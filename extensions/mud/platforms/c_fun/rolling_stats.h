@@ -0,0 +1,100 @@
+/**
+ * rolling_stats: constant-memory streaming statistics and an anomaly trigger for one signal.
+ *
+ *   rs_channel temperature;
+ *   rs_channel_init(&temperature, NULL);             defaults: alpha 0.05, 4 sigma, 32 warm-up
+ *   int alarm = rs_channel_push(&temperature, 24.6); RS_NORMAL, RS_HIGH or RS_LOW
+ *   rs_ewma_mean(&temperature.ewma), rs_p2_estimate(&temperature.p99), ...
+ *
+ * Every update is O(1) and nothing is stored per sample, so a zone's statistics are the same
+ * size after a second or a year:
+ *   rs_ewma     exponentially weighted mean and variance; the recent level and wobble.
+ *   rs_welford  count, mean and variance of everything since init, numerically stable.
+ *   rs_p2       the P-square estimator (Jain and Chlamtac, 1985): one quantile from five
+ *               markers whose heights are adjusted by piecewise-parabolic interpolation.
+ *
+ * rs_channel_push scores a sample against the EWMA level and spread from before it arrived,
+ * then folds it in. A sample more than `sigmas` EWMA deviations away is an anomaly. Nothing
+ * is flagged during warm-up, or while the spread is still zero. An anomaly reaches the EWMA
+ * clipped to the threshold (the other estimators see it as it was), so one spike cannot
+ * widen the spread enough to hide the next, while a lasting shift in level is still followed
+ * and stops alarming once the EWMA has caught up.
+ *
+ * None of these lock; give each thread its own, as zone ticks do.
+ */
+#ifndef ROLLING_STATS_H
+#define ROLLING_STATS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RS_NORMAL 0
+#define RS_HIGH 1
+#define RS_LOW -1
+
+typedef struct {
+    double alpha;               /* weight of the newest sample, in (0, 1] */
+    double mean;
+    double variance;
+    int primed;                 /* the first sample sets the mean outright */
+} rs_ewma;
+
+typedef struct {
+    uint64_t n;
+    double mean;
+    double m2;                  /* sum of squared deviations from the mean */
+} rs_welford;
+
+typedef struct {
+    double p;                   /* the quantile tracked, in (0, 1) */
+    uint64_t count;
+    double height[5];           /* marker heights; the first five samples until count == 5 */
+    double position[5];         /* actual marker positions, 1-based ranks */
+    double desired[5];
+    double increment[5];
+} rs_p2;
+
+typedef struct {
+    double alpha;               /* EWMA weight; 0 for 0.05 */
+    double sigmas;              /* anomaly threshold; 0 for 4 */
+    uint64_t warmup;            /* samples before anything is flagged; 0 for 32 */
+} rs_channel_config;
+
+typedef struct {
+    rs_ewma ewma;
+    rs_welford all;
+    rs_p2 median;
+    rs_p2 p99;
+    double sigmas;
+    uint64_t warmup;
+    uint64_t anomalies;
+    double last;
+} rs_channel;
+
+void rs_ewma_init(rs_ewma *e, double alpha);
+void rs_ewma_push(rs_ewma *e, double x);
+double rs_ewma_mean(const rs_ewma *e);
+double rs_ewma_stddev(const rs_ewma *e);
+
+void rs_welford_init(rs_welford *w);
+void rs_welford_push(rs_welford *w, double x);
+double rs_welford_variance(const rs_welford *w);    /* sample variance; 0 below two samples */
+
+void rs_p2_init(rs_p2 *q, double p);
+void rs_p2_push(rs_p2 *q, double x);
+double rs_p2_estimate(const rs_p2 *q);              /* exact while fewer than five; 0 if none */
+
+void rs_channel_init(rs_channel *c, const rs_channel_config *config);
+/* Score x against the statistics so far (RS_NORMAL, RS_HIGH or RS_LOW), then add it. */
+int rs_channel_push(rs_channel *c, double x);
+/* How many EWMA deviations x would be from the current level; 0 while the spread is 0. */
+double rs_channel_zscore(const rs_channel *c, double x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
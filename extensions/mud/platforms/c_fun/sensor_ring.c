@@ -0,0 +1,221 @@
+/**
+ * sensor_ring: bounded MPSC sample queue with per-slot sequence numbers; see sensor_ring.h for
+ * the API.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "sensor_ring.h"
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define SR_DEFAULT_CAPACITY 4096
+
+/*
+ * Slot i of lap L (ring position p = L * capacity + i) moves through three sequence values:
+ *   p                  free, for the producer that claims position p
+ *   p + 1              published, for the consumer (or an evicting producer) at head == p
+ *   p + capacity       handed back, free for position p + capacity
+ * A producer whose slot still reads below p has caught up with the consumer: the ring is full.
+ */
+typedef struct {
+    _Atomic uint64_t seq;
+    sr_sample sample;
+} sr_slot;
+
+struct sr_ring {
+    sr_slot *slots;
+    uint64_t capacity;
+    uint64_t mask;
+    sr_policy policy;
+    int single_producer;
+
+    _Alignas(64) _Atomic uint64_t tail;     /* next position to claim; also samples pushed */
+    _Atomic uint64_t rejected;
+    _Atomic uint64_t dropped;
+
+    _Alignas(64) _Atomic uint64_t head;     /* oldest unconsumed position */
+    _Atomic uint64_t popped;                /* written by the consumer only */
+    _Atomic uint64_t high_water;
+};
+
+/* Someone else owns the slot for a moment: a producer between claim and publish, or the
+ * consumer copying a batch out */
+static void wait_briefly(unsigned *spins) {
+    if (++*spins % 64 == 0) sched_yield();
+}
+
+uint64_t sr_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+sr_ring *sr_create(const sr_config *config) {
+    if (!config || config->policy < SR_BACKPRESSURE || config->policy > SR_DROP_OLDEST) {
+        return NULL;
+    }
+    uint64_t capacity = config->capacity ? config->capacity : SR_DEFAULT_CAPACITY;
+    if (capacity < 2) capacity = 2;
+    if (capacity > (1ull << 40)) return NULL;
+    uint64_t rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+
+    sr_ring *r = aligned_alloc(64, sizeof(sr_ring));
+    if (!r) return NULL;
+    r->slots = malloc(rounded * sizeof(sr_slot));
+    if (!r->slots) {
+        free(r);
+        return NULL;
+    }
+    r->capacity = rounded;
+    r->mask = rounded - 1;
+    r->policy = config->policy;
+    r->single_producer = config->single_producer;
+    for (uint64_t i = 0; i < rounded; i++) atomic_init(&r->slots[i].seq, i);
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->rejected, 0);
+    atomic_init(&r->dropped, 0);
+    atomic_init(&r->head, 0);
+    atomic_init(&r->popped, 0);
+    atomic_init(&r->high_water, 0);
+    return r;
+}
+
+void sr_destroy(sr_ring *r) {
+    if (!r) return;
+    free(r->slots);
+    free(r);
+}
+
+/* Discard the sample at `head` to make room. Returns 0 if it has not been published yet or
+ * someone else took it first; the caller re-reads and tries again. */
+static int evict_oldest(sr_ring *r, uint64_t head) {
+    sr_slot *slot = &r->slots[head & r->mask];
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != head + 1) return 0;
+    if (!atomic_compare_exchange_strong_explicit(&r->head, &head, head + 1,
+                                                 memory_order_acq_rel, memory_order_relaxed)) {
+        return 0;
+    }
+    atomic_store_explicit(&slot->seq, head + r->capacity, memory_order_release);
+    atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+    return 1;
+}
+
+int sr_push(sr_ring *r, const sr_sample *sample) {
+    if (!r || !sample) return SR_EINVAL;
+    unsigned spins = 0;
+    uint64_t pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    sr_slot *slot;
+    for (;;) {
+        slot = &r->slots[pos & r->mask];
+        uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        int64_t lag = (int64_t)(seq - pos);
+        if (lag == 0) {
+            if (r->single_producer) {
+                atomic_store_explicit(&r->tail, pos + 1, memory_order_relaxed);
+                break;
+            }
+            if (atomic_compare_exchange_weak_explicit(&r->tail, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+            continue;
+        }
+        if (lag > 0) {
+            /* Another producer claimed pos; move on to the current tail */
+            pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+            continue;
+        }
+
+        /* The slot still holds the sample from one lap ago */
+        /* Signed: other producers and the consumer may have moved past pos since its slot
+         * was read, and then pos is merely stale rather than a lap ahead */
+        uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+        int64_t ahead = (int64_t)(pos - head);
+        if (ahead < 0) {
+            pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+            continue;
+        }
+        if (ahead >= (int64_t)r->capacity) {
+            if (r->policy == SR_BACKPRESSURE) {
+                atomic_fetch_add_explicit(&r->rejected, 1, memory_order_relaxed);
+                return SR_EFULL;
+            }
+            if (!evict_oldest(r, head)) wait_briefly(&spins);
+        } else {
+            wait_briefly(&spins);       /* the consumer is copying it out right now */
+        }
+        pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    }
+    slot->sample = *sample;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return SR_OK;
+}
+
+size_t sr_pop_batch(sr_ring *r, sr_sample *out, size_t max) {
+    if (!r || !out || max == 0) return 0;
+    for (;;) {
+        uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+        uint64_t waiting = atomic_load_explicit(&r->tail, memory_order_relaxed) - head;
+        if (waiting > r->capacity) waiting = r->capacity;
+        if (waiting > atomic_load_explicit(&r->high_water, memory_order_relaxed)) {
+            atomic_store_explicit(&r->high_water, waiting, memory_order_relaxed);
+        }
+
+        /* The run of published slots from head, up to max */
+        size_t n = 0;
+        while (n < max && n < r->capacity &&
+               atomic_load_explicit(&r->slots[(head + n) & r->mask].seq,
+                                    memory_order_acquire) == head + n + 1) {
+            n++;
+        }
+        if (n == 0) return 0;
+
+        /* Only evicting producers race us for head */
+        if (r->policy == SR_DROP_OLDEST) {
+            if (!atomic_compare_exchange_strong_explicit(&r->head, &head, head + n,
+                                                         memory_order_acq_rel,
+                                                         memory_order_relaxed)) {
+                continue;
+            }
+        } else {
+            atomic_store_explicit(&r->head, head + n, memory_order_release);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            sr_slot *slot = &r->slots[(head + i) & r->mask];
+            out[i] = slot->sample;
+            atomic_store_explicit(&slot->seq, head + i + r->capacity, memory_order_release);
+        }
+        atomic_store_explicit(&r->popped,
+                              atomic_load_explicit(&r->popped, memory_order_relaxed) + n,
+                              memory_order_relaxed);
+        return n;
+    }
+}
+
+size_t sr_size(const sr_ring *r) {
+    if (!r) return 0;
+    sr_ring *m = (sr_ring *)r;
+    uint64_t head = atomic_load_explicit(&m->head, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&m->tail, memory_order_acquire);
+    uint64_t n = tail - head;
+    return (size_t)(n > r->capacity ? r->capacity : n);
+}
+
+size_t sr_capacity(const sr_ring *r) {
+    return r ? (size_t)r->capacity : 0;
+}
+
+void sr_stats_get(const sr_ring *r, sr_stats *stats) {
+    if (!r || !stats) return;
+    sr_ring *m = (sr_ring *)r;
+    stats->pushed = atomic_load_explicit(&m->tail, memory_order_relaxed);
+    stats->popped = atomic_load_explicit(&m->popped, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&m->dropped, memory_order_relaxed);
+    stats->rejected = atomic_load_explicit(&m->rejected, memory_order_relaxed);
+    stats->high_water = atomic_load_explicit(&m->high_water, memory_order_relaxed);
+}
@@ -0,0 +1,95 @@
+/**
+ * sensor_ring: a bounded lock-free queue of timestamped sensor samples, many producers to one
+ * consumer.
+ *
+ *   sr_ring *r = sr_create(&(sr_config){ .capacity = 256, .policy = SR_DROP_OLDEST });
+ *   sr_push(r, &(sr_sample){ sr_now_ns(), zone, SR_TEMPERATURE, 24.6f });   any thread
+ *   size_t n = sr_pop_batch(r, batch, 64);                                   the consumer
+ *   sr_destroy(r);
+ *
+ * Slots carry a sequence number that says which lap of the ring they hold (after Vyukov's
+ * bounded queue), so a producer claims a slot with one compare-and-swap on the tail and
+ * publishes it with one release store; a single-producer ring skips even the CAS. The
+ * consumer claims a whole run of published slots at once, copies them out and hands the
+ * slots back. Nothing blocks and nothing allocates after sr_create.
+ *
+ * When the consumer falls behind, the policy decides. SR_BACKPRESSURE refuses the sample:
+ * sr_push returns SR_EFULL and the producer chooses whether to retry, slow down or give up.
+ * SR_DROP_OLDEST makes room by discarding the oldest published sample, so the ring always
+ * holds the freshest readings. sr_stats counts both.
+ */
+#ifndef SENSOR_RING_H
+#define SENSOR_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SR_OK 0
+#define SR_EINVAL -1
+#define SR_EFULL -2     /* SR_BACKPRESSURE only: the ring is full, nothing was queued */
+
+typedef enum {
+    SR_TEMPERATURE = 0,     /* °C */
+    SR_HUMIDITY,            /* % */
+    SR_PRESSURE,            /* kPa */
+    SR_MAGNETIC_FIELD,      /* mT */
+    SR_RADIATION,           /* mSv */
+    SR_CHANNEL_COUNT
+} sr_channel;
+
+typedef struct {
+    uint64_t t_ns;          /* when it was taken, CLOCK_MONOTONIC */
+    uint32_t zone;
+    uint32_t channel;       /* sr_channel */
+    float value;
+} sr_sample;
+
+typedef enum { SR_BACKPRESSURE = 0, SR_DROP_OLDEST = 1 } sr_policy;
+
+typedef struct {
+    size_t capacity;        /* rounded up to a power of two; 0 for 4096 */
+    sr_policy policy;
+    int single_producer;    /* only one thread ever pushes: skip the tail CAS */
+} sr_config;
+
+typedef struct {
+    uint64_t pushed;        /* samples queued */
+    uint64_t popped;        /* samples the consumer took */
+    uint64_t dropped;       /* SR_DROP_OLDEST: samples discarded to make room */
+    uint64_t rejected;      /* SR_BACKPRESSURE: pushes refused */
+    uint64_t high_water;    /* most samples the consumer has found waiting */
+} sr_stats;
+
+typedef struct sr_ring sr_ring;
+
+/* NULL on a bad config or out of memory. */
+sr_ring *sr_create(const sr_config *config);
+
+void sr_destroy(sr_ring *ring);
+
+/* Queue one sample. SR_OK, SR_EFULL or SR_EINVAL. Any number of threads, unless the ring is
+ * single_producer. */
+int sr_push(sr_ring *ring, const sr_sample *sample);
+
+/* Take up to max samples, oldest first; returns how many. One consumer thread at a time. */
+size_t sr_pop_batch(sr_ring *ring, sr_sample *out, size_t max);
+
+/* Samples waiting; a snapshot that may be stale by the time it returns. */
+size_t sr_size(const sr_ring *ring);
+
+size_t sr_capacity(const sr_ring *ring);
+
+void sr_stats_get(const sr_ring *ring, sr_stats *stats);
+
+/* CLOCK_MONOTONIC in nanoseconds, the clock sample timestamps use. */
+uint64_t sr_now_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
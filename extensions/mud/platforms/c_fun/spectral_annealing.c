@@ -1,15 +1,26 @@
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
 #include <curl/curl.h>
 #include "vtable.h"
+#include "spectral_cache.h"
+#include "spectral_cube.h"
+#include "spectral_fetch.h"
+#include "telemetry.h"
+#include "tempering.h"
 
 // Define method indices
-#define INITIALIZE_ANNEALING_INDEX 0
-#define FETCH_SPECTRAL_DATA_INDEX 1
-#define CALCULATE_ANNEALING_INDEX 2
-#define REPORT_SPECTRAL_STATUS_INDEX 3
+#define initializeAnnealing_INDEX 0
+#define fetchSpectralData_INDEX 1
+#define calculateAnnealing_INDEX 2
+#define reportSpectralStatus_INDEX 3
+#define annealScene_INDEX 4
+#define spectralCost_INDEX 5
+#define proposeReading_INDEX 6
+#define temperReadings_INDEX 7
 
 // Define data structures
 typedef struct {
@@ -36,6 +47,9 @@ typedef struct {
     float annealingProgress;
     bool isActive;
     char* currentState;
+    sc_cache* spectra;       // Shared response cache; NULL to simulate readings only
+    int fetchesPending;
+    bool measured;           // `current` came from a fresh response rather than the simulation
 } AnnealingData;
 
 typedef struct {
@@ -45,84 +59,326 @@ typedef struct {
     char* quantumState;
 } QuantumAnnealingData;
 
+// Define telemetry events; each renders the text its method used to print
+static void render_offline(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is offline. Please activate first.\n", r->v[0].s);
+}
+
+static void render_superposed(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is in quantum superposition of online/offline states.\n", r->v[0].s);
+}
+
+static void render_initialize(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is initializing spectral annealing...\n", r->v[0].s);
+    fprintf(out, "Location: %s\n", r->v[1].s);
+    fprintf(out, "Coordinates: %.6f, %.6f\n", r->v[2].f, r->v[3].f);
+    fprintf(out, "Environmental conditions:\n");
+    fprintf(out, "  Temperature: %.1f°C\n", r->v[4].f);
+    fprintf(out, "  Pressure: %.1f kPa\n", r->v[5].f);
+    fprintf(out, "  Humidity: %.1f%%\n", r->v[6].f);
+}
+
+static void render_fetch(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is fetching spectral data...\n", r->v[0].s);
+    if (r->v[5].i) {
+        fprintf(out, "Querying Planetary Spectrum Generator API...\n");
+        fprintf(out, "Accessing EMIT Imaging Spectrometer data...\n");
+        fprintf(out, "Retrieving Earthdata API information...\n");
+    }
+    fprintf(out, "Current spectral reading:\n");
+    fprintf(out, "  Wavelength: %.1f nm\n", r->v[1].f);
+    fprintf(out, "  Intensity: %.3f\n", r->v[2].f);
+    fprintf(out, "  Noise: %.3f\n", r->v[3].f);
+    fprintf(out, "  Source: %s\n", r->v[4].s);
+}
+
+static void render_calculate(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is calculating spectral annealing...\n", r->v[0].s);
+    fprintf(out, "Target progress: %.1f%%\n", r->v[1].f);
+    fprintf(out, "Current progress: %.1f%%\n", r->v[2].f);
+    fprintf(out, "Spectral difference: %.3f\n", r->v[3].f);
+}
+
+static void render_report(FILE* out, const tm_record* r) {
+    fprintf(out, "\n=== Spectral Annealing Status Report ===\n");
+    fprintf(out, "Name: %s\n", r->v[0].s);
+    fprintf(out, "Status: %s\n", r->v[1].i ? "Active" : "Inactive");
+    fprintf(out, "Location: %s (%.6f, %.6f)\n", r->v[2].s, r->v[3].f, r->v[4].f);
+    fprintf(out, "Current Spectral Data:\n");
+    fprintf(out, "  Wavelength: %.1f nm\n", r->v[5].f);
+    fprintf(out, "  Intensity: %.3f\n", r->v[6].f);
+    fprintf(out, "  Noise: %.3f\n", r->v[7].f);
+    fprintf(out, "  Source: %s\n", r->v[8].s);
+    fprintf(out, "Annealing Progress: %.1f%%\n", r->v[9].f);
+    fprintf(out, "Current State: %s\n", r->v[10].s);
+}
+
+static void render_quantum_initialize(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is initializing quantum spectral annealing...\n", r->v[0].s);
+    fprintf(out, "Quantum coherence: %.2f\n", r->v[1].f);
+    fprintf(out, "Quantum state: %s\n", r->v[2].s);
+}
+
+static void render_quantum_fetch(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is fetching quantum spectral data...\n", r->v[0].s);
+    if (r->v[6].i) {
+        fprintf(out, "Querying quantum-enhanced PSG API...\n");
+        fprintf(out, "Accessing quantum EMIT data...\n");
+        fprintf(out, "Retrieving quantum Earthdata information...\n");
+    }
+    fprintf(out, "Quantum spectral reading:\n");
+    fprintf(out, "  Wavelength: %.1f nm (in superposition)\n", r->v[1].f);
+    fprintf(out, "  Intensity: %.3f (quantum-enhanced)\n", r->v[2].f);
+    fprintf(out, "  Noise: %.3f (quantum-damped)\n", r->v[3].f);
+    fprintf(out, "  Source: %s\n", r->v[4].s);
+    fprintf(out, "Quantum coherence: %.2f\n", r->v[5].f);
+}
+
+static void render_quantum_calculate(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is calculating quantum spectral annealing...\n", r->v[0].s);
+    fprintf(out, "Target progress: %.1f%%\n", r->v[1].f);
+    fprintf(out, "Quantum-adjusted progress: %.1f%%\n", r->v[2].f);
+    fprintf(out, "Quantum spectral difference: %.3f\n", r->v[3].f);
+}
+
+static void render_quantum_report(FILE* out, const tm_record* r) {
+    fprintf(out, "\n=== Quantum Spectral Annealing Status Report ===\n");
+    fprintf(out, "Name: %s\n", r->v[0].s);
+    fprintf(out, "Status: %s (in superposition)\n", r->v[1].i ? "Active" : "Inactive");
+    fprintf(out, "Location: %s (%.6f, %.6f)\n", r->v[2].s, r->v[3].f, r->v[4].f);
+    fprintf(out, "Quantum Spectral Data:\n");
+    fprintf(out, "  Wavelength: %.1f nm (in superposition)\n", r->v[5].f);
+    fprintf(out, "  Intensity: %.3f (quantum-enhanced)\n", r->v[6].f);
+    fprintf(out, "  Noise: %.3f (quantum-damped)\n", r->v[7].f);
+    fprintf(out, "  Source: %s\n", r->v[8].s);
+    fprintf(out, "Quantum Coherence: %.2f\n", r->v[9].f);
+    fprintf(out, "Superposition Count: %d\n", (int)r->v[10].i);
+    fprintf(out, "Quantum State: %s\n", r->v[11].s);
+}
+
+static void render_response(FILE* out, const tm_record* r) {
+    if (r->v[6].s) {
+        fprintf(out, "%s: %s %s (%s)\n", r->v[0].s, r->v[1].s, r->v[2].s, r->v[6].s);
+    } else {
+        fprintf(out, "%s: %s %s, HTTP %d, %lld bytes, %.0f s old\n", r->v[0].s, r->v[1].s,
+                r->v[2].s, (int)r->v[3].i, (long long)r->v[4].i, r->v[5].f);
+    }
+}
+
+static void render_scene(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is annealing against a %lld x %lld x %lld scene...\n",
+            r->v[0].s, (long long)r->v[1].i, (long long)r->v[2].i, (long long)r->v[3].i);
+    fprintf(out, "  Bands %.1f-%.1f nm over %lld tiles\n", r->v[4].f, r->v[5].f, (long long)r->v[6].i);
+    fprintf(out, "  Scene intensity: %.3f (noise %.3f, %lld valid samples)\n",
+            r->v[7].f, r->v[8].f, (long long)r->v[9].i);
+}
+
+static void render_temper(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is tempering %lld replicas on %lld threads...\n",
+            r->v[0].s, (long long)r->v[1].i, (long long)r->v[2].i);
+    fprintf(out, "  %lld rounds, %.2f M moves/s, %.0f%% of exchanges accepted, %lld stolen\n",
+            (long long)r->v[3].i, r->v[4].f / 1e6, r->v[5].f * 100.0, (long long)r->v[6].i);
+    fprintf(out, "  Cost %.4f -> %.4f in %.3f s (%.3f per second)\n",
+            r->v[7].f, r->v[8].f, r->v[9].f, r->v[10].f);
+    if (r->v[11].f >= 0.0) {
+        fprintf(out, "  Converged to the target in %.3f s\n", r->v[11].f);
+    } else {
+        fprintf(out, "  Did not reach the target\n");
+    }
+}
+
+static const tm_event ANNEAL_RESPONSE = { "anneal.response", render_response };
+static const tm_event ANNEAL_SCENE = { "anneal.scene", render_scene };
+static const tm_event ANNEAL_TEMPER = { "anneal.temper", render_temper };
+static const tm_event ANNEAL_OFFLINE = { "anneal.offline", render_offline };
+static const tm_event ANNEAL_SUPERPOSED = { "anneal.superposed", render_superposed };
+static const tm_event ANNEAL_INITIALIZE = { "anneal.initialize", render_initialize };
+static const tm_event ANNEAL_FETCH = { "anneal.fetch", render_fetch };
+static const tm_event ANNEAL_CALCULATE = { "anneal.calculate", render_calculate };
+static const tm_event ANNEAL_REPORT = { "anneal.report", render_report };
+static const tm_event QUANTUM_INITIALIZE = { "quantum.initialize", render_quantum_initialize };
+static const tm_event QUANTUM_FETCH = { "quantum.fetch", render_quantum_fetch };
+static const tm_event QUANTUM_CALCULATE = { "quantum.calculate", render_quantum_calculate };
+static const tm_event QUANTUM_REPORT = { "quantum.report", render_quantum_report };
+
+// Read the strongest line out of a PSG radiance table (whdr=n: no header, one row per sample
+// of "wavelength total noise ...", '#' comments). Intensity is PSG's total radiance at that
+// wavelength and noise its noise column, when there is one. False if no row parses.
+static bool parse_psg_reading(const char* body, size_t size, SpectralData* reading) {
+    bool found = false;
+    const char* end = body + size;
+    for (const char* p = body; p < end;) {
+        const char* eol = memchr(p, '\n', (size_t)(end - p));
+        size_t len = (size_t)((eol ? eol : end) - p);
+        char line[256];
+        if (len > 0 && len < sizeof(line) && *p != '#') {
+            memcpy(line, p, len);
+            line[len] = '\0';
+            char* next;
+            double wavelength = strtod(line, &next);
+            char* field = next;
+            double intensity = strtod(field, &next);
+            if (next != field && isfinite(wavelength) && isfinite(intensity) &&
+                (!found || intensity > reading->intensity)) {
+                field = next;
+                double noise = strtod(field, &next);
+                reading->wavelength = (float)wavelength;
+                reading->intensity = (float)intensity;
+                reading->noise = next != field && isfinite(noise) ? (float)fabs(noise) : 0.0f;
+                found = true;
+            }
+        }
+        p = eol ? eol + 1 : end;
+    }
+    return found;
+}
+
+// Runs on the simulation thread (from sc_get on a hit, else from sf_poll), so it may update
+// the instance directly
+static void on_spectral_result(const sc_result* result, void* user) {
+    AnnealingData* data = (AnnealingData*)user;
+    data->fetchesPending--;
+    TM_EMIT(&ANNEAL_RESPONSE, TM_S(data->name), TM_S(sf_source_name(result->source)),
+            TM_S(sc_outcome_name(result->outcome)), TM_I(result->status), TM_I(result->size),
+            TM_F(result->age_s), TM_S(result->body ? NULL : result->error));
+
+    // Only PSG answers with a spectrum (EMIT and Earthdata return granule metadata); a stale
+    // or failed lookup leaves the simulated reading in place
+    bool fresh = result->outcome == SC_HIT || result->outcome == SC_REVALIDATED ||
+                 result->outcome == SC_FETCHED;
+    if (result->source != SF_PSG || !fresh || !result->body) return;
+    SpectralData reading = data->current;
+    if (!parse_psg_reading(result->body, result->size, &reading)) return;
+    reading.source = "PSG";
+    data->current = reading;
+    data->measured = true;
+}
+
+// Look up PSG, EMIT and Earthdata for this location; cache misses go out concurrently.
+// Returns true if every lookup was answered or queued.
+static bool submit_fetches(AnnealingData* data) {
+    if (!data->spectra) return false;
+    sf_query query = {
+        .latitude = data->location.latitude,
+        .longitude = data->location.longitude,
+        .band_min_nm = 400.0,
+        .band_max_nm = 700.0
+    };
+    bool queued = true;
+    for (int s = 0; s < SF_SOURCE_COUNT; s++) {
+        data->fetchesPending++;
+        if (sc_get(data->spectra, (sf_source)s, &query, on_spectral_result, data) < 0) {
+            data->fetchesPending--;
+            queued = false;
+        }
+    }
+    return queued;
+}
+
+// Running totals over every valid sample a scene streams past
+typedef struct {
+    float* scratch;          // One decoded row, when samples cannot be read in place
+    double sum;
+    double sumSquares;
+    size_t count;
+    size_t tiles;
+} SceneTotals;
+
+static int accumulate_tile(const cube_tile* tile, void* user) {
+    SceneTotals* totals = (SceneTotals*)user;
+    const cube* scene = tile->cube;
+    double sum = 0.0, sumSquares = 0.0;
+    size_t count = 0;
+    for (size_t line = 0; line < tile->lines; line++) {
+        for (size_t band = 0; band < tile->bands; band++) {
+            const float* row = cube_tile_row(tile, line, band, totals->scratch);
+            for (size_t s = 0; s < scene->samples; s++) {
+                float v = row[s];
+                if (!isfinite(v) || (scene->has_ignore && v == (float)scene->ignore_value)) continue;
+                sum += v;
+                sumSquares += (double)v * v;
+                count++;
+            }
+        }
+    }
+    totals->sum += sum;
+    totals->sumSquares += sumSquares;
+    totals->count += count;
+    totals->tiles++;
+    return 0;
+}
+
+// Spacing of the local minima in the reading cost, like absorption lines on a continuum, so
+// a walk that only ever goes downhill stalls a few lines from the target
+#define ABSORPTION_SPACING_NM 10.0
+
 // Define base class
 DEFINE_CLASS(SpectralAnnealing, Object, AnnealingData);
 
 // Define base class methods
 DEFINE_METHOD(SpectralAnnealing, initializeAnnealing, void) {
+    (void)self;
     AnnealingData* data = (AnnealingData*)thisData;
     data->isActive = true;
     data->annealingProgress = 0.0;
     
-    printf("%s is initializing spectral annealing...\n", data->name);
-    printf("Location: %s\n", data->location.location);
-    printf("Coordinates: %.6f, %.6f\n", 
-           data->location.latitude, data->location.longitude);
-    printf("Environmental conditions:\n");
-    printf("  Temperature: %.1f°C\n", data->location.temperature);
-    printf("  Pressure: %.1f kPa\n", data->location.pressure);
-    printf("  Humidity: %.1f%%\n", data->location.humidity);
+    TM_EMIT(&ANNEAL_INITIALIZE, TM_S(data->name), TM_S(data->location.location),
+            TM_F(data->location.latitude), TM_F(data->location.longitude),
+            TM_F(data->location.temperature), TM_F(data->location.pressure),
+            TM_F(data->location.humidity));
 }
 
 DEFINE_METHOD(SpectralAnnealing, fetchSpectralData, void) {
+    (void)self;
     AnnealingData* data = (AnnealingData*)thisData;
     if (!data->isActive) {
-        printf("%s is offline. Please activate first.\n", data->name);
+        TM_EMIT(&ANNEAL_OFFLINE, TM_S(data->name));
         return;
     }
     
-    // Simulate API calls to PSG, EMIT, and Earthdata
-    printf("%s is fetching spectral data...\n", data->name);
-    printf("Querying Planetary Spectrum Generator API...\n");
-    printf("Accessing EMIT Imaging Spectrometer data...\n");
-    printf("Retrieving Earthdata API information...\n");
+    // Query PSG, EMIT and Earthdata through the cache; a fresh cached spectrum is parsed
+    // before sc_get returns, fetched ones arrive through sf_poll
+    data->measured = false;
+    bool queried = submit_fetches(data);
     
-    // Simulate spectral data updates
-    data->current.wavelength = 500.0 + (rand() % 1000) / 10.0;
-    data->current.intensity = 0.5 + (rand() % 100) / 100.0;
-    data->current.noise = (rand() % 100) / 1000.0;
-    data->current.source = "EMIT";
+    // Simulate spectral data updates until a response is parsed
+    if (!data->measured) {
+        data->current.wavelength = 500.0 + (rand() % 1000) / 10.0;
+        data->current.intensity = 0.5 + (rand() % 100) / 100.0;
+        data->current.noise = (rand() % 100) / 1000.0;
+        data->current.source = "EMIT";
+    }
     
-    printf("Current spectral reading:\n");
-    printf("  Wavelength: %.1f nm\n", data->current.wavelength);
-    printf("  Intensity: %.3f\n", data->current.intensity);
-    printf("  Noise: %.3f\n", data->current.noise);
-    printf("  Source: %s\n", data->current.source);
+    TM_EMIT(&ANNEAL_FETCH, TM_S(data->name), TM_F(data->current.wavelength),
+            TM_F(data->current.intensity), TM_F(data->current.noise), TM_S(data->current.source),
+            TM_I(queried));
 }
 
 DEFINE_METHOD(SpectralAnnealing, calculateAnnealing, void, float targetProgress) {
+    (void)self;
     AnnealingData* data = (AnnealingData*)thisData;
     if (!data->isActive) {
-        printf("%s is offline. Please activate first.\n", data->name);
+        TM_EMIT(&ANNEAL_OFFLINE, TM_S(data->name));
         return;
     }
     
     float progress = targetProgress - data->annealingProgress;
     data->annealingProgress += progress * 0.1;
     
-    printf("%s is calculating spectral annealing...\n", data->name);
-    printf("Target progress: %.1f%%\n", targetProgress);
-    printf("Current progress: %.1f%%\n", data->annealingProgress);
-    printf("Spectral difference: %.3f\n", 
-           fabs(data->current.intensity - data->target.intensity));
+    TM_EMIT(&ANNEAL_CALCULATE, TM_S(data->name), TM_F(targetProgress),
+            TM_F(data->annealingProgress),
+            TM_F(fabs(data->current.intensity - data->target.intensity)));
 }
 
 DEFINE_METHOD(SpectralAnnealing, reportSpectralStatus, void) {
+    (void)self;
     AnnealingData* data = (AnnealingData*)thisData;
-    printf("\n=== Spectral Annealing Status Report ===\n");
-    printf("Name: %s\n", data->name);
-    printf("Status: %s\n", data->isActive ? "Active" : "Inactive");
-    printf("Location: %s (%.6f, %.6f)\n", 
-           data->location.location,
-           data->location.latitude,
-           data->location.longitude);
-    printf("Current Spectral Data:\n");
-    printf("  Wavelength: %.1f nm\n", data->current.wavelength);
-    printf("  Intensity: %.3f\n", data->current.intensity);
-    printf("  Noise: %.3f\n", data->current.noise);
-    printf("  Source: %s\n", data->current.source);
-    printf("Annealing Progress: %.1f%%\n", data->annealingProgress);
-    printf("Current State: %s\n", data->currentState);
+    TM_EMIT(&ANNEAL_REPORT, TM_S(data->name), TM_I(data->isActive),
+            TM_S(data->location.location), TM_F(data->location.latitude),
+            TM_F(data->location.longitude),
+            TM_F(data->current.wavelength), TM_F(data->current.intensity),
+            TM_F(data->current.noise), TM_S(data->current.source),
+            TM_F(data->annealingProgress), TM_S(data->currentState));
 }
 
 // Define quantum annealing class
@@ -130,51 +386,48 @@ DEFINE_CLASS(QuantumAnnealing, SpectralAnnealing, QuantumAnnealingData);
 
 // Define quantum annealing methods
 DEFINE_METHOD(QuantumAnnealing, initializeAnnealing, void) {
+    (void)self;
     QuantumAnnealingData* data = (QuantumAnnealingData*)thisData;
     data->base.isActive = true;
     data->base.annealingProgress = 0.0;
     data->quantumCoherence = 1.0;
     
-    printf("%s is initializing quantum spectral annealing...\n", data->base.name);
-    printf("Quantum coherence: %.2f\n", data->quantumCoherence);
-    printf("Quantum state: %s\n", data->quantumState);
+    TM_EMIT(&QUANTUM_INITIALIZE, TM_S(data->base.name), TM_F(data->quantumCoherence),
+            TM_S(data->quantumState));
 }
 
 DEFINE_METHOD(QuantumAnnealing, fetchSpectralData, void) {
+    (void)self;
     QuantumAnnealingData* data = (QuantumAnnealingData*)thisData;
     if (!data->base.isActive) {
-        printf("%s is in quantum superposition of online/offline states.\n", 
-               data->base.name);
+        TM_EMIT(&ANNEAL_SUPERPOSED, TM_S(data->base.name));
         return;
     }
     
-    printf("%s is fetching quantum spectral data...\n", data->base.name);
-    printf("Querying quantum-enhanced PSG API...\n");
-    printf("Accessing quantum EMIT data...\n");
-    printf("Retrieving quantum Earthdata information...\n");
+    data->base.measured = false;
+    bool queried = submit_fetches(&data->base);
     
-    // Simulate quantum spectral data updates
-    data->base.current.wavelength = 500.0 + (rand() % 1000) / 10.0;
-    data->base.current.intensity = 0.5 + (rand() % 100) / 100.0;
-    data->base.current.noise = (rand() % 100) / 1000.0;
-    data->base.current.source = "Quantum EMIT";
+    // Simulate quantum spectral data updates until a response is parsed
+    if (!data->base.measured) {
+        data->base.current.wavelength = 500.0 + (rand() % 1000) / 10.0;
+        data->base.current.intensity = 0.5 + (rand() % 100) / 100.0;
+        data->base.current.noise = (rand() % 100) / 1000.0;
+        data->base.current.source = "Quantum EMIT";
+    }
     
     data->quantumCoherence += (rand() % 100 - 50) / 100.0;
     data->superpositionCount++;
     
-    printf("Quantum spectral reading:\n");
-    printf("  Wavelength: %.1f nm (in superposition)\n", data->base.current.wavelength);
-    printf("  Intensity: %.3f (quantum-enhanced)\n", data->base.current.intensity);
-    printf("  Noise: %.3f (quantum-damped)\n", data->base.current.noise);
-    printf("  Source: %s\n", data->base.current.source);
-    printf("Quantum coherence: %.2f\n", data->quantumCoherence);
+    TM_EMIT(&QUANTUM_FETCH, TM_S(data->base.name), TM_F(data->base.current.wavelength),
+            TM_F(data->base.current.intensity), TM_F(data->base.current.noise),
+            TM_S(data->base.current.source), TM_F(data->quantumCoherence), TM_I(queried));
 }
 
 DEFINE_METHOD(QuantumAnnealing, calculateAnnealing, void, float targetProgress) {
+    (void)self;
     QuantumAnnealingData* data = (QuantumAnnealingData*)thisData;
     if (!data->base.isActive) {
-        printf("%s is in quantum superposition of online/offline states.\n", 
-               data->base.name);
+        TM_EMIT(&ANNEAL_SUPERPOSED, TM_S(data->base.name));
         return;
     }
     
@@ -182,51 +435,208 @@ DEFINE_METHOD(QuantumAnnealing, calculateAnnealing, void, float targetProgress)
                            data->quantumCoherence;
     data->base.annealingProgress += quantumProgress * 0.1;
     
-    printf("%s is calculating quantum spectral annealing...\n", data->base.name);
-    printf("Target progress: %.1f%%\n", targetProgress);
-    printf("Quantum-adjusted progress: %.1f%%\n", data->base.annealingProgress);
-    printf("Quantum spectral difference: %.3f\n", 
-           fabs(data->base.current.intensity - data->base.target.intensity));
+    TM_EMIT(&QUANTUM_CALCULATE, TM_S(data->base.name), TM_F(targetProgress),
+            TM_F(data->base.annealingProgress),
+            TM_F(fabs(data->base.current.intensity - data->base.target.intensity)));
 }
 
 DEFINE_METHOD(QuantumAnnealing, reportSpectralStatus, void) {
+    (void)self;
+    QuantumAnnealingData* data = (QuantumAnnealingData*)thisData;
+    TM_EMIT(&QUANTUM_REPORT, TM_S(data->base.name), TM_I(data->base.isActive),
+            TM_S(data->base.location.location), TM_F(data->base.location.latitude),
+            TM_F(data->base.location.longitude),
+            TM_F(data->base.current.wavelength), TM_F(data->base.current.intensity),
+            TM_F(data->base.current.noise), TM_S(data->base.current.source),
+            TM_F(data->quantumCoherence), TM_I(data->superpositionCount),
+            TM_S(data->quantumState));
+}
+
+// Steps scale with the coherence, as calculateAnnealing does, and a coherent replica sometimes
+// tunnels straight to the next absorption line instead of climbing over the barrier
+DEFINE_METHOD(QuantumAnnealing, proposeReading, void, const SpectralData* from,
+              SpectralData* to, double temperature, pt_rng* rng) {
+    (void)self;
     QuantumAnnealingData* data = (QuantumAnnealingData*)thisData;
-    printf("\n=== Quantum Spectral Annealing Status Report ===\n");
-    printf("Name: %s\n", data->base.name);
-    printf("Status: %s (in superposition)\n", 
-           data->base.isActive ? "Active" : "Inactive");
-    printf("Location: %s (%.6f, %.6f)\n", 
-           data->base.location.location,
-           data->base.location.latitude,
-           data->base.location.longitude);
-    printf("Quantum Spectral Data:\n");
-    printf("  Wavelength: %.1f nm (in superposition)\n", data->base.current.wavelength);
-    printf("  Intensity: %.3f (quantum-enhanced)\n", data->base.current.intensity);
-    printf("  Noise: %.3f (quantum-damped)\n", data->base.current.noise);
-    printf("  Source: %s\n", data->base.current.source);
-    printf("Quantum Coherence: %.2f\n", data->quantumCoherence);
-    printf("Superposition Count: %d\n", data->superpositionCount);
-    printf("Quantum State: %s\n", data->quantumState);
+    double coherence = fmax(fabs(data->quantumCoherence), 0.1);
+    double scale = sqrt(temperature) * coherence;
+    *to = *from;
+    if (pt_uniform(rng) < fmin(0.1 * coherence, 0.5)) {
+        to->wavelength += pt_uniform(rng) < 0.5 ? -ABSORPTION_SPACING_NM : ABSORPTION_SPACING_NM;
+        return;
+    }
+    to->wavelength += (float)(20.0 * scale * pt_normal(rng));
+    to->intensity += (float)(0.2 * scale * pt_normal(rng));
+    to->noise = fabsf(from->noise + (float)(0.02 * scale * pt_normal(rng)));
+}
+
+// Replace the simulated reading with the whole scene's mean and spread in the three bands
+// around the target wavelength, one tile of lines at a time
+DEFINE_METHOD(SpectralAnnealing, annealScene, void, const cube* scene) {
+    (void)self;
+    AnnealingData* data = (AnnealingData*)thisData;
+    if (!data->isActive) {
+        TM_EMIT(&ANNEAL_OFFLINE, TM_S(data->name));
+        return;
+    }
+    
+    size_t center = cube_band_near(scene, data->target.wavelength);
+    cube_stream_opts opts = {
+        .tile_lines = 64,
+        .band0 = center > 0 ? center - 1 : 0,
+        .bands = 3
+    };
+    SceneTotals totals = { .scratch = (float*)malloc(scene->samples * sizeof(float)) };
+    if (!totals.scratch) return;
+    cube_stream(scene, &opts, accumulate_tile, &totals);
+    free(totals.scratch);
+    
+    size_t lastBand = opts.band0 + opts.bands - 1 < scene->bands ? opts.band0 + opts.bands - 1
+                                                                 : scene->bands - 1;
+    if (totals.count) {
+        double mean = totals.sum / totals.count;
+        double variance = totals.sumSquares / totals.count - mean * mean;
+        data->current.wavelength = scene->wavelengths_nm ? scene->wavelengths_nm[center] : 0.0f;
+        data->current.intensity = (float)mean;
+        data->current.noise = (float)sqrt(variance > 0.0 ? variance : 0.0);
+        data->current.source = "EMIT scene";
+    }
+    TM_EMIT(&ANNEAL_SCENE, TM_S(data->name), TM_I(scene->samples), TM_I(scene->lines),
+            TM_I(scene->bands),
+            TM_F(scene->wavelengths_nm ? scene->wavelengths_nm[opts.band0] : 0.0),
+            TM_F(scene->wavelengths_nm ? scene->wavelengths_nm[lastBand] : 0.0),
+            TM_I(totals.tiles), TM_F(data->current.intensity), TM_F(data->current.noise),
+            TM_I(totals.count));
+}
+
+// How far a reading is from the target; 0 at the target itself
+DEFINE_METHOD(SpectralAnnealing, spectralCost, double, const SpectralData* reading) {
+    (void)self;
+    AnnealingData* data = (AnnealingData*)thisData;
+    double offset = reading->wavelength - data->target.wavelength;
+    double line = sin(M_PI * offset / ABSORPTION_SPACING_NM);
+    return fabs(reading->intensity - data->target.intensity) +
+           fabs(reading->noise - data->target.noise) +
+           fabs(offset) / 100.0 + 0.05 * line * line;
+}
+
+// A neighbouring reading, further away the hotter the replica
+DEFINE_METHOD(SpectralAnnealing, proposeReading, void, const SpectralData* from,
+              SpectralData* to, double temperature, pt_rng* rng) {
+    (void)self;
+    (void)thisData;
+    double scale = sqrt(temperature);
+    *to = *from;
+    to->wavelength += (float)(20.0 * scale * pt_normal(rng));
+    to->intensity += (float)(0.2 * scale * pt_normal(rng));
+    to->noise = fabsf(from->noise + (float)(0.02 * scale * pt_normal(rng)));
+}
+
+// Bridge the tempering engine to an instance's spectralCost and proposeReading overrides.
+// Worker threads call these concurrently; the methods only read the instance.
+static double reading_cost(const void* state, void* ctx) {
+    return CALL_AS(SpectralAnnealing, ctx, spectralCost, (const SpectralData*)state);
+}
+
+static void propose_reading(const void* from, void* to, double temperature, pt_rng* rng,
+                            void* ctx) {
+    CALL_AS(SpectralAnnealing, ctx, proposeReading, (const SpectralData*)from,
+            (SpectralData*)to, temperature, rng);
+}
+
+// Search for the reading closest to the target with parallel tempering, starting from the
+// current one. Subclasses plug in through spectralCost and proposeReading.
+DEFINE_METHOD(SpectralAnnealing, temperReadings, void, const pt_config* config) {
+    AnnealingData* data = (AnnealingData*)thisData;
+    if (!data->isActive) {
+        TM_EMIT(&ANNEAL_OFFLINE, TM_S(data->name));
+        return;
+    }
+    
+    pt_provider provider = { sizeof(SpectralData), reading_cost, propose_reading, self };
+    SpectralData best;
+    pt_stats stats;
+    if (pt_run(&provider, config, &data->current, &best, &stats) != PT_OK) return;
+    data->current = best;
+    
+    TM_EMIT(&ANNEAL_TEMPER, TM_S(data->name), TM_I(stats.replicas), TM_I(stats.threads),
+            TM_I(stats.rounds), TM_F(stats.moves_per_s),
+            TM_F(stats.swaps_offered ? (double)stats.swaps_accepted / stats.swaps_offered : 0.0),
+            TM_I(stats.stolen), TM_F(stats.initial_cost), TM_F(stats.best_cost),
+            TM_F(stats.best_s), TM_F(stats.cost_drop_per_s), TM_F(stats.converge_s));
 }
 
 // Initialize classes
-INIT_CLASS(SpectralAnnealing, Object,
-    ADD_METHOD(SpectralAnnealing, initializeAnnealing),
-    ADD_METHOD(SpectralAnnealing, fetchSpectralData),
-    ADD_METHOD(SpectralAnnealing, calculateAnnealing),
-    ADD_METHOD(SpectralAnnealing, reportSpectralStatus)
-);
+#define SpectralAnnealing_METHODS \
+    ADD_METHOD(SpectralAnnealing, initializeAnnealing), \
+    ADD_METHOD(SpectralAnnealing, fetchSpectralData), \
+    ADD_METHOD(SpectralAnnealing, calculateAnnealing), \
+    ADD_METHOD(SpectralAnnealing, reportSpectralStatus), \
+    ADD_METHOD(SpectralAnnealing, annealScene), \
+    ADD_METHOD(SpectralAnnealing, spectralCost), \
+    ADD_METHOD(SpectralAnnealing, proposeReading), \
+    ADD_METHOD(SpectralAnnealing, temperReadings)
+
+INIT_CLASS(SpectralAnnealing, Object, SpectralAnnealing_METHODS);
 
 INIT_CLASS(QuantumAnnealing, SpectralAnnealing,
     ADD_METHOD(QuantumAnnealing, initializeAnnealing),
     ADD_METHOD(QuantumAnnealing, fetchSpectralData),
     ADD_METHOD(QuantumAnnealing, calculateAnnealing),
-    ADD_METHOD(QuantumAnnealing, reportSpectralStatus)
+    ADD_METHOD(QuantumAnnealing, reportSpectralStatus),
+    ADD_METHOD(QuantumAnnealing, proposeReading)
 );
 
-int main() {
+int main(int argc, char** argv) {
+    tm_config telemetry = { .out = stdout };
+    bool offline = false;
+    const char* cacheDir = "build/spectral_cache";
+    const char* scenePath = NULL;
+    pt_config tempering = { .t_min = 1e-3, .t_max = 0.5, .target_cost = 0.01, .seed = 1 };
+    bool temper = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quiet") == 0) {
+            telemetry.quiet = 1;
+        } else if (strcmp(argv[i], "--offline") == 0) {
+            offline = true;
+        } else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (strcmp(argv[i], "--no-cache-dir") == 0) {
+            cacheDir = NULL;
+        } else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            scenePath = argv[++i];
+        } else if (strcmp(argv[i], "--temper") == 0 && i + 1 < argc) {
+            tempering.replicas = strtoul(argv[++i], NULL, 10);
+            temper = true;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            tempering.threads = strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--quiet] [--offline] [--cache-dir DIR | --no-cache-dir] "
+                    "[--scene ENVI_CUBE] [--temper REPLICAS [--threads N]]\n", argv[0]);
+            return 2;
+        }
+    }
+    cube scene;
+    if (scenePath && cube_open(&scene, scenePath) != CUBE_OK) {
+        fprintf(stderr, "spectral_annealing: cannot read the ENVI cube %s\n", scenePath);
+        return 1;
+    }
+    if (tm_start(&telemetry) != 0) {
+        fprintf(stderr, "spectral_annealing: could not start the telemetry flusher\n");
+        return 1;
+    }
     srand(time(NULL));
     
+    // One fetcher and one cache for every instance, so they share connections and responses
+    sf_fetcher* fetcher = offline ? NULL : sf_create(NULL);
+    if (!offline && !fetcher) TM_TEXT("Spectral fetcher unavailable; using cached data only\n");
+    sc_cache* spectra = sc_open(&(sc_config){ .dir = cacheDir }, fetcher);
+    if (!spectra) TM_TEXT("Spectral cache unavailable; simulating readings only\n");
+    
+    // One pool for both tempering runs, started only if asked for
+    if (temper) tempering.pool = wp_create(tempering.threads);
+    if (temper && !tempering.pool) TM_TEXT("Could not start the tempering pool\n");
+    
     // Create regular annealing system
     AnnealingData regularData = {
         .name = "Classic Spectral Annealing",
@@ -252,7 +662,8 @@ int main() {
         },
         .annealingProgress = 0.0,
         .isActive = false,
-        .currentState = "Initializing"
+        .currentState = "Initializing",
+        .spectra = spectra
     };
     
     SpectralAnnealing* regular = NEW_WITH_DATA(SpectralAnnealing, AnnealingData, &regularData);
@@ -283,7 +694,8 @@ int main() {
             },
             .annealingProgress = 0.0,
             .isActive = false,
-            .currentState = "Quantum Initializing"
+            .currentState = "Quantum Initializing",
+            .spectra = spectra
         },
         .quantumCoherence = 0.0,
         .superpositionCount = 0,
@@ -293,26 +705,49 @@ int main() {
     QuantumAnnealing* quantum = NEW_WITH_DATA(QuantumAnnealing, QuantumAnnealingData, &quantumData);
     
     // Run annealing tests
-    printf("\n=== Spectral Annealing Test Suite ===\n\n");
+    TM_TEXT("\n=== Spectral Annealing Test Suite ===\n\n");
     
-    printf("Testing Classic Spectral Annealing:\n");
+    TM_TEXT("Testing Classic Spectral Annealing:\n");
     CALL(regular, initializeAnnealing);
     CALL(regular, fetchSpectralData);
-    CALL(regular, calculateAnnealing, 95.0);
+    if (scenePath) CALL(regular, annealScene, &scene);
+    if (tempering.pool) CALL(regular, temperReadings, &tempering);
+    CALL_AS(SpectralAnnealing, regular, calculateAnnealing, 95.0f);
+    sf_poll(fetcher, 0);
     CALL(regular, reportSpectralStatus);
     
-    printf("\nTesting Quantum Spectral Annealing:\n");
+    TM_TEXT("\nTesting Quantum Spectral Annealing:\n");
     CALL(quantum, initializeAnnealing);
     CALL(quantum, fetchSpectralData);
-    CALL(quantum, calculateAnnealing, 95.0);
+    if (scenePath) CALL(quantum, annealScene, &scene);
+    if (tempering.pool) CALL(quantum, temperReadings, &tempering);
+    CALL_AS(SpectralAnnealing, quantum, calculateAnnealing, 95.0f);
+    sf_poll(fetcher, 0);
     CALL(quantum, reportSpectralStatus);
     
-    printf("\n=== Spectral Annealing Test Complete ===\n");
-    printf("(Please check for any quantum anomalies in the spectral data)\n");
+    // Collect the responses still in flight; every transfer has a timeout, so this ends
+    while (sf_pending(fetcher)) {
+        sf_wait(fetcher, 100);
+        sf_poll(fetcher, 0);
+    }
+    
+    TM_TEXT("\n=== Spectral Annealing Test Complete ===\n");
+    TM_TEXT("(Please check for any quantum anomalies in the spectral data)\n");
     
     // Clean up
     DELETE(regular);
     DELETE(quantum);
+    sf_destroy(fetcher);
+    sc_close(spectra);
+    wp_destroy(tempering.pool);
+    if (scenePath) cube_close(&scene);
     
+    tm_stop();
+    if (telemetry.quiet) {
+        tm_stats stats;
+        tm_stats_get(&stats);
+        fprintf(stderr, "telemetry: %llu records, %llu dropped\n",
+                (unsigned long long)stats.emitted, (unsigned long long)stats.dropped);
+    }
     return 0;
 } 
\ No newline at end of file
@@ -0,0 +1,591 @@
+/**
+ * spectral_cache: the LRU, the mapped on-disk store and the per-source budgets behind
+ * spectral_cache.h.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "spectral_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SC_KEY_MAX 96
+#define SC_ETAG_MAX 128
+#define SC_DATE_MAX 64
+#define SC_MAGIC "SPECC01"
+
+static const double DEFAULT_MAX_AGE_S[SF_SOURCE_COUNT] = { 86400.0, 21600.0, 3600.0 };
+static const double DEFAULT_RATE_PER_S[SF_SOURCE_COUNT] = { 0.5, 5.0, 5.0 };
+static const double DEFAULT_BURST[SF_SOURCE_COUNT] = { 4.0, 10.0, 10.0 };
+
+static const char *const OUTCOME_NAMES[] = {
+    "hit", "revalidated", "fetched", "stale", "rate-limited", "failed", "pending",
+};
+
+/* Start of every entry file; the body follows */
+typedef struct {
+    char magic[8];
+    uint64_t hash;
+    int32_t source;
+    int32_t status;
+    int64_t stored_at;          /* wall-clock seconds */
+    uint64_t size;
+    char key[SC_KEY_MAX];
+    char etag[SC_ETAG_MAX];
+    char last_modified[SC_DATE_MAX];
+} sc_disk_header;
+
+typedef struct sc_entry {
+    uint64_t hash;
+    char key[SC_KEY_MAX];
+    sf_source source;
+    long status;
+    const char *body;           /* into map, or owned */
+    size_t size;
+    void *map;
+    size_t map_len;
+    char *owned;
+    char etag[SC_ETAG_MAX];
+    char last_modified[SC_DATE_MAX];
+    int64_t stored_at;
+    int pins;                   /* callbacks using the body right now; never evicted */
+    struct sc_entry *prev;      /* LRU order, most recent first */
+    struct sc_entry *next;
+    struct sc_entry *chain;     /* hash bucket */
+} sc_entry;
+
+typedef struct sc_waiter {
+    sc_callback callback;
+    void *user;
+    struct sc_waiter *next;
+} sc_waiter;
+
+/* One request in flight for a key, and every lookup waiting on it */
+typedef struct sc_flight {
+    sc_cache *cache;
+    uint64_t hash;
+    char key[SC_KEY_MAX];
+    sf_source source;
+    sf_query query;
+    sc_waiter *waiters;
+    sc_waiter **waiters_tail;
+    struct sc_flight *next;
+} sc_flight;
+
+typedef struct {
+    double tokens;
+    uint64_t refilled_ns;
+    uint64_t closed_until_ns;   /* Retry-After */
+} sc_budget;
+
+struct sc_cache {
+    sc_config config;
+    char *dir;
+    sf_fetcher *fetcher;
+    sc_entry **buckets;
+    size_t bucket_mask;
+    sc_entry *lru_head;
+    sc_entry *lru_tail;
+    size_t entries;
+    size_t bytes;
+    sc_flight *flights;
+    sc_budget budgets[SF_SOURCE_COUNT];
+    sc_stats stats;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int64_t wall_s(void) {
+    return (int64_t)time(NULL);
+}
+
+const char *sc_outcome_name(sc_outcome outcome) {
+    return (unsigned)outcome <= SC_PENDING ? OUTCOME_NAMES[outcome] : "unknown";
+}
+
+static uint64_t hash_key(const char *key) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (; *key; key++) h = (h ^ (unsigned char)*key) * 0x100000001b3ull;
+    return h;
+}
+
+static void make_key(sf_source source, const sf_query *q, char *key) {
+    snprintf(key, SC_KEY_MAX, "%d|%.4f|%.4f|%.1f|%.1f", (int)source,
+             q->latitude, q->longitude, q->band_min_nm, q->band_max_nm);
+}
+
+static void copy_string(char *out, size_t cap, const char *s) {
+    size_t n = s ? strlen(s) : 0;
+    if (n >= cap) n = cap - 1;
+    if (n) memcpy(out, s, n);
+    out[n] = '\0';
+}
+
+/* ---- LRU ---- */
+
+static void lru_unlink(sc_cache *c, sc_entry *e) {
+    if (e->prev) {
+        e->prev->next = e->next;
+    } else {
+        c->lru_head = e->next;
+    }
+    if (e->next) {
+        e->next->prev = e->prev;
+    } else {
+        c->lru_tail = e->prev;
+    }
+    e->prev = e->next = NULL;
+}
+
+static void lru_push_front(sc_cache *c, sc_entry *e) {
+    e->prev = NULL;
+    e->next = c->lru_head;
+    if (c->lru_head) {
+        c->lru_head->prev = e;
+    } else {
+        c->lru_tail = e;
+    }
+    c->lru_head = e;
+}
+
+/* Mark an entry most recently used */
+static void touch(sc_cache *c, sc_entry *e) {
+    lru_unlink(c, e);
+    lru_push_front(c, e);
+}
+
+static void release_body(sc_cache *c, sc_entry *e) {
+    c->bytes -= e->size;
+    if (e->map) munmap(e->map, e->map_len);
+    free(e->owned);
+    e->map = NULL;
+    e->owned = NULL;
+    e->body = NULL;
+    e->size = 0;
+}
+
+static void drop_entry(sc_cache *c, sc_entry *e) {
+    sc_entry **link = &c->buckets[e->hash & c->bucket_mask];
+    while (*link != e) link = &(*link)->chain;
+    *link = e->chain;
+    lru_unlink(c, e);
+    release_body(c, e);
+    c->entries--;
+    free(e);
+}
+
+static void evict(sc_cache *c) {
+    sc_entry *e = c->lru_tail;
+    while (e && (c->entries > c->config.max_entries || c->bytes > c->config.max_bytes)) {
+        sc_entry *prev = e->prev;
+        if (!e->pins) {
+            drop_entry(c, e);
+            c->stats.evicted++;
+        }
+        e = prev;
+    }
+}
+
+static sc_entry *find(sc_cache *c, uint64_t hash, const char *key) {
+    for (sc_entry *e = c->buckets[hash & c->bucket_mask]; e; e = e->chain) {
+        if (e->hash == hash && strcmp(e->key, key) == 0) return e;
+    }
+    return NULL;
+}
+
+static sc_entry *insert(sc_cache *c, uint64_t hash, const char *key, sf_source source) {
+    sc_entry *e = (sc_entry *)calloc(1, sizeof(sc_entry));
+    if (!e) return NULL;
+    e->hash = hash;
+    copy_string(e->key, sizeof(e->key), key);
+    e->source = source;
+    sc_entry **bucket = &c->buckets[hash & c->bucket_mask];
+    e->chain = *bucket;
+    *bucket = e;
+    lru_push_front(c, e);
+    c->entries++;
+    return e;
+}
+
+/* ---- Disk ---- */
+
+static void entry_path(const sc_cache *c, uint64_t hash, char *path, size_t cap) {
+    snprintf(path, cap, "%s/%016llx.spc", c->dir, (unsigned long long)hash);
+}
+
+static int make_dirs(const char *dir) {
+    char path[1024];
+    if (strlen(dir) >= sizeof(path)) return -1;
+    strcpy(path, dir);
+    for (char *p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) return -1;
+        *p = '/';
+    }
+    return mkdir(path, 0755) != 0 && errno != EEXIST ? -1 : 0;
+}
+
+/* Map an entry file in; NULL if there is none or it does not hold this key */
+static sc_entry *load_disk(sc_cache *c, uint64_t hash, const char *key, sf_source source) {
+    if (!c->dir) return NULL;
+    char path[1100];
+    entry_path(c, hash, path, sizeof(path));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(sc_disk_header)) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+    const sc_disk_header *h = (const sc_disk_header *)map;
+    size_t len = (size_t)st.st_size;
+    if (memcmp(h->magic, SC_MAGIC, sizeof(SC_MAGIC)) != 0 || h->hash != hash ||
+        h->size != len - sizeof(sc_disk_header) || strncmp(h->key, key, SC_KEY_MAX) != 0) {
+        munmap(map, len);
+        return NULL;
+    }
+    sc_entry *e = insert(c, hash, key, source);
+    if (!e) {
+        munmap(map, len);
+        return NULL;
+    }
+    e->map = map;
+    e->map_len = len;
+    e->body = (const char *)map + sizeof(sc_disk_header);
+    e->size = (size_t)h->size;
+    e->status = h->status;
+    e->stored_at = h->stored_at;
+    copy_string(e->etag, sizeof(e->etag), h->etag);
+    copy_string(e->last_modified, sizeof(e->last_modified), h->last_modified);
+    c->bytes += e->size;
+    c->stats.disk_loads++;
+    return e;
+}
+
+static void fill_header(const sc_entry *e, sc_disk_header *h) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, SC_MAGIC, sizeof(SC_MAGIC));
+    h->hash = e->hash;
+    h->source = (int32_t)e->source;
+    h->status = (int32_t)e->status;
+    h->stored_at = e->stored_at;
+    h->size = e->size;
+    copy_string(h->key, sizeof(h->key), e->key);
+    copy_string(h->etag, sizeof(h->etag), e->etag);
+    copy_string(h->last_modified, sizeof(h->last_modified), e->last_modified);
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = (const char *)data;
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Write an entry to a temporary file and rename it into place, so readers never see half of
+ * one. Failure only loses persistence; the entry stays in memory. */
+static void store_disk(sc_cache *c, const sc_entry *e) {
+    if (!c->dir) return;
+    char path[1100], tmp[1120];
+    entry_path(c, e->hash, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+    sc_disk_header h;
+    fill_header(e, &h);
+    int failed = write_all(fd, &h, sizeof(h)) || write_all(fd, e->body, e->size);
+    if (close(fd) != 0) failed = 1;
+    if (failed || rename(tmp, path) != 0) unlink(tmp);
+}
+
+/* A 304 only moves the timestamp, which is rewritten in place */
+static void touch_disk(sc_cache *c, const sc_entry *e) {
+    if (!c->dir) return;
+    char path[1100];
+    entry_path(c, e->hash, path, sizeof(path));
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    int64_t stored_at = e->stored_at;
+    ssize_t n = pwrite(fd, &stored_at, sizeof(stored_at), offsetof(sc_disk_header, stored_at));
+    (void)n;
+    close(fd);
+}
+
+/* ---- Budgets ---- */
+
+static int take_token(sc_cache *c, sf_source source) {
+    sc_budget *b = &c->budgets[source];
+    uint64_t now = now_ns();
+    if (now < b->closed_until_ns) return 0;
+    double burst = c->config.burst[source];
+    b->tokens += (double)(now - b->refilled_ns) * 1e-9 * c->config.rate_per_s[source];
+    if (b->tokens > burst) b->tokens = burst;
+    b->refilled_ns = now;
+    if (b->tokens < 1.0) return 0;
+    b->tokens -= 1.0;
+    return 1;
+}
+
+static void close_source(sc_cache *c, sf_source source, long retry_after_s) {
+    double wait_s = retry_after_s > 0 ? (double)retry_after_s : c->config.backoff_s;
+    c->budgets[source].closed_until_ns = now_ns() + (uint64_t)(wait_s * 1e9);
+}
+
+/* ---- Lookups ---- */
+
+static void count(sc_cache *c, sc_outcome outcome) {
+    switch (outcome) {
+    case SC_HIT: c->stats.hits++; break;
+    case SC_REVALIDATED: c->stats.revalidated++; break;
+    case SC_FETCHED: c->stats.fetched++; break;
+    case SC_STALE: c->stats.stale++; break;
+    case SC_RATE_LIMITED: c->stats.rate_limited++; break;
+    case SC_FAILED: c->stats.failed++; break;
+    default: break;
+    }
+}
+
+static void deliver(sc_cache *c, sc_entry *e, sf_source source, const sf_query *query,
+                    sc_outcome outcome, long status, const char *error,
+                    sc_callback callback, void *user) {
+    sc_result r = { source, outcome, status, NULL, 0, 0.0, error, query };
+    if (e && e->body) {
+        r.status = e->status;
+        r.body = e->body;
+        r.size = e->size;
+        r.age_s = (double)(wall_s() - e->stored_at);
+        e->pins++;
+    }
+    count(c, outcome);
+    callback(&r, user);
+    if (e && e->body) e->pins--;
+}
+
+static sc_flight *find_flight(sc_cache *c, uint64_t hash, const char *key) {
+    for (sc_flight *f = c->flights; f; f = f->next) {
+        if (f->hash == hash && strcmp(f->key, key) == 0) return f;
+    }
+    return NULL;
+}
+
+static int add_waiter(sc_flight *f, sc_callback callback, void *user) {
+    sc_waiter *w = (sc_waiter *)malloc(sizeof(sc_waiter));
+    if (!w) return SF_ENOMEM;
+    w->callback = callback;
+    w->user = user;
+    w->next = NULL;
+    *f->waiters_tail = w;
+    f->waiters_tail = &w->next;
+    return SF_OK;
+}
+
+static void free_flight(sc_flight *f) {
+    for (sc_waiter *w = f->waiters; w;) {
+        sc_waiter *next = w->next;
+        free(w);
+        w = next;
+    }
+    free(f);
+}
+
+/* Replace an entry's body with a fresh response and persist it */
+static sc_entry *store_response(sc_cache *c, sc_flight *f, const sf_result *r) {
+    char *owned = (char *)malloc(r->size + 1);
+    if (!owned) return NULL;
+    memcpy(owned, r->body, r->size);
+    owned[r->size] = '\0';
+    sc_entry *e = find(c, f->hash, f->key);
+    if (e) {
+        release_body(c, e);
+        touch(c, e);
+    } else if (!(e = insert(c, f->hash, f->key, f->source))) {
+        free(owned);
+        return NULL;
+    }
+    e->owned = owned;
+    e->body = owned;
+    e->size = r->size;
+    e->status = r->status;
+    e->stored_at = wall_s();
+    copy_string(e->etag, sizeof(e->etag), r->etag);
+    copy_string(e->last_modified, sizeof(e->last_modified), r->last_modified);
+    c->bytes += e->size;
+    store_disk(c, e);
+    return e;
+}
+
+static void on_fetched(const sf_result *r, void *user) {
+    sc_flight *f = (sc_flight *)user;
+    sc_cache *c = f->cache;
+    for (sc_flight **link = &c->flights; *link; link = &(*link)->next) {
+        if (*link == f) {
+            *link = f->next;
+            break;
+        }
+    }
+    sc_entry *e = find(c, f->hash, f->key);
+    if (!e) e = load_disk(c, f->hash, f->key, f->source);
+    sc_outcome outcome;
+    const char *error = NULL;
+    if (!r->failed && r->status == 304 && e) {
+        e->stored_at = wall_s();
+        touch_disk(c, e);
+        outcome = SC_REVALIDATED;
+    } else if (!r->failed && r->status >= 200 && r->status < 300) {
+        sc_entry *stored = store_response(c, f, r);
+        if (stored) {
+            e = stored;
+            outcome = SC_FETCHED;
+        } else {
+            outcome = e ? SC_STALE : SC_FAILED;
+            error = "out of memory";
+        }
+    } else {
+        if (r->status == 429 || r->status == 503) close_source(c, f->source, r->retry_after_s);
+        outcome = e ? SC_STALE : SC_FAILED;
+        error = r->failed ? r->error : "unexpected HTTP status";
+    }
+    if (e) {
+        touch(c, e);
+        e->pins++;
+    }
+    for (sc_waiter *w = f->waiters; w; w = w->next) {
+        deliver(c, e, f->source, &f->query, outcome, r->status, error, w->callback, w->user);
+    }
+    if (e) e->pins--;
+    evict(c);
+    free_flight(f);
+}
+
+int sc_get(sc_cache *c, sf_source source, const sf_query *query,
+           sc_callback callback, void *user) {
+    if (!c || !query || !callback || (unsigned)source >= SF_SOURCE_COUNT) return SF_EINVAL;
+    char key[SC_KEY_MAX];
+    make_key(source, query, key);
+    uint64_t hash = hash_key(key);
+
+    sc_entry *e = find(c, hash, key);
+    if (e) {
+        touch(c, e);
+    } else if ((e = load_disk(c, hash, key, source))) {
+        e->pins++;
+        evict(c);
+        e->pins--;
+    }
+    if (e && wall_s() - e->stored_at < (int64_t)c->config.max_age_s[source]) {
+        deliver(c, e, source, query, SC_HIT, 0, NULL, callback, user);
+        return SC_HIT;
+    }
+
+    sc_flight *f = find_flight(c, hash, key);
+    if (f) {
+        if (add_waiter(f, callback, user) != SF_OK) return SF_ENOMEM;
+        c->stats.coalesced++;
+        return SC_PENDING;
+    }
+
+    if (!c->fetcher) {
+        sc_outcome outcome = e ? SC_STALE : SC_FAILED;
+        deliver(c, e, source, query, outcome, 0, "offline", callback, user);
+        return (int)outcome;
+    }
+    if (!take_token(c, source)) {
+        sc_outcome outcome = e ? SC_STALE : SC_RATE_LIMITED;
+        c->stats.refused[source]++;
+        deliver(c, e, source, query, outcome, 0, "rate limited", callback, user);
+        return (int)outcome;
+    }
+
+    f = (sc_flight *)calloc(1, sizeof(sc_flight));
+    if (!f) return SF_ENOMEM;
+    f->cache = c;
+    f->hash = hash;
+    copy_string(f->key, sizeof(f->key), key);
+    f->source = source;
+    f->query = *query;
+    f->waiters_tail = &f->waiters;
+    if (add_waiter(f, callback, user) != SF_OK) {
+        free(f);
+        return SF_ENOMEM;
+    }
+    sf_validators v = { e && e->etag[0] ? e->etag : NULL,
+                        e && e->last_modified[0] ? e->last_modified : NULL };
+    if (sf_submit_if(c->fetcher, source, query, e ? &v : NULL, on_fetched, f) != SF_OK) {
+        free_flight(f);
+        sc_outcome outcome = e ? SC_STALE : SC_FAILED;
+        deliver(c, e, source, query, outcome, 0, "could not queue the request", callback, user);
+        return (int)outcome;
+    }
+    c->stats.sent[source]++;
+    f->next = c->flights;
+    c->flights = f;
+    return SC_PENDING;
+}
+
+sc_cache *sc_open(const sc_config *config, sf_fetcher *fetcher) {
+    sc_cache *c = (sc_cache *)calloc(1, sizeof(sc_cache));
+    if (!c) return NULL;
+    if (config) c->config = *config;
+    if (!c->config.max_entries) c->config.max_entries = 256;
+    if (!c->config.max_bytes) c->config.max_bytes = 64u << 20;
+    if (c->config.backoff_s <= 0) c->config.backoff_s = 60.0;
+    for (int s = 0; s < SF_SOURCE_COUNT; s++) {
+        if (c->config.max_age_s[s] <= 0) c->config.max_age_s[s] = DEFAULT_MAX_AGE_S[s];
+        if (c->config.rate_per_s[s] <= 0) c->config.rate_per_s[s] = DEFAULT_RATE_PER_S[s];
+        if (c->config.burst[s] < 1) c->config.burst[s] = DEFAULT_BURST[s];
+        c->budgets[s].tokens = c->config.burst[s];
+        c->budgets[s].refilled_ns = now_ns();
+    }
+    size_t buckets = 16;
+    while (buckets < c->config.max_entries * 2) buckets *= 2;
+    c->buckets = (sc_entry **)calloc(buckets, sizeof(sc_entry *));
+    c->bucket_mask = buckets - 1;
+    if (!c->buckets) goto fail;
+    if (c->config.dir) {
+        c->dir = strdup(c->config.dir);
+        if (!c->dir || make_dirs(c->dir) != 0) goto fail;
+    }
+    c->config.dir = c->dir;
+    c->fetcher = fetcher;
+    return c;
+fail:
+    free(c->buckets);
+    free(c->dir);
+    free(c);
+    return NULL;
+}
+
+void sc_close(sc_cache *c) {
+    if (!c) return;
+    while (c->lru_head) drop_entry(c, c->lru_head);
+    for (sc_flight *f = c->flights; f;) {
+        sc_flight *next = f->next;
+        free_flight(f);
+        f = next;
+    }
+    free(c->buckets);
+    free(c->dir);
+    free(c);
+}
+
+void sc_stats_get(const sc_cache *c, sc_stats *stats) {
+    *stats = c->stats;
+}
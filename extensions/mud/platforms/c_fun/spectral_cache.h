@@ -0,0 +1,105 @@
+/**
+ * spectral_cache: a response cache in front of spectral_fetch, shared by every instance.
+ *
+ *   sc_cache *c = sc_open(&(sc_config){ .dir = "build/spectral_cache" }, fetcher);
+ *   sc_get(c, SF_EMIT, &query, on_spectrum, zone);   a hit calls back before returning
+ *   ... sf_poll(fetcher, 0) delivers fetched and revalidated entries ...
+ *   sc_close(c);
+ *
+ * Entries are addressed by a hash of their source, coordinates (rounded to 1e-4 degrees) and
+ * wavelength band (rounded to 0.1 nm), so instances at one location share them. Lookups go
+ * to an in-memory LRU first, then to the on-disk store: one file per entry, named by the
+ * key hash and mapped read-only, so a disk hit costs an open and an mmap rather than a copy.
+ *
+ * An entry younger than its source's max age is a hit and never touches the network. An
+ * older one is revalidated with If-None-Match / If-Modified-Since, and a 304 only refreshes
+ * its timestamp. Concurrent lookups of one key share a single request. Each source has a
+ * token bucket, and a 429 or 503 with Retry-After closes that source for as long as it asks.
+ * A lookup that may not fetch, or whose fetch fails, is served the stale entry if there is
+ * one.
+ *
+ * Not thread-safe: call sc_get, and sf_poll on the cache's fetcher, from one thread. Callbacks
+ * run on that thread, and a result's body is valid only during its callback. Destroy the
+ * fetcher (or drain it) before sc_close. The on-disk format is native-endian and meant for
+ * this machine only.
+ */
+#ifndef SPECTRAL_CACHE_H
+#define SPECTRAL_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spectral_fetch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    SC_HIT = 0,         /* fresh in memory or on disk */
+    SC_REVALIDATED,     /* stale, and the server answered 304 */
+    SC_FETCHED,         /* fetched and stored */
+    SC_STALE,           /* stale, served because the fetch was refused or failed */
+    SC_RATE_LIMITED,    /* nothing cached and the source's budget is spent */
+    SC_FAILED,          /* nothing cached and the fetch failed */
+    SC_PENDING          /* sc_get only: the callback runs later, from sf_poll */
+} sc_outcome;
+
+typedef struct {
+    sf_source source;
+    sc_outcome outcome;
+    long status;                /* HTTP status of the stored response, or of the failure */
+    const char *body;           /* NULL when nothing is cached; not NUL-terminated */
+    size_t size;
+    double age_s;               /* since the entry was last fetched or revalidated */
+    const char *error;          /* why a fetch failed or was refused; a static string */
+    const sf_query *query;
+} sc_result;
+
+typedef void (*sc_callback)(const sc_result *result, void *user);
+
+typedef struct {
+    const char *dir;            /* on-disk store, created if missing; NULL for memory only */
+    size_t max_entries;         /* in memory; 0 for 256 */
+    size_t max_bytes;           /* bodies in memory; 0 for 64 MiB */
+    double max_age_s[SF_SOURCE_COUNT];  /* 0 for 1 day (PSG), 6 h (EMIT), 1 h (Earthdata) */
+    double rate_per_s[SF_SOURCE_COUNT]; /* request budget; 0 for 0.5/s (PSG), 5/s (CMR) */
+    double burst[SF_SOURCE_COUNT];      /* 0 for 4 (PSG), 10 (CMR) */
+    double backoff_s;           /* after a 429/503 without Retry-After; 0 for 60 */
+} sc_config;
+
+typedef struct {
+    uint64_t hits;              /* SC_HIT */
+    uint64_t disk_loads;        /* entries mapped in from disk */
+    uint64_t revalidated;
+    uint64_t fetched;
+    uint64_t stale;
+    uint64_t rate_limited;
+    uint64_t failed;
+    uint64_t coalesced;         /* lookups that joined a request already in flight */
+    uint64_t evicted;
+    uint64_t sent[SF_SOURCE_COUNT];     /* requests sent per source */
+    uint64_t refused[SF_SOURCE_COUNT];  /* requests the budget refused per source */
+} sc_stats;
+
+typedef struct sc_cache sc_cache;
+
+/* Open a cache over `fetcher` (which may be NULL: cached entries only). NULL on error. */
+sc_cache *sc_open(const sc_config *config, sf_fetcher *fetcher);
+
+void sc_close(sc_cache *cache);
+
+/* Look up one source for a query. Returns the outcome if the callback has already run, or
+ * SC_PENDING if it will run from sf_poll. SF_EINVAL for bad arguments (no callback). */
+int sc_get(sc_cache *cache, sf_source source, const sf_query *query,
+           sc_callback callback, void *user);
+
+void sc_stats_get(const sc_cache *cache, sc_stats *stats);
+
+const char *sc_outcome_name(sc_outcome outcome);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
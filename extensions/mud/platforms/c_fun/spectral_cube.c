@@ -0,0 +1,370 @@
+/**
+ * spectral_cube: the ENVI header parser, the mapping and the tile streamer behind
+ * spectral_cube.h.
+ */
+#define _DEFAULT_SOURCE     /* madvise */
+#include "spectral_cube.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CUBE_HEADER_MAX (1u << 20)
+
+static int host_big_endian(void) {
+    const uint16_t one = 1;
+    return *(const unsigned char *)&one == 0;
+}
+
+static size_t type_size(int type) {
+    switch (type) {
+    case CUBE_U8: return 1;
+    case CUBE_I16: case CUBE_U16: return 2;
+    case CUBE_I32: case CUBE_U32: case CUBE_F32: return 4;
+    case CUBE_F64: return 8;
+    default: return 0;
+    }
+}
+
+/* ---- Header ---- */
+
+static char *read_file(const char *path, size_t max) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    char *text = (char *)malloc(max + 1);
+    size_t n = text ? fread(text, 1, max, f) : 0;
+    int complete = text && feof(f);
+    fclose(f);
+    if (!complete) {
+        free(text);
+        return NULL;
+    }
+    text[n] = '\0';
+    return text;
+}
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) *--end = '\0';
+    return s;
+}
+
+/* Parse "{ a, b, c }" into up to n floats; returns how many were read */
+static size_t parse_list(const char *value, float *out, size_t n) {
+    const char *p = value;
+    if (*p == '{') p++;
+    size_t count = 0;
+    while (count < n) {
+        char *end;
+        double v = strtod(p, &end);
+        if (end == p) break;
+        out[count++] = (float)v;
+        p = end;
+        while (*p == ',' || isspace((unsigned char)*p)) p++;
+    }
+    return count;
+}
+
+typedef struct {
+    size_t samples, lines, bands, offset;
+    int type, byte_order, interleave;
+    char *wavelengths;          /* the raw "{...}" value, parsed once bands is known */
+    int micrometers;
+    int has_ignore;
+    double ignore_value;
+} envi_header;
+
+static int parse_header(char *text, envi_header *h) {
+    memset(h, 0, sizeof(*h));
+    h->type = -1;
+    h->interleave = -1;
+    char *p = text;
+    while (isspace((unsigned char)*p)) p++;
+    if (strncmp(p, "ENVI", 4) != 0) return CUBE_EFORMAT;
+    /* Braced lists such as the wavelengths span lines; put each on one line */
+    int depth = 0;
+    for (char *q = p; *q; q++) {
+        if (*q == '{') depth++;
+        else if (*q == '}' && depth) depth--;
+        else if (depth && (*q == '\n' || *q == '\r')) *q = ' ';
+    }
+    while (*p) {
+        char *line = p;
+        char *eq;
+        p += strcspn(p, "\n");
+        if (*p) *p++ = '\0';
+        if (!(eq = strchr(line, '='))) continue;
+        *eq = '\0';
+        char *key = trim(line), *value = trim(eq + 1);
+        if (strcasecmp(key, "samples") == 0) {
+            h->samples = strtoull(value, NULL, 10);
+        } else if (strcasecmp(key, "lines") == 0) {
+            h->lines = strtoull(value, NULL, 10);
+        } else if (strcasecmp(key, "bands") == 0) {
+            h->bands = strtoull(value, NULL, 10);
+        } else if (strcasecmp(key, "header offset") == 0) {
+            h->offset = strtoull(value, NULL, 10);
+        } else if (strcasecmp(key, "data type") == 0) {
+            h->type = atoi(value);
+        } else if (strcasecmp(key, "byte order") == 0) {
+            h->byte_order = atoi(value);
+        } else if (strcasecmp(key, "interleave") == 0) {
+            h->interleave = strcasecmp(value, "bsq") == 0 ? CUBE_BSQ
+                          : strcasecmp(value, "bil") == 0 ? CUBE_BIL
+                          : strcasecmp(value, "bip") == 0 ? CUBE_BIP : -1;
+        } else if (strcasecmp(key, "wavelength") == 0) {
+            h->wavelengths = value;
+        } else if (strcasecmp(key, "wavelength units") == 0) {
+            h->micrometers = strncasecmp(value, "micro", 5) == 0 || strcasecmp(value, "um") == 0;
+        } else if (strcasecmp(key, "data ignore value") == 0) {
+            h->has_ignore = 1;
+            h->ignore_value = strtod(value, NULL);
+        }
+    }
+    if (!h->samples || !h->lines || !h->bands || !type_size(h->type) || h->interleave < 0) {
+        return CUBE_EFORMAT;
+    }
+    return CUBE_OK;
+}
+
+/* Find the header next to `path`: path itself if it ends in .hdr, else path.hdr, else path
+ * with its extension replaced. Fills raw with the data file's path. */
+static char *find_header(const char *path, char *raw, size_t cap) {
+    size_t len = strlen(path);
+    char hdr[4096];
+    if (len + 5 > sizeof(hdr) || len + 1 > cap) return NULL;
+    if (len > 4 && strcasecmp(path + len - 4, ".hdr") == 0) {
+        /* The raw file is the header's name without .hdr, or with a common data extension */
+        static const char *const exts[] = { "", ".img", ".dat", ".raw", ".bsq", ".bil", ".bip" };
+        for (size_t i = 0; i < sizeof(exts) / sizeof(exts[0]); i++) {
+            snprintf(raw, cap, "%.*s%s", (int)(len - 4), path, exts[i]);
+            if (access(raw, R_OK) == 0) return read_file(path, CUBE_HEADER_MAX);
+        }
+        return NULL;
+    }
+    snprintf(raw, cap, "%s", path);
+    snprintf(hdr, sizeof(hdr), "%s.hdr", path);
+    char *text = read_file(hdr, CUBE_HEADER_MAX);
+    if (text) return text;
+    const char *dot = strrchr(path, '.'), *slash = strrchr(path, '/');
+    if (!dot || (slash && dot < slash)) return NULL;
+    snprintf(hdr, sizeof(hdr), "%.*s.hdr", (int)(dot - path), path);
+    return read_file(hdr, CUBE_HEADER_MAX);
+}
+
+/* ---- Open / close ---- */
+
+int cube_open(cube *c, const char *path) {
+    if (!c || !path) return CUBE_EINVAL;
+    memset(c, 0, sizeof(*c));
+    char raw[4096];
+    char *text = find_header(path, raw, sizeof(raw));
+    if (!text) return CUBE_EFORMAT;
+    envi_header h;
+    int rc = parse_header(text, &h);
+    if (rc != CUBE_OK) {
+        free(text);
+        return rc;
+    }
+    c->samples = h.samples;
+    c->lines = h.lines;
+    c->bands = h.bands;
+    c->interleave = (cube_interleave)h.interleave;
+    c->type = (cube_type)h.type;
+    c->element_size = type_size(h.type);
+    c->swap = h.byte_order != host_big_endian() && c->element_size > 1;
+    c->has_ignore = h.has_ignore;
+    c->ignore_value = h.ignore_value;
+    if (h.wavelengths) {
+        c->wavelengths_nm = (float *)malloc(c->bands * sizeof(float));
+        if (c->wavelengths_nm && parse_list(h.wavelengths, c->wavelengths_nm, c->bands) == c->bands) {
+            for (size_t b = 0; h.micrometers && b < c->bands; b++) c->wavelengths_nm[b] *= 1000.0f;
+        } else {
+            free(c->wavelengths_nm);
+            c->wavelengths_nm = NULL;
+        }
+    }
+    free(text);
+
+    int fd = open(raw, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        cube_close(c);
+        return CUBE_EIO;
+    }
+    /* The header's dimensions are untrusted; a product that wraps would pass the size check
+     * and let the readers walk off the end of the mapping */
+    struct stat st;
+    size_t need;
+    int overflow = __builtin_mul_overflow(c->samples, c->lines, &need) ||
+                    __builtin_mul_overflow(need, c->bands, &need) ||
+                    __builtin_mul_overflow(need, c->element_size, &need) ||
+                    __builtin_add_overflow(need, h.offset, &need);
+    if (overflow || fstat(fd, &st) != 0 || (size_t)st.st_size < need) {
+        close(fd);
+        cube_close(c);
+        return CUBE_EFORMAT;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        cube_close(c);
+        return CUBE_EIO;
+    }
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    c->map = map;
+    c->map_len = (size_t)st.st_size;
+    c->data = (const unsigned char *)map + h.offset;
+    return CUBE_OK;
+}
+
+void cube_close(cube *c) {
+    if (!c) return;
+    if (c->map) munmap(c->map, c->map_len);
+    free(c->wavelengths_nm);
+    memset(c, 0, sizeof(*c));
+}
+
+size_t cube_band_near(const cube *c, double nm) {
+    size_t best = 0;
+    for (size_t b = 1; c->wavelengths_nm && b < c->bands; b++) {
+        if (fabs(c->wavelengths_nm[b] - nm) < fabs(c->wavelengths_nm[best] - nm)) best = b;
+    }
+    return best;
+}
+
+/* ---- Tiles ---- */
+
+static void strides(const cube *c, size_t *line, size_t *band, size_t *sample) {
+    size_t es = c->element_size;
+    switch (c->interleave) {
+    case CUBE_BSQ:
+        *sample = es;
+        *line = c->samples * es;
+        *band = c->lines * c->samples * es;
+        break;
+    case CUBE_BIL:
+        *sample = es;
+        *band = c->samples * es;
+        *line = c->bands * c->samples * es;
+        break;
+    default:
+        *band = es;
+        *sample = c->bands * es;
+        *line = c->samples * c->bands * es;
+        break;
+    }
+}
+
+/* Apply advice to the whole pages under [from, to) of the sample data */
+static void advise(const cube *c, size_t from, size_t to, int advice) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t base = (size_t)(c->data - (const unsigned char *)c->map);
+    size_t start = (base + from) / page * page;
+    size_t end = (base + to) / page * page;
+    if (advice == MADV_WILLNEED) end = (base + to + page - 1) / page * page;
+    if (end > c->map_len) end = c->map_len;
+    if (end > start) madvise((unsigned char *)c->map + start, end - start, advice);
+}
+
+/* The byte ranges a tile covers: one for BIL and BIP, one per band for BSQ */
+static void advise_tile(const cube_tile *t, int advice) {
+    const cube *c = t->cube;
+    if (c->interleave == CUBE_BSQ) {
+        for (size_t b = t->band0; b < t->band0 + t->bands; b++) {
+            advise(c, b * t->band_stride + t->line0 * t->line_stride,
+                   b * t->band_stride + (t->line0 + t->lines) * t->line_stride, advice);
+        }
+    } else {
+        advise(c, t->line0 * t->line_stride, (t->line0 + t->lines) * t->line_stride, advice);
+    }
+}
+
+int cube_stream(const cube *c, const cube_stream_opts *opts, cube_tile_fn fn, void *user) {
+    if (!c || !c->map || !fn) return CUBE_EINVAL;
+    cube_stream_opts o = opts ? *opts : (cube_stream_opts){ 0 };
+    if (!o.tile_lines) o.tile_lines = 64;
+    if (o.line0 >= c->lines || o.band0 >= c->bands) return CUBE_EINVAL;
+    if (!o.lines || o.line0 + o.lines > c->lines) o.lines = c->lines - o.line0;
+    if (!o.bands || o.band0 + o.bands > c->bands) o.bands = c->bands - o.band0;
+
+    cube_tile t = { .cube = c, .band0 = o.band0, .bands = o.bands };
+    strides(c, &t.line_stride, &t.band_stride, &t.sample_stride);
+    for (size_t line = o.line0; line < o.line0 + o.lines; line += o.tile_lines) {
+        t.line0 = line;
+        t.lines = o.line0 + o.lines - line < o.tile_lines ? o.line0 + o.lines - line : o.tile_lines;
+        t.origin = c->data + t.line0 * t.line_stride + t.band0 * t.band_stride;
+        advise_tile(&t, MADV_WILLNEED);
+        int rc = fn(&t, user);
+        advise_tile(&t, MADV_DONTNEED);
+        if (rc) return rc;
+    }
+    return CUBE_OK;
+}
+
+static inline uint16_t load16(const unsigned char *p, int swap) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return swap ? __builtin_bswap16(v) : v;
+}
+
+static inline uint32_t load32(const unsigned char *p, int swap) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+static inline uint64_t load64(const unsigned char *p, int swap) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return swap ? __builtin_bswap64(v) : v;
+}
+
+const float *cube_tile_row(const cube_tile *t, size_t line, size_t band, float *scratch) {
+    const cube *c = t->cube;
+    const unsigned char *p = t->origin + line * t->line_stride + band * t->band_stride;
+    size_t n = c->samples, ss = t->sample_stride;
+    int swap = c->swap;
+    if (c->type == CUBE_F32 && !swap && ss == sizeof(float) && ((uintptr_t)p % sizeof(float)) == 0) {
+        return (const float *)(const void *)p;
+    }
+    switch (c->type) {
+    case CUBE_U8:
+        for (size_t s = 0; s < n; s++) scratch[s] = (float)p[s * ss];
+        break;
+    case CUBE_I16:
+        for (size_t s = 0; s < n; s++) scratch[s] = (float)(int16_t)load16(p + s * ss, swap);
+        break;
+    case CUBE_U16:
+        for (size_t s = 0; s < n; s++) scratch[s] = (float)load16(p + s * ss, swap);
+        break;
+    case CUBE_I32:
+        for (size_t s = 0; s < n; s++) scratch[s] = (float)(int32_t)load32(p + s * ss, swap);
+        break;
+    case CUBE_U32:
+        for (size_t s = 0; s < n; s++) scratch[s] = (float)load32(p + s * ss, swap);
+        break;
+    case CUBE_F32:
+        for (size_t s = 0; s < n; s++) {
+            uint32_t bits = load32(p + s * ss, swap);
+            memcpy(&scratch[s], &bits, sizeof(float));
+        }
+        break;
+    case CUBE_F64:
+        for (size_t s = 0; s < n; s++) {
+            uint64_t bits = load64(p + s * ss, swap);
+            double v;
+            memcpy(&v, &bits, sizeof(v));
+            scratch[s] = (float)v;
+        }
+        break;
+    }
+    return scratch;
+}
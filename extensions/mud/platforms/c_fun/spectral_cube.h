@@ -0,0 +1,109 @@
+/**
+ * spectral_cube: zero-copy, tile-at-a-time access to whole spectral scenes.
+ *
+ *   cube c;
+ *   if (cube_open(&c, "emit_reflectance.hdr") == CUBE_OK) {
+ *       cube_stream_opts o = { .tile_lines = 64, .band0 = b, .bands = 3 };
+ *       cube_stream(&c, &o, on_tile, &stats);        on_tile sees one cube_tile at a time
+ *       cube_close(&c);
+ *   }
+ *
+ * Scenes are ENVI cubes: a raw file in BSQ, BIL or BIP order plus its text header. EMIT
+ * granules ship as NetCDF4, with chunking and compression that rule out mapping the samples
+ * in place. Export the reflectance variable once, for example with
+ * `gdal_translate -of ENVI NETCDF:granule.nc:reflectance scene.img`.
+ *
+ * The raw file is mapped read-only and never decoded wholesale. A tile is a view of
+ * `tile_lines` full scene lines and a run of bands, in band-interleaved-by-line order
+ * (line, then band, then sample). The view is a base pointer plus three byte strides, so it
+ * is zero-copy whatever the file's interleave. cube_tile_row() hands back one band of one
+ * line as floats. That is a pointer straight into the map when the file is native-endian
+ * float32 with adjacent samples, and a caller-sized scratch row otherwise.
+ *
+ * cube_stream() prefetches each tile before the callback sees it. Once the callback
+ * returns, it drops the tile's pages from the process (they stay in the page cache), so
+ * resident memory stays near one tile however large the scene. A cube may be
+ * streamed from several threads at once over disjoint line ranges.
+ */
+#ifndef SPECTRAL_CUBE_H
+#define SPECTRAL_CUBE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CUBE_OK 0
+#define CUBE_EINVAL -1      /* bad arguments */
+#define CUBE_EIO -2         /* cannot open or map a file */
+#define CUBE_EFORMAT -3     /* header missing, malformed or describing a different file size */
+
+typedef enum { CUBE_BSQ = 0, CUBE_BIL = 1, CUBE_BIP = 2 } cube_interleave;
+
+/* ENVI "data type" codes understood here */
+typedef enum {
+    CUBE_U8 = 1, CUBE_I16 = 2, CUBE_I32 = 3, CUBE_F32 = 4, CUBE_F64 = 5,
+    CUBE_U16 = 12, CUBE_U32 = 13
+} cube_type;
+
+typedef struct {
+    size_t samples;             /* pixels per line */
+    size_t lines;
+    size_t bands;
+    cube_interleave interleave;
+    cube_type type;
+    size_t element_size;
+    int swap;                   /* file byte order differs from this machine's */
+    float *wavelengths_nm;      /* per band, or NULL if the header lists none */
+    int has_ignore;
+    double ignore_value;        /* "data ignore value": no-data samples */
+    const unsigned char *data;  /* first sample, after the header offset */
+    /* Private: */
+    void *map;
+    size_t map_len;
+} cube;
+
+typedef struct {
+    const cube *cube;
+    size_t line0, lines;
+    size_t band0, bands;
+    const unsigned char *origin;    /* sample 0 of line0, band0 */
+    size_t line_stride;             /* bytes between lines */
+    size_t band_stride;             /* bytes between bands */
+    size_t sample_stride;           /* bytes between samples */
+} cube_tile;
+
+typedef struct {
+    size_t tile_lines;          /* lines per tile; 0 for 64 */
+    size_t line0;               /* first line; lines 0 for the rest of the scene */
+    size_t lines;
+    size_t band0;               /* first band; bands 0 for all from band0 */
+    size_t bands;
+} cube_stream_opts;
+
+/* Called once per tile: return nonzero to stop streaming. */
+typedef int (*cube_tile_fn)(const cube_tile *tile, void *user);
+
+/* Open `path`, either the header (*.hdr) or the raw file. The header is looked for as
+ * path.hdr and then with path's extension replaced by .hdr. */
+int cube_open(cube *c, const char *path);
+
+void cube_close(cube *c);
+
+/* The band whose wavelength is closest to nm, or 0 if the cube lists no wavelengths. */
+size_t cube_band_near(const cube *c, double nm);
+
+/* Stream tiles through fn. CUBE_OK, or the first nonzero value fn returned, or CUBE_EINVAL. */
+int cube_stream(const cube *c, const cube_stream_opts *opts, cube_tile_fn fn, void *user);
+
+/* One line (relative to the tile) of one band (relative to the tile) as tile->cube->samples
+ * floats, either in place or decoded into scratch, which must hold that many. */
+const float *cube_tile_row(const cube_tile *tile, size_t line, size_t band, float *scratch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,508 @@
+/**
+ * spectral_fetch: the libcurl multi loop behind spectral_fetch.h.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "spectral_fetch.h"
+
+#include <ctype.h>
+#include <curl/curl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define SF_IDLE_HANDLES 16
+
+static const char *const DEFAULT_URLS[SF_SOURCE_COUNT] = {
+    "https://psg.gsfc.nasa.gov/api.php",
+    "https://cmr.earthdata.nasa.gov/search/granules.json",
+    "https://cmr.earthdata.nasa.gov/search/collections.json",
+};
+
+static const char *const SOURCE_NAMES[SF_SOURCE_COUNT] = { "PSG", "EMIT", "Earthdata" };
+
+/* One request, from submission until its callback has run */
+typedef struct sf_job {
+    struct sf_job *next;
+    sf_source source;
+    sf_query query;
+    sf_callback callback;
+    void *user;
+    char *url;
+    char *post;                 /* form body, or NULL for GET */
+    CURL *easy;
+    struct curl_slist *headers;
+    char *body;
+    size_t size;
+    size_t capacity;
+    size_t limit;               /* config.max_body */
+    char etag[128];
+    char last_modified[64];
+    long retry_after_s;
+    uint64_t started_ns;
+    sf_result result;
+    char error[CURL_ERROR_SIZE];
+} sf_job;
+
+typedef struct {
+    sf_job *head;
+    sf_job *tail;
+    size_t count;
+} sf_list;
+
+struct sf_fetcher {
+    sf_config config;
+    char *token_header;         /* "Authorization: Bearer ...", or NULL */
+    CURLM *multi;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t done_cond;
+    sf_list submitted;          /* guarded by lock */
+    sf_list done;               /* guarded by lock */
+    size_t pending;             /* guarded by lock */
+    int stopping;               /* guarded by lock */
+    /* Owned by the fetcher thread: */
+    sf_list active;
+    CURL *idle[SF_IDLE_HANDLES];
+    size_t idle_count;
+};
+
+static pthread_once_t global_once = PTHREAD_ONCE_INIT;
+static CURLcode global_status = CURLE_FAILED_INIT;
+
+static void global_init(void) {
+    global_status = curl_global_init(CURL_GLOBAL_DEFAULT);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void list_push(sf_list *list, sf_job *job) {
+    job->next = NULL;
+    if (list->tail) {
+        list->tail->next = job;
+    } else {
+        list->head = job;
+    }
+    list->tail = job;
+    list->count++;
+}
+
+static sf_job *list_take_all(sf_list *list) {
+    sf_job *head = list->head;
+    list->head = list->tail = NULL;
+    list->count = 0;
+    return head;
+}
+
+static void list_remove(sf_list *list, sf_job *job) {
+    sf_job *prev = NULL;
+    for (sf_job *j = list->head; j; prev = j, j = j->next) {
+        if (j != job) continue;
+        if (prev) {
+            prev->next = j->next;
+        } else {
+            list->head = j->next;
+        }
+        if (list->tail == j) list->tail = prev;
+        list->count--;
+        return;
+    }
+}
+
+static void free_job(sf_job *job) {
+    curl_slist_free_all(job->headers);
+    free(job->url);
+    free(job->post);
+    free(job->body);
+    free(job);
+}
+
+const char *sf_source_name(sf_source source) {
+    return (unsigned)source < SF_SOURCE_COUNT ? SOURCE_NAMES[source] : "unknown";
+}
+
+static size_t on_body(char *data, size_t size, size_t n, void *user) {
+    sf_job *job = (sf_job *)user;
+    size_t bytes = size * n;
+    if (job->size + bytes > job->limit) return 0;
+    if (job->size + bytes + 1 > job->capacity) {
+        size_t grown = job->capacity ? job->capacity : 4096;
+        while (grown < job->size + bytes + 1) grown *= 2;
+        char *body = (char *)realloc(job->body, grown);
+        if (!body) return 0;
+        job->body = body;
+        job->capacity = grown;
+    }
+    memcpy(job->body + job->size, data, bytes);
+    job->size += bytes;
+    job->body[job->size] = '\0';
+    return bytes;
+}
+
+/* Copy a header's value if `line` is that header; the value is trimmed and may be cut short */
+static int header_value(const char *line, size_t len, const char *name, char *out, size_t cap) {
+    size_t name_len = strlen(name);
+    if (len <= name_len || line[name_len] != ':' || strncasecmp(line, name, name_len) != 0) return 0;
+    const char *v = line + name_len + 1, *end = line + len;
+    while (v < end && isspace((unsigned char)*v)) v++;
+    while (end > v && isspace((unsigned char)end[-1])) end--;
+    size_t n = (size_t)(end - v) < cap - 1 ? (size_t)(end - v) : cap - 1;
+    memcpy(out, v, n);
+    out[n] = '\0';
+    return 1;
+}
+
+static size_t on_header(char *line, size_t size, size_t n, void *user) {
+    sf_job *job = (sf_job *)user;
+    size_t len = size * n;
+    char retry[32];
+    if (len > 5 && strncmp(line, "HTTP/", 5) == 0) {
+        /* A new response (after a redirect or 100 Continue): forget the last one's headers */
+        job->etag[0] = job->last_modified[0] = '\0';
+        job->retry_after_s = 0;
+    } else if (!header_value(line, len, "ETag", job->etag, sizeof(job->etag)) &&
+               !header_value(line, len, "Last-Modified", job->last_modified,
+                             sizeof(job->last_modified)) &&
+               header_value(line, len, "Retry-After", retry, sizeof(retry))) {
+        /* Only the delta-seconds form; an HTTP date leaves it to the caller's backoff */
+        job->retry_after_s = strtol(retry, NULL, 10);
+    }
+    return len;
+}
+
+static int add_header(sf_job *job, const char *name, const char *value) {
+    char line[256];
+    int n = snprintf(line, sizeof(line), "%s: %s", name, value);
+    if (n < 0 || (size_t)n >= sizeof(line)) return SF_EINVAL;
+    struct curl_slist *headers = curl_slist_append(job->headers, line);
+    if (!headers) return SF_ENOMEM;
+    job->headers = headers;
+    return SF_OK;
+}
+
+/* Build the URL (and for PSG, the form body) for a query on the submitting thread */
+static int format_request(sf_fetcher *f, sf_job *job) {
+    const char *base = f->config.urls[job->source] ? f->config.urls[job->source]
+                                                   : DEFAULT_URLS[job->source];
+    const sf_query *q = &job->query;
+    char buf[1024];
+    int n;
+    switch (job->source) {
+    case SF_PSG: {
+        /* PSG takes its configuration file as a form field; ask for radiance over the band */
+        n = snprintf(buf, sizeof(buf),
+                     "<OBJECT>Earth\n<GEOMETRY>Lookingup\n"
+                     "<OBJECT-OBS-LATITUDE>%.6f\n<OBJECT-OBS-LONGITUDE>%.6f\n"
+                     "<GENERATOR-RANGE1>%.1f\n<GENERATOR-RANGE2>%.1f\n<GENERATOR-RANGEUNIT>nm\n",
+                     q->latitude, q->longitude, q->band_min_nm, q->band_max_nm);
+        if (n < 0 || (size_t)n >= sizeof(buf)) return SF_ENOMEM;
+        char *file = curl_easy_escape(NULL, buf, n);
+        if (!file) return SF_ENOMEM;
+        size_t len = strlen(file) + sizeof("type=rad&whdr=n&file=");
+        job->post = (char *)malloc(len);
+        if (job->post) snprintf(job->post, len, "type=rad&whdr=n&file=%s", file);
+        curl_free(file);
+        if (!job->post) return SF_ENOMEM;
+        job->url = strdup(base);
+        break;
+    }
+    case SF_EMIT:
+        /* The newest EMIT L2A surface reflectance granule covering the point */
+        n = snprintf(buf, sizeof(buf),
+                     "%s?short_name=EMITL2ARFL&point=%.6f,%.6f&sort_key=-start_date&page_size=1",
+                     base, q->longitude, q->latitude);
+        if (n < 0 || (size_t)n >= sizeof(buf)) return SF_ENOMEM;
+        job->url = strdup(buf);
+        break;
+    default:
+        n = snprintf(buf, sizeof(buf),
+                     "%s?keyword=spectral%%20reflectance&point=%.6f,%.6f&page_size=1",
+                     base, q->longitude, q->latitude);
+        if (n < 0 || (size_t)n >= sizeof(buf)) return SF_ENOMEM;
+        job->url = strdup(buf);
+        break;
+    }
+    if (!job->url) return SF_ENOMEM;
+    if (job->source != SF_PSG && f->token_header) {
+        job->headers = curl_slist_append(NULL, f->token_header);
+        if (!job->headers) return SF_ENOMEM;
+    }
+    return SF_OK;
+}
+
+static CURL *take_handle(sf_fetcher *f) {
+    if (f->idle_count) return f->idle[--f->idle_count];
+    return curl_easy_init();
+}
+
+/* Reset keeps the handle's DNS and session caches; connections live in the multi handle */
+static void return_handle(sf_fetcher *f, CURL *easy) {
+    if (f->idle_count < SF_IDLE_HANDLES) {
+        curl_easy_reset(easy);
+        f->idle[f->idle_count++] = easy;
+    } else {
+        curl_easy_cleanup(easy);
+    }
+}
+
+static void finish(sf_fetcher *f, sf_job *job, CURLcode code) {
+    long status = 0;
+    if (job->easy) {
+        curl_easy_getinfo(job->easy, CURLINFO_RESPONSE_CODE, &status);
+        curl_multi_remove_handle(f->multi, job->easy);
+        return_handle(f, job->easy);
+        job->easy = NULL;
+    }
+    list_remove(&f->active, job);
+    job->result.source = job->source;
+    job->result.status = code == CURLE_OK ? status : 0;
+    job->result.failed = code != CURLE_OK;
+    job->result.error = code == CURLE_OK ? NULL : curl_easy_strerror(code);
+    job->result.detail = code != CURLE_OK && job->error[0] ? job->error : NULL;
+    job->result.body = job->body ? job->body : "";
+    job->result.size = job->size;
+    job->result.seconds = (double)(now_ns() - job->started_ns) * 1e-9;
+    job->result.query = &job->query;
+    job->result.etag = job->etag[0] ? job->etag : NULL;
+    job->result.last_modified = job->last_modified[0] ? job->last_modified : NULL;
+    job->result.retry_after_s = job->retry_after_s;
+    pthread_mutex_lock(&f->lock);
+    list_push(&f->done, job);
+    pthread_cond_broadcast(&f->done_cond);
+    pthread_mutex_unlock(&f->lock);
+}
+
+static void start(sf_fetcher *f, sf_job *job) {
+    CURL *easy = take_handle(f);
+    list_push(&f->active, job);
+    if (!easy) {
+        finish(f, job, CURLE_OUT_OF_MEMORY);
+        return;
+    }
+    job->easy = easy;
+    job->limit = f->config.max_body;
+    curl_easy_setopt(easy, CURLOPT_URL, job->url);
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, job);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, on_body);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, job);
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, on_header);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, job);
+    curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, job->error);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(easy, CURLOPT_USERAGENT, "matic-belt-spectral/1");
+    curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    /* Over TLS, wait for a connection being set up to the same host to offer HTTP/2
+     * multiplexing rather than opening another; plain HTTP never negotiates h2, so waiting
+     * there would only serialize the requests */
+    if (strncmp(job->url, "https://", 8) == 0) curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, f->config.timeout_ms);
+    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS, f->config.connect_timeout_ms);
+    if (job->headers) curl_easy_setopt(easy, CURLOPT_HTTPHEADER, job->headers);
+    if (job->post) curl_easy_setopt(easy, CURLOPT_POSTFIELDS, job->post);
+    CURLMcode added = curl_multi_add_handle(f->multi, easy);
+    if (added != CURLM_OK) finish(f, job, added == CURLM_OUT_OF_MEMORY ? CURLE_OUT_OF_MEMORY
+                                                                         : CURLE_FAILED_INIT);
+}
+
+static void *fetcher_main(void *arg) {
+    sf_fetcher *f = (sf_fetcher *)arg;
+    for (;;) {
+        pthread_mutex_lock(&f->lock);
+        int stopping = f->stopping;
+        sf_job *fresh = list_take_all(&f->submitted);
+        pthread_mutex_unlock(&f->lock);
+        if (stopping) {
+            while (fresh) {
+                sf_job *next = fresh->next;
+                free_job(fresh);
+                fresh = next;
+            }
+            break;
+        }
+        while (fresh) {
+            sf_job *next = fresh->next;
+            start(f, fresh);
+            fresh = next;
+        }
+
+        int running = 0;
+        curl_multi_perform(f->multi, &running);
+        CURLMsg *msg;
+        int left;
+        while ((msg = curl_multi_info_read(f->multi, &left))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            char *job = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &job);
+            finish(f, (sf_job *)job, msg->data.result);
+        }
+        /* Sleeps until a socket is ready, a timer is due or sf_submit wakes us */
+        curl_multi_poll(f->multi, NULL, 0, 1000, NULL);
+    }
+    for (sf_job *job = list_take_all(&f->active); job;) {
+        sf_job *next = job->next;
+        curl_multi_remove_handle(f->multi, job->easy);
+        curl_easy_cleanup(job->easy);
+        free_job(job);
+        job = next;
+    }
+    return NULL;
+}
+
+sf_fetcher *sf_create(const sf_config *config) {
+    pthread_once(&global_once, global_init);
+    if (global_status != CURLE_OK) return NULL;
+    sf_fetcher *f = (sf_fetcher *)calloc(1, sizeof(sf_fetcher));
+    if (!f) return NULL;
+    if (config) f->config = *config;
+    if (!f->config.timeout_ms) f->config.timeout_ms = 15000;
+    if (!f->config.connect_timeout_ms) f->config.connect_timeout_ms = 5000;
+    if (!f->config.max_host_connections) f->config.max_host_connections = 4;
+    if (!f->config.max_body) f->config.max_body = 8u << 20;
+    const char *token = f->config.earthdata_token ? f->config.earthdata_token
+                                                  : getenv("EARTHDATA_TOKEN");
+    if (token && *token) {
+        size_t len = strlen(token) + sizeof("Authorization: Bearer ");
+        f->token_header = (char *)malloc(len);
+        if (!f->token_header) goto fail;
+        snprintf(f->token_header, len, "Authorization: Bearer %s", token);
+    }
+    f->multi = curl_multi_init();
+    if (!f->multi) goto fail;
+    curl_multi_setopt(f->multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(f->multi, CURLMOPT_MAX_HOST_CONNECTIONS, f->config.max_host_connections);
+    curl_multi_setopt(f->multi, CURLMOPT_MAXCONNECTS, f->config.max_host_connections * SF_SOURCE_COUNT);
+    pthread_mutex_init(&f->lock, NULL);
+    pthread_cond_init(&f->done_cond, NULL);
+    if (pthread_create(&f->thread, NULL, fetcher_main, f) != 0) {
+        pthread_cond_destroy(&f->done_cond);
+        pthread_mutex_destroy(&f->lock);
+        goto fail;
+    }
+    return f;
+fail:
+    if (f->multi) curl_multi_cleanup(f->multi);
+    free(f->token_header);
+    free(f);
+    return NULL;
+}
+
+void sf_destroy(sf_fetcher *f) {
+    if (!f) return;
+    pthread_mutex_lock(&f->lock);
+    f->stopping = 1;
+    pthread_mutex_unlock(&f->lock);
+    curl_multi_wakeup(f->multi);
+    pthread_join(f->thread, NULL);
+    for (sf_job *job = list_take_all(&f->done); job;) {
+        sf_job *next = job->next;
+        free_job(job);
+        job = next;
+    }
+    for (size_t i = 0; i < f->idle_count; i++) curl_easy_cleanup(f->idle[i]);
+    curl_multi_cleanup(f->multi);
+    pthread_cond_destroy(&f->done_cond);
+    pthread_mutex_destroy(&f->lock);
+    free(f->token_header);
+    free(f);
+}
+
+int sf_submit_if(sf_fetcher *f, sf_source source, const sf_query *query,
+                 const sf_validators *validators, sf_callback callback, void *user) {
+    if (!f || !query || !callback || (unsigned)source >= SF_SOURCE_COUNT) return SF_EINVAL;
+    sf_job *job = (sf_job *)calloc(1, sizeof(sf_job));
+    if (!job) return SF_ENOMEM;
+    job->source = source;
+    job->query = *query;
+    job->callback = callback;
+    job->user = user;
+    int rc = format_request(f, job);
+    if (rc == SF_OK && validators && validators->etag) {
+        rc = add_header(job, "If-None-Match", validators->etag);
+    }
+    if (rc == SF_OK && validators && validators->last_modified) {
+        rc = add_header(job, "If-Modified-Since", validators->last_modified);
+    }
+    if (rc != SF_OK) {
+        free_job(job);
+        return rc;
+    }
+    job->started_ns = now_ns();
+    pthread_mutex_lock(&f->lock);
+    list_push(&f->submitted, job);
+    f->pending++;
+    pthread_mutex_unlock(&f->lock);
+    curl_multi_wakeup(f->multi);
+    return SF_OK;
+}
+
+int sf_submit(sf_fetcher *f, sf_source source, const sf_query *query,
+              sf_callback callback, void *user) {
+    return sf_submit_if(f, source, query, NULL, callback, user);
+}
+
+int sf_fetch_all(sf_fetcher *f, const sf_query *query, sf_callback callback, void *user) {
+    int rc = SF_OK;
+    for (int s = 0; s < SF_SOURCE_COUNT; s++) {
+        int one = sf_submit(f, (sf_source)s, query, callback, user);
+        if (one != SF_OK) rc = one;
+    }
+    return rc;
+}
+
+size_t sf_poll(sf_fetcher *f, size_t max) {
+    size_t ran = 0;
+    if (!f) return 0;
+    while (!max || ran < max) {
+        pthread_mutex_lock(&f->lock);
+        sf_job *job = f->done.head;
+        if (job) {
+            f->done.head = job->next;
+            if (!f->done.head) f->done.tail = NULL;
+            f->done.count--;
+        }
+        pthread_mutex_unlock(&f->lock);
+        if (!job) break;
+        job->callback(&job->result, job->user);
+        free_job(job);
+        ran++;
+        /* Only now is the request off the books, so sf_pending() covers running callbacks */
+        pthread_mutex_lock(&f->lock);
+        f->pending--;
+        pthread_mutex_unlock(&f->lock);
+    }
+    return ran;
+}
+
+size_t sf_wait(sf_fetcher *f, unsigned timeout_ms) {
+    if (!f) return 0;
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    deadline.tv_sec += timeout_ms / 1000 + deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+    pthread_mutex_lock(&f->lock);
+    while (!f->done.count && f->pending) {
+        if (pthread_cond_timedwait(&f->done_cond, &f->lock, &deadline) != 0) break;
+    }
+    size_t ready = f->done.count;
+    pthread_mutex_unlock(&f->lock);
+    return ready;
+}
+
+size_t sf_pending(sf_fetcher *f) {
+    if (!f) return 0;
+    pthread_mutex_lock(&f->lock);
+    size_t pending = f->pending;
+    pthread_mutex_unlock(&f->lock);
+    return pending;
+}
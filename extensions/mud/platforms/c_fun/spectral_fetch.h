@@ -0,0 +1,116 @@
+/**
+ * spectral_fetch: concurrent PSG, EMIT and Earthdata requests on one libcurl multi handle.
+ *
+ *   static void on_result(const sf_result *r, void *user) { ... r->status, r->body ... }
+ *
+ *   sf_fetcher *f = sf_create(NULL);                 default endpoints and timeouts
+ *   sf_query q = { .latitude = 42.49, .longitude = -71.22, .band_min_nm = 400, .band_max_nm = 700 };
+ *   sf_fetch_all(f, &q, on_result, zone);            three requests, all in flight at once
+ *   ... keep stepping the simulation ...
+ *   sf_poll(f, 0);                                   run the callbacks of whatever has finished
+ *   sf_destroy(f);
+ *
+ * A fetcher owns one background thread that drives every transfer. Submitting only queues the
+ * request and wakes that thread, so it never waits on the network. Transfers share the multi
+ * handle's connection cache: connections are kept alive between calls, and HTTP/2 streams to
+ * the same host are multiplexed over one connection where the server offers it.
+ *
+ * Results come back through a completion queue. sf_poll() runs the queued callbacks on the
+ * calling thread, so a callback may touch simulation state without locking; sf_wait() blocks
+ * until something is ready. A result, and the body it points to, is valid only during its
+ * callback.
+ *
+ * sf_submit and sf_fetch_all may be called from any thread. sf_poll and sf_wait should be
+ * called from one thread at a time. sf_poll, sf_wait, sf_pending and sf_destroy accept a NULL
+ * fetcher and do nothing, so callers can run without one.
+ */
+#ifndef SPECTRAL_FETCH_H
+#define SPECTRAL_FETCH_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SF_OK 0
+#define SF_EINVAL -1
+#define SF_ENOMEM -2
+
+typedef enum { SF_PSG = 0, SF_EMIT = 1, SF_EARTHDATA = 2, SF_SOURCE_COUNT } sf_source;
+
+typedef struct {
+    double latitude;
+    double longitude;
+    double band_min_nm;         /* wavelength band of interest */
+    double band_max_nm;
+} sf_query;
+
+typedef struct {
+    sf_source source;
+    long status;                /* HTTP status, or 0 if no response arrived */
+    int failed;                 /* transport error: status is 0 and error says why */
+    const char *error;          /* curl's message for the error code; a static string */
+    const char *detail;         /* the transfer's own error text, or NULL */
+    const char *body;           /* NUL-terminated; `size` excludes the terminator */
+    size_t size;
+    double seconds;             /* submit to completion */
+    const sf_query *query;
+    const char *etag;           /* response validators, or NULL if the server sent none */
+    const char *last_modified;
+    long retry_after_s;         /* Retry-After in seconds, or 0 */
+} sf_result;
+
+/* Validators from an earlier response, for a conditional request that may answer 304 */
+typedef struct {
+    const char *etag;           /* sent as If-None-Match; NULL to omit */
+    const char *last_modified;  /* sent as If-Modified-Since; NULL to omit */
+} sf_validators;
+
+typedef void (*sf_callback)(const sf_result *result, void *user);
+
+typedef struct {
+    const char *urls[SF_SOURCE_COUNT];  /* endpoint per source; NULL for the default */
+    const char *earthdata_token;        /* Earthdata bearer token; NULL reads EARTHDATA_TOKEN */
+    long timeout_ms;            /* whole transfer; 0 for 15000 */
+    long connect_timeout_ms;    /* 0 for 5000 */
+    long max_host_connections;  /* per host; 0 for 4 */
+    size_t max_body;            /* larger responses fail; 0 for 8 MiB */
+} sf_config;
+
+typedef struct sf_fetcher sf_fetcher;
+
+/* Start a fetcher; config may be NULL for the defaults. NULL if curl or the thread fails. */
+sf_fetcher *sf_create(const sf_config *config);
+
+/* Abort everything still in flight, drop undelivered results and stop the thread. */
+void sf_destroy(sf_fetcher *fetcher);
+
+/* Queue one request. SF_OK, SF_EINVAL or SF_ENOMEM. */
+int sf_submit(sf_fetcher *fetcher, sf_source source, const sf_query *query,
+              sf_callback callback, void *user);
+
+/* Queue one conditional request; validators may be NULL, which is plain sf_submit. */
+int sf_submit_if(sf_fetcher *fetcher, sf_source source, const sf_query *query,
+                 const sf_validators *validators, sf_callback callback, void *user);
+
+/* Queue one request per source; the callback runs once for each. SF_OK only if all three
+ * were queued. */
+int sf_fetch_all(sf_fetcher *fetcher, const sf_query *query, sf_callback callback, void *user);
+
+/* Run the callbacks of up to `max` finished requests (0 for all); returns how many ran. */
+size_t sf_poll(sf_fetcher *fetcher, size_t max);
+
+/* Wait up to timeout_ms for a finished request; returns how many are ready to poll. */
+size_t sf_wait(sf_fetcher *fetcher, unsigned timeout_ms);
+
+/* Requests submitted whose callbacks have not run yet. */
+size_t sf_pending(sf_fetcher *fetcher);
+
+const char *sf_source_name(sf_source source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
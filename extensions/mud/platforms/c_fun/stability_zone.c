@@ -1,14 +1,32 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
 #include "vtable.h"
+#include "rolling_stats.h"
+#include "sensor_ring.h"
+#include "telemetry.h"
+#include "zone_scheduler.h"
 
 // Define method indices
-#define INITIALIZE_ZONE_INDEX 0
-#define MONITOR_STABILITY_INDEX 1
-#define APPLY_STABILIZATION_INDEX 2
-#define REPORT_ZONE_STATUS_INDEX 3
+#define initializeZone_INDEX 0
+#define monitorStability_INDEX 1
+#define applyStabilization_INDEX 2
+#define reportZoneStatus_INDEX 3
+#define tickZone_INDEX 4
+
+// Stability every zone is steered toward, by the test suite and by each scheduled tick
+#define TARGET_STABILITY 95.0f
+
+// Samples a zone takes from its sensor ring per sr_pop_batch call
+#define SENSOR_BATCH 32
+
+// Stability lost for each environmental channel whose reading is anomalous
+#define ANOMALY_PENALTY 5.0f
 
 // Define data structures
 typedef struct {
@@ -19,12 +37,22 @@ typedef struct {
     float radiationLevel;
 } EnvironmentalData;
 
+// Rolling statistics of one zone's environment, a channel per sr_channel; constant size
+// however long the zone runs
+typedef struct {
+    rs_channel env[SR_CHANNEL_COUNT];
+    size_t index;            // The zone's position, for alerts
+    uint64_t anomalies;      // Ticks with at least one anomalous channel
+} ZoneStats;
+
 typedef struct {
     char* name;
     EnvironmentalData env;
     float stabilityScore;
     bool isActive;
     char* currentState;
+    sr_ring* sensors;        // Live readings for env; NULL to simulate a random walk
+    ZoneStats* stats;        // Rolling statistics of env; NULL to keep none
 } ZoneData;
 
 typedef struct {
@@ -34,71 +62,258 @@ typedef struct {
     char* quantumState;
 } QuantumZoneData;
 
+// Define telemetry events; each renders the text its method used to print
+static void render_offline(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is offline. Please activate first.\n", r->v[0].s);
+}
+
+static void render_superposed(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is in quantum superposition of online/offline states.\n", r->v[0].s);
+}
+
+static void render_initialize(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is initializing stability zone...\n", r->v[0].s);
+    fprintf(out, "Environmental conditions:\n");
+    fprintf(out, "  Temperature: %.1f°C\n", r->v[1].f);
+    fprintf(out, "  Humidity: %.1f%%\n", r->v[2].f);
+    fprintf(out, "  Pressure: %.1f kPa\n", r->v[3].f);
+    fprintf(out, "  Magnetic Field: %.1f mT\n", r->v[4].f);
+    fprintf(out, "  Radiation: %.1f mSv\n", r->v[5].f);
+}
+
+static void render_monitor(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is monitoring stability...\n", r->v[0].s);
+    fprintf(out, "Current stability score: %.1f\n", r->v[1].f);
+    fprintf(out, "Zone state: %s\n", r->v[2].s);
+}
+
+static void render_stabilize(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is applying stabilization...\n", r->v[0].s);
+    fprintf(out, "Target stability: %.1f\n", r->v[1].f);
+    fprintf(out, "Current stability: %.1f\n", r->v[2].f);
+    fprintf(out, "Adjustment factor: %.2f\n", r->v[3].f);
+}
+
+static void render_report(FILE* out, const tm_record* r) {
+    fprintf(out, "\n=== Stability Zone Status Report ===\n");
+    fprintf(out, "Name: %s\n", r->v[0].s);
+    fprintf(out, "Status: %s\n", r->v[1].i ? "Active" : "Inactive");
+    fprintf(out, "Stability Score: %.1f\n", r->v[2].f);
+    fprintf(out, "Environmental Conditions:\n");
+    fprintf(out, "  Temperature: %.1f°C\n", r->v[3].f);
+    fprintf(out, "  Humidity: %.1f%%\n", r->v[4].f);
+    fprintf(out, "  Pressure: %.1f kPa\n", r->v[5].f);
+    fprintf(out, "  Magnetic Field: %.1f mT\n", r->v[6].f);
+    fprintf(out, "  Radiation: %.1f mSv\n", r->v[7].f);
+    fprintf(out, "Current State: %s\n", r->v[8].s);
+}
+
+static void render_quantum_initialize(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is initializing quantum stability zone...\n", r->v[0].s);
+    fprintf(out, "Quantum field strength: %.2f\n", r->v[1].f);
+    fprintf(out, "Quantum state: %s\n", r->v[2].s);
+}
+
+static void render_quantum_monitor(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is monitoring quantum stability...\n", r->v[0].s);
+    fprintf(out, "Quantum field strength: %.2f\n", r->v[1].f);
+    fprintf(out, "Superposition count: %d\n", (int)r->v[2].i);
+    fprintf(out, "Quantum state: %s\n", r->v[3].s);
+}
+
+static void render_quantum_stabilize(FILE* out, const tm_record* r) {
+    fprintf(out, "%s is applying quantum stabilization...\n", r->v[0].s);
+    fprintf(out, "Target stability: %.1f\n", r->v[1].f);
+    fprintf(out, "Quantum-adjusted stability: %.1f\n", r->v[2].f);
+    fprintf(out, "Quantum adjustment factor: %.2f\n", r->v[3].f);
+}
+
+static void render_quantum_report(FILE* out, const tm_record* r) {
+    fprintf(out, "\n=== Quantum Stability Zone Status Report ===\n");
+    fprintf(out, "Name: %s\n", r->v[0].s);
+    fprintf(out, "Status: %s (in superposition)\n", r->v[1].i ? "Active" : "Inactive");
+    fprintf(out, "Quantum Stability Score: %.1f\n", r->v[2].f);
+    fprintf(out, "Quantum Field Strength: %.2f\n", r->v[3].f);
+    fprintf(out, "Superposition Count: %d\n", (int)r->v[4].i);
+    fprintf(out, "Quantum State: %s\n", r->v[5].s);
+}
+
+static void render_schedule(FILE* out, const tm_record* r) {
+    fprintf(out, "\n=== Zone Scheduler Report ===\n");
+    fprintf(out, "Zones: %lld on %lld threads at %.1f Hz\n",
+            (long long)r->v[0].i, (long long)r->v[1].i, r->v[2].f);
+    fprintf(out, "Ticks: %lld per zone, %lld overruns, %lld releases skipped\n",
+            (long long)r->v[3].i, (long long)r->v[4].i, (long long)r->v[5].i);
+    fprintf(out, "Worst wake-up: %.1f us late\n", r->v[6].f * 1e6);
+    fprintf(out, "Shard tick: %.1f us mean, %.1f us worst, %.1f%% of each thread busy\n",
+            r->v[7].f * 1e6, r->v[8].f * 1e6, r->v[9].f * 100.0);
+    fprintf(out, "Fingerprint: %016llx\n", (unsigned long long)r->v[10].i);
+}
+
+static void render_sensors(FILE* out, const tm_record* r) {
+    fprintf(out, "Sensors: %lld feeds at %.1f Hz into %lld-sample rings (%s when full)\n",
+            (long long)r->v[0].i, r->v[1].f, (long long)r->v[2].i, r->v[3].s);
+    fprintf(out, "Samples: %lld pushed, %lld consumed, %lld dropped, %lld refused\n",
+            (long long)r->v[4].i, (long long)r->v[5].i, (long long)r->v[6].i,
+            (long long)r->v[7].i);
+    fprintf(out, "Deepest backlog: %lld samples\n", (long long)r->v[8].i);
+}
+
+static void render_anomaly(FILE* out, const tm_record* r) {
+    static const char* const channels[SR_CHANNEL_COUNT] = {
+        "temperature", "humidity", "pressure", "magnetic field", "radiation"
+    };
+    int64_t channel = r->v[1].i;
+    fprintf(out, "ALERT zone %lld: %s %s at %.3f (level %.3f, deviation %.3f)\n",
+            (long long)r->v[0].i,
+            channel >= 0 && channel < SR_CHANNEL_COUNT ? channels[channel] : "channel",
+            r->v[2].i == RS_HIGH ? "high" : "low", r->v[3].f, r->v[4].f, r->v[5].f);
+}
+
+static void render_statistics(FILE* out, const tm_record* r) {
+    fprintf(out, "Anomalies: %lld ticks in %lld of %lld zones\n",
+            (long long)r->v[0].i, (long long)r->v[1].i, (long long)r->v[2].i);
+    fprintf(out, "Zone 0 temperature: EWMA %.3f +/- %.3f, median %.3f, p99 %.3f, "
+            "all-time %.3f +/- %.3f over %lld samples\n",
+            r->v[3].f, r->v[4].f, r->v[5].f, r->v[6].f, r->v[7].f, r->v[8].f,
+            (long long)r->v[9].i);
+}
+
+static const tm_event ZONE_OFFLINE = { "zone.offline", render_offline };
+static const tm_event ZONE_SUPERPOSED = { "zone.superposed", render_superposed };
+static const tm_event ZONE_INITIALIZE = { "zone.initialize", render_initialize };
+static const tm_event ZONE_MONITOR = { "zone.monitor", render_monitor };
+static const tm_event ZONE_STABILIZE = { "zone.stabilize", render_stabilize };
+static const tm_event ZONE_REPORT = { "zone.report", render_report };
+static const tm_event QUANTUM_INITIALIZE = { "quantum.initialize", render_quantum_initialize };
+static const tm_event QUANTUM_MONITOR = { "quantum.monitor", render_quantum_monitor };
+static const tm_event QUANTUM_STABILIZE = { "quantum.stabilize", render_quantum_stabilize };
+static const tm_event QUANTUM_REPORT = { "quantum.report", render_quantum_report };
+static const tm_event ZONE_SCHEDULE = { "zone.schedule", render_schedule };
+static const tm_event ZONE_SENSORS = { "zone.sensors", render_sensors };
+static const tm_event ZONE_ANOMALY = { "zone.anomaly", render_anomaly };
+static const tm_event ZONE_STATISTICS = { "zone.statistics", render_statistics };
+
+// Random walk of every environmental reading, up to 5 units either way
+static void fluctuate(EnvironmentalData* env, zs_rng* rng) {
+    env->temperature += (zs_uniform(rng) - 0.5f) * 10.0f;
+    env->humidity += (zs_uniform(rng) - 0.5f) * 10.0f;
+    env->pressure += (zs_uniform(rng) - 0.5f) * 10.0f;
+    env->magneticField += (zs_uniform(rng) - 0.5f) * 10.0f;
+    env->radiationLevel += (zs_uniform(rng) - 0.5f) * 10.0f;
+}
+
+static void apply_reading(EnvironmentalData* env, const sr_sample* sample) {
+    switch (sample->channel) {
+        case SR_TEMPERATURE: env->temperature = sample->value; break;
+        case SR_HUMIDITY: env->humidity = sample->value; break;
+        case SR_PRESSURE: env->pressure = sample->value; break;
+        case SR_MAGNETIC_FIELD: env->magneticField = sample->value; break;
+        case SR_RADIATION: env->radiationLevel = sample->value; break;
+    }
+}
+
+// Bring env up to date: everything queued on the zone's sensor ring, oldest first, so each
+// channel ends on its latest reading; or a random walk for a zone without sensors. Only the
+// thread ticking the zone calls this, which makes it the ring's one consumer.
+static void sample_environment(ZoneData* data, zs_rng* rng) {
+    if (!data->sensors) {
+        fluctuate(&data->env, rng);
+        return;
+    }
+    sr_sample batch[SENSOR_BATCH];
+    size_t n;
+    while ((n = sr_pop_batch(data->sensors, batch, SENSOR_BATCH)) > 0) {
+        for (size_t i = 0; i < n; i++) apply_reading(&data->env, &batch[i]);
+    }
+}
+
+// Fold the zone's current env into its rolling statistics, alerting on every anomalous
+// channel; returns how many there were. Same single caller as sample_environment.
+static int track_environment(ZoneData* data) {
+    ZoneStats* stats = data->stats;
+    if (!stats) return 0;
+    const float readings[SR_CHANNEL_COUNT] = {
+        data->env.temperature, data->env.humidity, data->env.pressure,
+        data->env.magneticField, data->env.radiationLevel
+    };
+    int anomalous = 0;
+    for (int c = 0; c < SR_CHANNEL_COUNT; c++) {
+        rs_channel* channel = &stats->env[c];
+        double level = rs_ewma_mean(&channel->ewma);
+        double deviation = rs_ewma_stddev(&channel->ewma);
+        int verdict = rs_channel_push(channel, readings[c]);
+        if (verdict == RS_NORMAL) continue;
+        anomalous++;
+        TM_EMIT(&ZONE_ANOMALY, TM_I(stats->index), TM_I(c), TM_I(verdict), TM_F(readings[c]),
+                TM_F(level), TM_F(deviation));
+    }
+    if (anomalous) stats->anomalies++;
+    return anomalous;
+}
+
 // Define base class
 DEFINE_CLASS(StabilityZone, Object, ZoneData);
 
 // Define base class methods
 DEFINE_METHOD(StabilityZone, initializeZone, void) {
+    (void)self;
     ZoneData* data = (ZoneData*)thisData;
     data->isActive = true;
     data->stabilityScore = 100.0;
-    printf("%s is initializing stability zone...\n", data->name);
-    printf("Environmental conditions:\n");
-    printf("  Temperature: %.1f°C\n", data->env.temperature);
-    printf("  Humidity: %.1f%%\n", data->env.humidity);
-    printf("  Pressure: %.1f kPa\n", data->env.pressure);
-    printf("  Magnetic Field: %.1f mT\n", data->env.magneticField);
-    printf("  Radiation: %.1f mSv\n", data->env.radiationLevel);
+    TM_EMIT(&ZONE_INITIALIZE, TM_S(data->name),
+            TM_F(data->env.temperature), TM_F(data->env.humidity), TM_F(data->env.pressure),
+            TM_F(data->env.magneticField), TM_F(data->env.radiationLevel));
 }
 
-DEFINE_METHOD(StabilityZone, monitorStability, void) {
+DEFINE_METHOD(StabilityZone, monitorStability, void, zs_rng* rng) {
+    (void)self;
     ZoneData* data = (ZoneData*)thisData;
     if (!data->isActive) {
-        printf("%s is offline. Please activate first.\n", data->name);
+        TM_EMIT(&ZONE_OFFLINE, TM_S(data->name));
         return;
     }
     
-    // Simulate environmental fluctuations
-    data->env.temperature += (rand() % 100 - 50) / 10.0;
-    data->env.humidity += (rand() % 100 - 50) / 10.0;
-    data->env.pressure += (rand() % 100 - 50) / 10.0;
-    data->env.magneticField += (rand() % 100 - 50) / 10.0;
-    data->env.radiationLevel += (rand() % 100 - 50) / 10.0;
+    // Read the sensors, or simulate environmental fluctuations without them
+    sample_environment(data, rng);
     
-    printf("%s is monitoring stability...\n", data->name);
-    printf("Current stability score: %.1f\n", data->stabilityScore);
-    printf("Zone state: %s\n", data->currentState);
+    TM_EMIT(&ZONE_MONITOR, TM_S(data->name), TM_F(data->stabilityScore), TM_S(data->currentState));
 }
 
 DEFINE_METHOD(StabilityZone, applyStabilization, void, float targetStability) {
+    (void)self;
     ZoneData* data = (ZoneData*)thisData;
     if (!data->isActive) {
-        printf("%s is offline. Please activate first.\n", data->name);
+        TM_EMIT(&ZONE_OFFLINE, TM_S(data->name));
         return;
     }
     
     float adjustment = targetStability - data->stabilityScore;
     data->stabilityScore += adjustment * 0.1;
     
-    printf("%s is applying stabilization...\n", data->name);
-    printf("Target stability: %.1f\n", targetStability);
-    printf("Current stability: %.1f\n", data->stabilityScore);
-    printf("Adjustment factor: %.2f\n", adjustment * 0.1);
+    TM_EMIT(&ZONE_STABILIZE, TM_S(data->name), TM_F(targetStability),
+            TM_F(data->stabilityScore), TM_F(adjustment * 0.1));
 }
 
 DEFINE_METHOD(StabilityZone, reportZoneStatus, void) {
+    (void)self;
     ZoneData* data = (ZoneData*)thisData;
-    printf("\n=== Stability Zone Status Report ===\n");
-    printf("Name: %s\n", data->name);
-    printf("Status: %s\n", data->isActive ? "Active" : "Inactive");
-    printf("Stability Score: %.1f\n", data->stabilityScore);
-    printf("Environmental Conditions:\n");
-    printf("  Temperature: %.1f°C\n", data->env.temperature);
-    printf("  Humidity: %.1f%%\n", data->env.humidity);
-    printf("  Pressure: %.1f kPa\n", data->env.pressure);
-    printf("  Magnetic Field: %.1f mT\n", data->env.magneticField);
-    printf("  Radiation: %.1f mSv\n", data->env.radiationLevel);
-    printf("Current State: %s\n", data->currentState);
+    TM_EMIT(&ZONE_REPORT, TM_S(data->name), TM_I(data->isActive), TM_F(data->stabilityScore),
+            TM_F(data->env.temperature), TM_F(data->env.humidity), TM_F(data->env.pressure),
+            TM_F(data->env.magneticField), TM_F(data->env.radiationLevel),
+            TM_S(data->currentState));
+}
+
+// One scheduled tick: monitorStability and applyStabilization without the telemetry, which
+// thousands of zones at a fixed rate would flood
+DEFINE_METHOD(StabilityZone, tickZone, void, zs_rng* rng) {
+    (void)self;
+    ZoneData* data = (ZoneData*)thisData;
+    if (!data->isActive) return;
+    
+    sample_environment(data, rng);
+    data->stabilityScore -= ANOMALY_PENALTY * track_environment(data);
+    data->stabilityScore += (TARGET_STABILITY - data->stabilityScore) * 0.1f;
 }
 
 // Define quantum zone class
@@ -106,38 +321,36 @@ DEFINE_CLASS(QuantumZone, StabilityZone, QuantumZoneData);
 
 // Define quantum zone methods
 DEFINE_METHOD(QuantumZone, initializeZone, void) {
+    (void)self;
     QuantumZoneData* data = (QuantumZoneData*)thisData;
     data->base.isActive = true;
     data->base.stabilityScore = 100.0;
     data->quantumField = 1.0;
-    printf("%s is initializing quantum stability zone...\n", data->base.name);
-    printf("Quantum field strength: %.2f\n", data->quantumField);
-    printf("Quantum state: %s\n", data->quantumState);
+    TM_EMIT(&QUANTUM_INITIALIZE, TM_S(data->base.name), TM_F(data->quantumField),
+            TM_S(data->quantumState));
 }
 
-DEFINE_METHOD(QuantumZone, monitorStability, void) {
+DEFINE_METHOD(QuantumZone, monitorStability, void, zs_rng* rng) {
+    (void)self;
     QuantumZoneData* data = (QuantumZoneData*)thisData;
     if (!data->base.isActive) {
-        printf("%s is in quantum superposition of online/offline states.\n", 
-               data->base.name);
+        TM_EMIT(&ZONE_SUPERPOSED, TM_S(data->base.name));
         return;
     }
     
     // Simulate quantum fluctuations
-    data->quantumField += (rand() % 100 - 50) / 100.0;
+    data->quantumField += zs_uniform(rng) - 0.5f;
     data->superpositionCount++;
     
-    printf("%s is monitoring quantum stability...\n", data->base.name);
-    printf("Quantum field strength: %.2f\n", data->quantumField);
-    printf("Superposition count: %d\n", data->superpositionCount);
-    printf("Quantum state: %s\n", data->quantumState);
+    TM_EMIT(&QUANTUM_MONITOR, TM_S(data->base.name), TM_F(data->quantumField),
+            TM_I(data->superpositionCount), TM_S(data->quantumState));
 }
 
 DEFINE_METHOD(QuantumZone, applyStabilization, void, float targetStability) {
+    (void)self;
     QuantumZoneData* data = (QuantumZoneData*)thisData;
     if (!data->base.isActive) {
-        printf("%s is in quantum superposition of online/offline states.\n", 
-               data->base.name);
+        TM_EMIT(&ZONE_SUPERPOSED, TM_S(data->base.name));
         return;
     }
     
@@ -145,41 +358,179 @@ DEFINE_METHOD(QuantumZone, applyStabilization, void, float targetStability) {
                              data->quantumField;
     data->base.stabilityScore += quantumAdjustment * 0.1;
     
-    printf("%s is applying quantum stabilization...\n", data->base.name);
-    printf("Target stability: %.1f\n", targetStability);
-    printf("Quantum-adjusted stability: %.1f\n", data->base.stabilityScore);
-    printf("Quantum adjustment factor: %.2f\n", quantumAdjustment * 0.1);
+    TM_EMIT(&QUANTUM_STABILIZE, TM_S(data->base.name), TM_F(targetStability),
+            TM_F(data->base.stabilityScore), TM_F(quantumAdjustment * 0.1));
 }
 
 DEFINE_METHOD(QuantumZone, reportZoneStatus, void) {
+    (void)self;
+    QuantumZoneData* data = (QuantumZoneData*)thisData;
+    TM_EMIT(&QUANTUM_REPORT, TM_S(data->base.name), TM_I(data->base.isActive),
+            TM_F(data->base.stabilityScore), TM_F(data->quantumField),
+            TM_I(data->superpositionCount), TM_S(data->quantumState));
+}
+
+DEFINE_METHOD(QuantumZone, tickZone, void, zs_rng* rng) {
+    (void)self;
     QuantumZoneData* data = (QuantumZoneData*)thisData;
-    printf("\n=== Quantum Stability Zone Status Report ===\n");
-    printf("Name: %s\n", data->base.name);
-    printf("Status: %s (in superposition)\n", 
-           data->base.isActive ? "Active" : "Inactive");
-    printf("Quantum Stability Score: %.1f\n", data->base.stabilityScore);
-    printf("Quantum Field Strength: %.2f\n", data->quantumField);
-    printf("Superposition Count: %d\n", data->superpositionCount);
-    printf("Quantum State: %s\n", data->quantumState);
+    if (!data->base.isActive) return;
+    
+    // The quantum field drifts on its own; only live sensors move env
+    if (data->base.sensors) {
+        sample_environment(&data->base, rng);
+        data->base.stabilityScore -= ANOMALY_PENALTY * track_environment(&data->base);
+    }
+    data->quantumField += zs_uniform(rng) - 0.5f;
+    data->superpositionCount++;
+    data->base.stabilityScore += (TARGET_STABILITY - data->base.stabilityScore) *
+                                 data->quantumField * 0.1f;
+}
+
+// Runs on a scheduler thread; each zone belongs to exactly one shard
+static void tick_zone(size_t zone, uint64_t tick, zs_rng* rng, void* user) {
+    (void)tick;
+    Object** zones = (Object**)user;
+    CALL(zones[zone], tickZone, rng);
+}
+
+// FNV-1a over every zone's state after the run: equal for equal seeds and tick counts,
+// whatever the thread count
+static uint64_t fingerprint(const QuantumZoneData* zones, size_t count) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < count; i++) {
+        const float fields[] = {
+            zones[i].base.env.temperature, zones[i].base.env.humidity,
+            zones[i].base.env.pressure, zones[i].base.env.magneticField,
+            zones[i].base.env.radiationLevel, zones[i].base.stabilityScore,
+            zones[i].quantumField
+        };
+        const unsigned char* bytes = (const unsigned char*)fields;
+        for (size_t b = 0; b < sizeof(fields); b++) {
+            hash = (hash ^ bytes[b]) * 0x100000001b3ull;
+        }
+    }
+    return hash;
+}
+
+// A simulated sensor feed: one producer thread reporting some of the channels of every zone,
+// `rateHz` times a second, through the zones' sensor rings
+typedef struct {
+    ZoneData** zones;
+    size_t count;
+    unsigned index;          // This feed reports the channels c with c % feeds == index
+    unsigned feeds;
+    double rateHz;
+    float spikeRate;         // Chance that a reading is a fault far outside its spread
+    uint64_t seed;
+    atomic_bool* stop;
+    pthread_t thread;
+} SensorFeed;
+
+static void* run_sensor_feed(void* arg) {
+    SensorFeed* feed = (SensorFeed*)arg;
+    static const float baseline[SR_CHANNEL_COUNT] = { 25.0f, 50.0f, 101.3f, 0.05f, 0.1f };
+    static const float spread[SR_CHANNEL_COUNT] = { 0.5f, 2.0f, 0.2f, 0.01f, 0.02f };
+    uint64_t period = (uint64_t)(1e9 / feed->rateHz);
+    uint64_t release = sr_now_ns();
+    zs_rng rng;
+    for (uint64_t sweep = 0; !atomic_load_explicit(feed->stop, memory_order_relaxed); sweep++) {
+        // A stream per feed, after the zones' own streams
+        zs_rng_init(&rng, feed->seed, feed->count + feed->index, sweep);
+        for (size_t z = 0; z < feed->count; z++) {
+            for (unsigned c = feed->index; c < SR_CHANNEL_COUNT; c += feed->feeds) {
+                float value = baseline[c] + (zs_uniform(&rng) - 0.5f) * 2.0f * spread[c];
+                if (zs_uniform(&rng) < feed->spikeRate) value += 20.0f * spread[c];
+                sr_sample sample = {
+                    .t_ns = sr_now_ns(),
+                    .zone = (uint32_t)z,
+                    .channel = c,
+                    .value = value
+                };
+                sr_push(feed->zones[z]->sensors, &sample);  // a full ring counts its refusals
+            }
+        }
+        release += period;
+        struct timespec ts = { (time_t)(release / 1000000000ull), (long)(release % 1000000000ull) };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    return NULL;
 }
 
 // Initialize classes
-INIT_CLASS(StabilityZone, Object,
-    ADD_METHOD(StabilityZone, initializeZone),
-    ADD_METHOD(StabilityZone, monitorStability),
-    ADD_METHOD(StabilityZone, applyStabilization),
-    ADD_METHOD(StabilityZone, reportZoneStatus)
-);
+#define StabilityZone_METHODS \
+    ADD_METHOD(StabilityZone, initializeZone), \
+    ADD_METHOD(StabilityZone, monitorStability), \
+    ADD_METHOD(StabilityZone, applyStabilization), \
+    ADD_METHOD(StabilityZone, reportZoneStatus), \
+    ADD_METHOD(StabilityZone, tickZone)
+
+INIT_CLASS(StabilityZone, Object, StabilityZone_METHODS);
 
 INIT_CLASS(QuantumZone, StabilityZone,
     ADD_METHOD(QuantumZone, initializeZone),
     ADD_METHOD(QuantumZone, monitorStability),
     ADD_METHOD(QuantumZone, applyStabilization),
-    ADD_METHOD(QuantumZone, reportZoneStatus)
+    ADD_METHOD(QuantumZone, reportZoneStatus),
+    ADD_METHOD(QuantumZone, tickZone)
 );
 
-int main() {
-    srand(time(NULL));
+int main(int argc, char** argv) {
+    tm_config telemetry = { .out = stdout };
+    uint64_t seed = (uint64_t)time(NULL);
+    zs_config schedule = { .rate_hz = 100.0, .tick = tick_zone };
+    double seconds = 2.0;
+    unsigned feeds = 0;
+    double sensorRateHz = 100.0;
+    float spikeRate = 0.0f;
+    sr_config rings = { .capacity = 64, .policy = SR_DROP_OLDEST };
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quiet") == 0) {
+            telemetry.quiet = 1;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--zones") == 0 && i + 1 < argc) {
+            schedule.items = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            schedule.rate_hz = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            schedule.threads = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--sensors") == 0 && i + 1 < argc) {
+            feeds = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--sensor-rate") == 0 && i + 1 < argc) {
+            sensorRateHz = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--ring") == 0 && i + 1 < argc) {
+            rings.capacity = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--backpressure") == 0) {
+            rings.policy = SR_BACKPRESSURE;
+        } else if (strcmp(argv[i], "--spikes") == 0 && i + 1 < argc) {
+            spikeRate = strtof(argv[++i], NULL);
+        } else {
+            fprintf(stderr, "usage: %s [--quiet] [--seed N] "
+                    "[--zones N [--rate HZ] [--seconds S] [--threads N] "
+                    "[--sensors FEEDS [--sensor-rate HZ] [--ring N] [--backpressure] "
+                    "[--spikes P]]]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (feeds > SR_CHANNEL_COUNT) feeds = SR_CHANNEL_COUNT;
+    if (feeds && !(sensorRateHz > 0.0)) {
+        fprintf(stderr, "stability_zone: --sensor-rate must be positive\n");
+        return 2;
+    }
+    rings.single_producer = feeds == 1;
+    if (schedule.items && !(schedule.rate_hz > 0.0 && seconds > 0.0)) {
+        fprintf(stderr, "stability_zone: --rate and --seconds must be positive\n");
+        return 2;
+    }
+    if (tm_start(&telemetry) != 0) {
+        fprintf(stderr, "stability_zone: could not start the telemetry flusher\n");
+        return 1;
+    }
+    zs_rng rng;
+    zs_rng_init(&rng, seed, 0, 0);
     
     // Create regular stability zone
     ZoneData regularData = {
@@ -221,26 +572,149 @@ int main() {
     QuantumZone* quantum = NEW_WITH_DATA(QuantumZone, QuantumZoneData, &quantumData);
     
     // Run stability zone tests
-    printf("\n=== Stability Zone Test Suite ===\n\n");
+    TM_TEXT("\n=== Stability Zone Test Suite ===\n\n");
     
-    printf("Testing Classic Stability Zone:\n");
+    TM_TEXT("Testing Classic Stability Zone:\n");
     CALL(regular, initializeZone);
-    CALL(regular, monitorStability);
-    CALL(regular, applyStabilization, 95.0);
+    CALL(regular, monitorStability, &rng);
+    CALL_AS(StabilityZone, regular, applyStabilization, TARGET_STABILITY);
     CALL(regular, reportZoneStatus);
     
-    printf("\nTesting Quantum Stability Zone:\n");
+    TM_TEXT("\nTesting Quantum Stability Zone:\n");
     CALL(quantum, initializeZone);
-    CALL(quantum, monitorStability);
-    CALL(quantum, applyStabilization, 95.0);
+    CALL(quantum, monitorStability, &rng);
+    CALL_AS(StabilityZone, quantum, applyStabilization, TARGET_STABILITY);
     CALL(quantum, reportZoneStatus);
     
-    printf("\n=== Stability Zone Test Complete ===\n");
-    printf("(Please check for any quantum anomalies in the zones)\n");
+    TM_TEXT("\n=== Stability Zone Test Complete ===\n");
+    TM_TEXT("(Please check for any quantum anomalies in the zones)\n");
     
     // Clean up
     DELETE(regular);
     DELETE(quantum);
     
+    // Tick a field of zones at a fixed rate, every fourth one quantum
+    if (schedule.items) {
+        size_t count = schedule.items;
+        QuantumZoneData* zoneData = (QuantumZoneData*)calloc(count, sizeof(QuantumZoneData));
+        Object** zones = (Object**)calloc(count, sizeof(Object*));
+        ZoneStats* zoneStats = (ZoneStats*)calloc(count, sizeof(ZoneStats));
+        VArena arena = VARENA_INIT;
+        // Without zones nothing below is wired up: no feeds, no scheduler, only the cleanup
+        if (!zoneData || !zoneStats) {
+            free(zones);
+            zones = NULL;
+        }
+        for (size_t i = 0; zones && i < count; i++) {
+            zoneData[i].base = (ZoneData){
+                .name = "Scheduled Zone",
+                .env = regularData.env,
+                .stabilityScore = 100.0,
+                .isActive = true,
+                .currentState = "Scheduled",
+                .stats = &zoneStats[i]
+            };
+            for (int c = 0; c < SR_CHANNEL_COUNT; c++) rs_channel_init(&zoneStats[i].env[c], NULL);
+            zoneStats[i].index = i;
+            if (i % 4 == 3) {
+                zoneData[i].quantumField = 1.0;
+                zoneData[i].quantumState = "Superposition";
+                zones[i] = AS_OBJECT(NEW_IN_ARENA(&arena, QuantumZone, QuantumZoneData, &zoneData[i]));
+            } else {
+                zones[i] = AS_OBJECT(NEW_IN_ARENA(&arena, StabilityZone, ZoneData, &zoneData[i].base));
+            }
+            if (feeds) zoneData[i].base.sensors = sr_create(&rings);
+            if (!zones[i] || (feeds && !zoneData[i].base.sensors)) {
+                free(zones);
+                zones = NULL;
+            }
+        }
+        
+        // Sensor feeds split the channels between them, so every ring has `feeds` producers
+        ZoneData** sensed = zones ? (ZoneData**)calloc(count, sizeof(ZoneData*)) : NULL;
+        SensorFeed feed[SR_CHANNEL_COUNT];
+        atomic_bool feedsStop = false;
+        unsigned feedsStarted = 0;
+        for (size_t i = 0; sensed && i < count; i++) sensed[i] = &zoneData[i].base;
+        for (unsigned f = 0; sensed && f < feeds; f++) {
+            feed[f] = (SensorFeed){
+                .zones = sensed,
+                .count = count,
+                .index = f,
+                .feeds = feeds,
+                .rateHz = sensorRateHz,
+                .spikeRate = spikeRate,
+                .seed = seed,
+                .stop = &feedsStop
+            };
+            if (pthread_create(&feed[f].thread, NULL, run_sensor_feed, &feed[f]) != 0) break;
+            feedsStarted++;
+        }
+        
+        schedule.ticks = (uint64_t)(seconds * schedule.rate_hz + 0.5);
+        if (schedule.ticks == 0) schedule.ticks = 1;
+        schedule.seed = seed;
+        schedule.user = zones;
+        zs_scheduler* scheduler = zones ? zs_start(&schedule) : NULL;
+        if (scheduler) {
+            zs_wait(scheduler);
+            zs_stats stats;
+            zs_stats_get(scheduler, &stats);
+            TM_EMIT(&ZONE_SCHEDULE, TM_I(count), TM_I(stats.threads), TM_F(schedule.rate_hz),
+                    TM_I(schedule.ticks), TM_I(stats.overruns), TM_I(stats.skipped),
+                    TM_F(stats.max_late_s), TM_F(stats.mean_busy_s), TM_F(stats.max_busy_s),
+                    TM_F(stats.utilization), TM_I(fingerprint(zoneData, count)));
+            uint64_t anomalies = 0, alerted = 0;
+            for (size_t i = 0; i < count; i++) {
+                anomalies += zoneStats[i].anomalies;
+                alerted += zoneStats[i].anomalies > 0;
+            }
+            const rs_channel* temperature = &zoneStats[0].env[SR_TEMPERATURE];
+            TM_EMIT(&ZONE_STATISTICS, TM_I(anomalies), TM_I(alerted), TM_I(count),
+                    TM_F(rs_ewma_mean(&temperature->ewma)),
+                    TM_F(rs_ewma_stddev(&temperature->ewma)),
+                    TM_F(rs_p2_estimate(&temperature->median)),
+                    TM_F(rs_p2_estimate(&temperature->p99)), TM_F(temperature->all.mean),
+                    TM_F(sqrt(rs_welford_variance(&temperature->all))),
+                    TM_I(temperature->all.n));
+            zs_destroy(scheduler);
+        } else {
+            TM_TEXT("Could not start the zone scheduler\n");
+        }
+        
+        atomic_store(&feedsStop, true);
+        for (unsigned f = 0; f < feedsStarted; f++) pthread_join(feed[f].thread, NULL);
+        if (feeds) {
+            sr_stats total = { 0 };
+            for (size_t i = 0; zoneData && i < count; i++) {
+                sr_stats ring;
+                if (!zoneData[i].base.sensors) continue;
+                sr_stats_get(zoneData[i].base.sensors, &ring);
+                total.pushed += ring.pushed;
+                total.popped += ring.popped;
+                total.dropped += ring.dropped;
+                total.rejected += ring.rejected;
+                if (ring.high_water > total.high_water) total.high_water = ring.high_water;
+                sr_destroy(zoneData[i].base.sensors);
+            }
+            TM_EMIT(&ZONE_SENSORS, TM_I(feedsStarted), TM_F(sensorRateHz), TM_I(rings.capacity),
+                    TM_S(rings.policy == SR_DROP_OLDEST ? "drop oldest" : "back-pressure"),
+                    TM_I(total.pushed), TM_I(total.popped), TM_I(total.dropped),
+                    TM_I(total.rejected), TM_I(total.high_water));
+        }
+        varena_destroy(&arena);
+        free(sensed);
+        free(zoneStats);
+        free(zones);
+        free(zoneData);
+    }
+    
+    tm_stop();
+    if (telemetry.quiet) {
+        tm_stats stats;
+        tm_stats_get(&stats);
+        fprintf(stderr, "telemetry: %llu records, %llu dropped\n",
+                (unsigned long long)stats.emitted, (unsigned long long)stats.dropped);
+    }
     return 0;
 } 
\ No newline at end of file
@@ -0,0 +1,197 @@
+/**
+ * telemetry: per-thread record rings and the background flusher; see telemetry.h for the API.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "telemetry.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* One emitting thread's records. Only that thread moves head and only the flusher moves tail,
+ * so neither side takes a lock. Rings are never freed: a thread that exits leaves an empty
+ * ring on the list, which costs the flusher one check per pass. `busy` is set while the owner
+ * is between its check of `running` and publishing a record, so tm_stop() can wait for that
+ * record before the final drain. */
+typedef struct tm_ring {
+    _Atomic uint64_t head;
+    _Atomic int busy;
+    char pad_head[64 - sizeof(uint64_t) - sizeof(int)];
+    _Atomic uint64_t tail;
+    char pad_tail[64 - sizeof(uint64_t)];
+    struct tm_ring *next;
+    tm_record records[TM_RING_RECORDS];
+} tm_ring;
+
+static _Atomic(tm_ring *) rings;
+static _Thread_local tm_ring *self_ring;
+
+static _Atomic int running;
+static FILE *out_file;
+static int quiet_mode;
+static unsigned flush_period_ms;
+
+static pthread_t flusher;
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond = PTHREAD_COND_INITIALIZER;
+static int stopping;
+
+static _Atomic uint64_t emitted_count;
+static _Atomic uint64_t rendered_count;
+static _Atomic uint64_t dropped_count;
+
+static void render_message(FILE *out, const tm_record *r) {
+    fputs(r->v[0].s, out);
+}
+
+const tm_event TM_MESSAGE = { "message", render_message };
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void fill_record(tm_record *r, const tm_event *event, const tm_value *values, size_t count) {
+    if (count > TM_MAX_VALUES) count = TM_MAX_VALUES;
+    r->event = event;
+    r->ns = now_ns();
+    r->count = (uint32_t)count;
+    memcpy(r->v, values, count * sizeof(tm_value));
+}
+
+static tm_ring *register_ring(void) {
+    tm_ring *ring = (tm_ring *)calloc(1, sizeof(tm_ring));
+    if (!ring) return NULL;
+    ring->next = atomic_load_explicit(&rings, memory_order_relaxed);
+    /* seq_cst: tm_stop() either finds this ring or the owner sees `running` cleared */
+    while (!atomic_compare_exchange_weak_explicit(&rings, &ring->next, ring,
+                                                  memory_order_seq_cst, memory_order_relaxed)) {
+    }
+    return ring;
+}
+
+static void wake_flusher(void) {
+    pthread_mutex_lock(&wake_lock);
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_lock);
+}
+
+static void render_now(const tm_event *event, const tm_value *values, size_t count) {
+    tm_record r;
+    fill_record(&r, event, values, count);
+    event->render(stdout, &r);
+}
+
+void tm_emit(const tm_event *event, const tm_value *values, size_t count) {
+    tm_ring *ring = self_ring;
+    if (!ring) {
+        if (!atomic_load_explicit(&running, memory_order_acquire)) {
+            render_now(event, values, count);
+            return;
+        }
+        ring = self_ring = register_ring();
+        if (!ring) {
+            atomic_fetch_add_explicit(&emitted_count, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&dropped_count, 1, memory_order_relaxed);
+            return;
+        }
+    }
+    /* seq_cst pairs with tm_stop(): either it waits for this record or this sees it stopped */
+    atomic_store_explicit(&ring->busy, 1, memory_order_seq_cst);
+    if (!atomic_load_explicit(&running, memory_order_seq_cst)) {
+        atomic_store_explicit(&ring->busy, 0, memory_order_relaxed);
+        render_now(event, values, count);
+        return;
+    }
+    atomic_fetch_add_explicit(&emitted_count, 1, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t used = head - atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (used >= TM_RING_RECORDS) {
+        atomic_fetch_add_explicit(&dropped_count, 1, memory_order_relaxed);
+        atomic_store_explicit(&ring->busy, 0, memory_order_release);
+        return;
+    }
+    fill_record(&ring->records[head & (TM_RING_RECORDS - 1)], event, values, count);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    atomic_store_explicit(&ring->busy, 0, memory_order_release);
+    /* Once per fill, so a burst is flushed before the ring runs out */
+    if (used + 1 == TM_RING_RECORDS / 2) wake_flusher();
+}
+
+/* Render (or in quiet mode, count) everything the emitters have published so far */
+static void drain_all(void) {
+    uint64_t rendered = 0;
+    for (tm_ring *ring = atomic_load_explicit(&rings, memory_order_acquire); ring; ring = ring->next) {
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (!quiet_mode) {
+            for (uint64_t i = tail; i != head; i++) {
+                const tm_record *r = &ring->records[i & (TM_RING_RECORDS - 1)];
+                r->event->render(out_file, r);
+            }
+            rendered += head - tail;
+        }
+        atomic_store_explicit(&ring->tail, head, memory_order_release);
+    }
+    if (rendered) {
+        atomic_fetch_add_explicit(&rendered_count, rendered, memory_order_relaxed);
+        fflush(out_file);
+    }
+}
+
+static void *flusher_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&wake_lock);
+    while (!stopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)(flush_period_ms % 1000) * 1000000L;
+        deadline.tv_sec += flush_period_ms / 1000 + deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&wake_cond, &wake_lock, &deadline);
+        pthread_mutex_unlock(&wake_lock);
+        drain_all();
+        pthread_mutex_lock(&wake_lock);
+    }
+    pthread_mutex_unlock(&wake_lock);
+    drain_all();
+    return NULL;
+}
+
+int tm_start(const tm_config *config) {
+    if (atomic_load(&running)) return -1;
+    out_file = config && config->out ? config->out : stdout;
+    quiet_mode = config ? config->quiet : 0;
+    flush_period_ms = config && config->flush_ms ? config->flush_ms : TM_DEFAULT_FLUSH_MS;
+    stopping = 0;
+    /* Anything printed synchronously so far goes out ahead of the buffered records */
+    fflush(stdout);
+    if (pthread_create(&flusher, NULL, flusher_main, NULL) != 0) return -1;
+    atomic_store_explicit(&running, 1, memory_order_release);
+    return 0;
+}
+
+void tm_stop(void) {
+    if (!atomic_load(&running)) return;
+    atomic_store_explicit(&running, 0, memory_order_seq_cst);
+    /* Emitters that saw the sink running publish before the flusher's final drain */
+    for (tm_ring *ring = atomic_load_explicit(&rings, memory_order_seq_cst); ring; ring = ring->next) {
+        while (atomic_load_explicit(&ring->busy, memory_order_seq_cst)) sched_yield();
+    }
+    pthread_mutex_lock(&wake_lock);
+    stopping = 1;
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_lock);
+    pthread_join(flusher, NULL);
+    fflush(out_file);
+}
+
+void tm_stats_get(tm_stats *stats) {
+    stats->emitted = atomic_load_explicit(&emitted_count, memory_order_relaxed);
+    stats->rendered = atomic_load_explicit(&rendered_count, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&dropped_count, memory_order_relaxed);
+}
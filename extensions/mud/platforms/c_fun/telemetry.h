@@ -0,0 +1,104 @@
+/**
+ * telemetry: a buffered event sink for the zone and annealing simulations, in place of printf.
+ *
+ *   static void render_score(FILE *out, const tm_record *r) {
+ *       fprintf(out, "%s: score %.1f\n", r->v[0].s, r->v[1].f);
+ *   }
+ *   static const tm_event SCORE = { "score", render_score };
+ *
+ *   tm_start(NULL);                                  stdout, text, 20 ms flushes
+ *   TM_EMIT(&SCORE, TM_S(zone->name), TM_F(zone->score));
+ *   tm_stop();                                       flush everything and join the flusher
+ *
+ * TM_EMIT copies the event and its values into a fixed-size binary record in the calling
+ * thread's own ring buffer: no formatting, no locks and no I/O on the calling thread. A
+ * background flusher drains every ring each flush period (sooner when one fills up) and only
+ * then renders the records as the text they stand for. In quiet mode records are counted and
+ * dropped unrendered. A full ring never blocks the emitter; the record is dropped and
+ * counted instead (tm_stats).
+ *
+ * Strings are stored as pointers, not copied: pass only strings that outlive the sink, such
+ * as literals and the names owned by long-lived zone data. Before tm_start() (and after
+ * tm_stop()) TM_EMIT renders straight to stdout, as printf did.
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TM_MAX_VALUES 14
+#define TM_RING_RECORDS 4096   /* per thread; a power of two */
+#define TM_DEFAULT_FLUSH_MS 20
+
+typedef union {
+    double f;
+    int64_t i;
+    const char *s;
+} tm_value;
+
+struct tm_record;
+
+/* One kind of record: its name and how to render it as text. Define them as static consts. */
+typedef struct {
+    const char *name;
+    void (*render)(FILE *out, const struct tm_record *r);
+} tm_event;
+
+typedef struct tm_record {
+    const tm_event *event;
+    uint64_t ns;        /* CLOCK_MONOTONIC at emit */
+    uint32_t count;     /* values used */
+    tm_value v[TM_MAX_VALUES];
+} tm_record;
+
+typedef struct {
+    FILE *out;          /* where text goes; NULL for stdout */
+    int quiet;          /* count records but render nothing */
+    unsigned flush_ms;  /* flush period; 0 for TM_DEFAULT_FLUSH_MS */
+} tm_config;
+
+/* Once tm_stop() returns, every record that made it into a ring has been drained, so emitted ==
+ * rendered + dropped (in quiet mode nothing is rendered). */
+typedef struct {
+    uint64_t emitted;   /* records emitted while the sink was running */
+    uint64_t rendered;  /* records written out as text */
+    uint64_t dropped;   /* records lost to a full ring */
+} tm_stats;
+
+/* Start the flusher; config may be NULL for the defaults. 0 on success, -1 on error or if
+ * already started. */
+int tm_start(const tm_config *config);
+
+/* Flush every ring, stop the flusher and fflush the output. */
+void tm_stop(void);
+
+/* Record an event with `count` values (at most TM_MAX_VALUES; extras are ignored). */
+void tm_emit(const tm_event *event, const tm_value *values, size_t count);
+
+void tm_stats_get(tm_stats *stats);
+
+/* Built-in event that renders its one string value as is. */
+extern const tm_event TM_MESSAGE;
+
+#define TM_F(x) { .f = (double)(x) }
+#define TM_I(x) { .i = (int64_t)(x) }
+#define TM_S(x) { .s = (x) }
+
+#define TM_EMIT(event, ...) \
+    tm_emit((event), (const tm_value[]){ __VA_ARGS__ }, \
+            sizeof((const tm_value[]){ __VA_ARGS__ }) / sizeof(tm_value))
+
+/* Emit a fixed message (a string literal or another long-lived string). */
+#define TM_TEXT(text) TM_EMIT(&TM_MESSAGE, TM_S(text))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
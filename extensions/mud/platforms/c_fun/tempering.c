@@ -0,0 +1,226 @@
+/**
+ * tempering: replica-exchange annealing on a work_pool; see tempering.h for the API.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "tempering.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PT_DEFAULT_REPLICAS_PER_THREAD 4
+#define PT_DEFAULT_T_MIN 1e-3
+#define PT_DEFAULT_T_MAX 1.0
+#define PT_DEFAULT_MOVES 4096
+#define PT_DEFAULT_ROUNDS 200
+
+/* One rung of the ladder. Worker threads write only their own replica during a round, so
+ * each sits on its own cache lines. */
+typedef struct {
+    _Alignas(64) pt_rng rng;
+    double temperature;
+    double cost;
+    double best_cost;
+    unsigned char *state;
+    unsigned char *candidate;
+    unsigned char *best;
+    uint64_t moves;
+    uint64_t accepted;
+} replica;
+
+typedef struct {
+    const pt_provider *provider;
+    replica *replicas;
+    size_t moves;
+} ladder;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void pt_rng_seed(pt_rng *rng, uint64_t seed) {
+    rng->state = seed;
+    pt_rng_next(rng);
+}
+
+uint64_t pt_rng_next(pt_rng *rng) {
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+double pt_uniform(pt_rng *rng) {
+    return (double)(pt_rng_next(rng) >> 11) * 0x1p-53;
+}
+
+double pt_normal(pt_rng *rng) {
+    double u = 1.0 - pt_uniform(rng);  /* (0, 1], so the log is finite */
+    double v = pt_uniform(rng);
+    return sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v);
+}
+
+/* One replica's Metropolis moves for a round; a work_pool task. */
+static void step_replica(size_t index, void *user) {
+    ladder *l = (ladder *)user;
+    const pt_provider *p = l->provider;
+    replica *r = &l->replicas[index];
+    double cost = r->cost, best = r->best_cost, beta = 1.0 / r->temperature;
+    uint64_t accepted = 0;
+    for (size_t m = 0; m < l->moves; m++) {
+        p->move(r->state, r->candidate, r->temperature, &r->rng, p->ctx);
+        double c = p->cost(r->candidate, p->ctx);
+        if (!(c <= cost) && !(pt_uniform(&r->rng) < exp((cost - c) * beta))) continue;
+        unsigned char *swap = r->state;
+        r->state = r->candidate;
+        r->candidate = swap;
+        cost = c;
+        accepted++;
+        if (c < best) {
+            best = c;
+            memcpy(r->best, r->state, p->state_size);
+        }
+    }
+    r->cost = cost;
+    r->best_cost = best;
+    r->moves += l->moves;
+    r->accepted += accepted;
+}
+
+/* Offer swaps between rungs (i, i + 1) for every i of one parity, on the calling thread. */
+static void exchange(replica *rs, size_t n, int parity, pt_rng *rng,
+                     uint64_t *offered, uint64_t *accepted) {
+    for (size_t i = (size_t)parity; i + 1 < n; i += 2) {
+        replica *a = &rs[i], *b = &rs[i + 1];
+        double delta = (1.0 / a->temperature - 1.0 / b->temperature) * (a->cost - b->cost);
+        (*offered)++;
+        if (delta < 0.0 && !(pt_uniform(rng) < exp(delta))) continue;
+        unsigned char *state = a->state;
+        a->state = b->state;
+        b->state = state;
+        double cost = a->cost;
+        a->cost = b->cost;
+        b->cost = cost;
+        (*accepted)++;
+    }
+}
+
+int pt_run(const pt_provider *provider, const pt_config *config, const void *initial,
+           void *best, pt_stats *stats) {
+    if (!provider || !provider->cost || !provider->move || provider->state_size == 0 ||
+        !config || !initial || !best) {
+        return PT_EINVAL;
+    }
+    wp_pool *pool = config->pool ? config->pool : wp_create(config->threads);
+    if (!pool) return PT_ENOMEM;
+    unsigned threads = wp_threads(pool);
+
+    size_t n = config->replicas ? config->replicas : PT_DEFAULT_REPLICAS_PER_THREAD * threads;
+    double t_min = config->t_min > 0.0 ? config->t_min : PT_DEFAULT_T_MIN;
+    double t_max = config->t_max > 0.0 ? config->t_max : PT_DEFAULT_T_MAX;
+    if (t_max < t_min) t_max = t_min;
+    size_t size = provider->state_size;
+
+    replica *rs = aligned_alloc(64, n * sizeof(replica));
+    unsigned char *states = malloc(n * 3 * size);
+    if (!rs || !states) {
+        free(rs);
+        free(states);
+        if (!config->pool) wp_destroy(pool);
+        return PT_ENOMEM;
+    }
+
+    double initial_cost = provider->cost(initial, provider->ctx);
+    for (size_t i = 0; i < n; i++) {
+        replica *r = &rs[i];
+        memset(r, 0, sizeof(*r));
+        pt_rng_seed(&r->rng, config->seed + (i + 1) * 0xD1B54A32D192ED03ull);
+        r->temperature = n > 1 ? t_min * pow(t_max / t_min, (double)i / (n - 1)) : t_min;
+        r->state = states + i * 3 * size;
+        r->candidate = r->state + size;
+        r->best = r->candidate + size;
+        memcpy(r->state, initial, size);
+        memcpy(r->best, initial, size);
+        r->cost = r->best_cost = initial_cost;
+    }
+
+    ladder l = {
+        .provider = provider,
+        .replicas = rs,
+        .moves = config->moves ? config->moves : PT_DEFAULT_MOVES
+    };
+    uint64_t rounds = config->rounds ? config->rounds : PT_DEFAULT_ROUNDS;
+    pt_rng swap_rng;
+    pt_rng_seed(&swap_rng, config->seed ^ 0x5851F42D4C957F2Dull);
+    wp_stats before;
+    wp_stats_get(pool, &before);
+
+    double start = now_s(), elapsed = 0.0, best_cost = initial_cost, best_s = 0.0;
+    double converge_s = initial_cost <= config->target_cost ? 0.0 : -1.0;
+    uint64_t offered = 0, swapped = 0, round = 0;
+    while (round < rounds) {
+        wp_run(pool, n, step_replica, &l);
+        uint64_t round_offered = offered, round_swapped = swapped;
+        exchange(rs, n, (int)(round & 1), &swap_rng, &offered, &swapped);
+        round++;
+        elapsed = now_s() - start;
+
+        for (size_t i = 0; i < n; i++) {
+            if (rs[i].best_cost < best_cost) {
+                best_cost = rs[i].best_cost;
+                best_s = elapsed;
+            }
+        }
+        if (converge_s < 0.0 && best_cost <= config->target_cost) converge_s = elapsed;
+        if (config->on_round) {
+            uint64_t o = offered - round_offered;
+            pt_round info = {
+                .round = round,
+                .seconds = elapsed,
+                .best_cost = best_cost,
+                .swap_rate = o ? (double)(swapped - round_swapped) / o : 0.0
+            };
+            config->on_round(&info, config->user);
+        }
+        if (config->stop_at_target && converge_s >= 0.0) break;
+        if (config->max_seconds > 0.0 && elapsed >= config->max_seconds) break;
+    }
+
+    /* Replicas keep their own best; the first with the overall best wins */
+    size_t winner = 0;
+    for (size_t i = 1; i < n; i++) {
+        if (rs[i].best_cost < rs[winner].best_cost) winner = i;
+    }
+    memcpy(best, rs[winner].best_cost < initial_cost ? rs[winner].best : initial, size);
+
+    if (stats) {
+        wp_stats after;
+        wp_stats_get(pool, &after);
+        memset(stats, 0, sizeof(*stats));
+        stats->threads = threads;
+        stats->replicas = n;
+        stats->rounds = round;
+        for (size_t i = 0; i < n; i++) {
+            stats->moves += rs[i].moves;
+            stats->accepted += rs[i].accepted;
+        }
+        stats->swaps_offered = offered;
+        stats->swaps_accepted = swapped;
+        stats->stolen = after.stolen - before.stolen;
+        stats->initial_cost = initial_cost;
+        stats->best_cost = best_cost;
+        stats->seconds = elapsed;
+        stats->best_s = best_s;
+        stats->converge_s = converge_s;
+        stats->moves_per_s = elapsed > 0.0 ? stats->moves / elapsed : 0.0;
+        stats->cost_drop_per_s = best_s > 0.0 ? (initial_cost - best_cost) / best_s : 0.0;
+    }
+
+    free(states);
+    free(rs);
+    if (!config->pool) wp_destroy(pool);
+    return PT_OK;
+}
@@ -0,0 +1,108 @@
+/**
+ * tempering: parallel tempering (replica exchange) over any cost function and move set.
+ *
+ *   pt_provider p = { sizeof(reading), reading_cost, propose_reading, zone };
+ *   pt_config c = { .replicas = 32, .t_min = 1e-3, .t_max = 0.5, .rounds = 200 };
+ *   pt_stats s;
+ *   pt_run(&p, &c, &start, &best, &s);              best gets the lowest-cost state seen
+ *
+ * Replicas sit on a geometric temperature ladder from t_min to t_max. Every round, each one
+ * makes `moves` Metropolis moves at its own temperature as one task on a work_pool, so a
+ * round spreads over every core. Between rounds, neighbouring rungs offer to swap states,
+ * accepted with probability min(1, exp((1/T_i - 1/T_j)(E_i - E_j))), even pairs and odd
+ * pairs in turn. Hot replicas cross barriers and pass the basins they find down the ladder
+ * while cold ones refine them.
+ *
+ * A replica owns its states and a counter-seeded RNG, and exchanges run on the calling
+ * thread between rounds. Workers share nothing during a round, and a given seed and replica
+ * count give the same result on any number of threads. The provider's callbacks run
+ * concurrently on distinct states and must treat ctx as read-only.
+ *
+ * pt_stats reports convergence against wall-clock time: moves per second, how long the best
+ * cost took to reach target_cost, and how fast it fell. on_round traces the whole curve.
+ */
+#ifndef TEMPERING_H
+#define TEMPERING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "work_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PT_OK 0
+#define PT_EINVAL -1
+#define PT_ENOMEM -2
+
+/* splitmix64; seed it with pt_rng_seed, or any value */
+typedef struct {
+    uint64_t state;
+} pt_rng;
+
+typedef struct {
+    size_t state_size;          /* bytes per state; states are copied with memcpy */
+    double (*cost)(const void *state, void *ctx);
+    /* Write a neighbour of `from` into `to`; larger steps at higher temperatures. */
+    void (*move)(const void *from, void *to, double temperature, pt_rng *rng, void *ctx);
+    void *ctx;
+} pt_provider;
+
+typedef struct {
+    uint64_t round;
+    double seconds;             /* since pt_run started */
+    double best_cost;
+    double swap_rate;           /* accepted / offered exchanges this round */
+} pt_round;
+
+typedef struct {
+    size_t replicas;            /* 0 for 4 per pool thread */
+    double t_min;               /* coldest rung; 0 for 1e-3 */
+    double t_max;               /* hottest rung; 0 for 1 */
+    size_t moves;               /* per replica per round; 0 for 4096 */
+    uint64_t rounds;            /* 0 for 200 */
+    double max_seconds;         /* stop after this much wall time; 0 for no limit */
+    double target_cost;         /* converge_s records when the best cost first reaches it */
+    int stop_at_target;         /* and stop there */
+    uint64_t seed;
+    wp_pool *pool;              /* NULL to start one of `threads` for this run */
+    unsigned threads;           /* 0 for one per core */
+    void (*on_round)(const pt_round *round, void *user);
+    void *user;
+} pt_config;
+
+typedef struct {
+    unsigned threads;
+    size_t replicas;
+    uint64_t rounds;
+    uint64_t moves;
+    uint64_t accepted;
+    uint64_t swaps_offered;
+    uint64_t swaps_accepted;
+    uint64_t stolen;            /* replica rounds run by a thread they were not dealt to */
+    double initial_cost;
+    double best_cost;
+    double seconds;             /* whole run */
+    double best_s;              /* until the best cost was found */
+    double converge_s;          /* until the best cost reached target_cost, or -1 */
+    double moves_per_s;
+    double cost_drop_per_s;     /* (initial_cost - best_cost) / best_s */
+} pt_stats;
+
+void pt_rng_seed(pt_rng *rng, uint64_t seed);
+uint64_t pt_rng_next(pt_rng *rng);
+double pt_uniform(pt_rng *rng);         /* [0, 1) */
+double pt_normal(pt_rng *rng);          /* standard normal */
+
+/* Anneal from `initial` (every replica starts there) and copy the best state found into
+ * `best`. stats may be NULL. PT_OK, PT_EINVAL or PT_ENOMEM. */
+int pt_run(const pt_provider *provider, const pt_config *config, const void *initial,
+           void *best, pt_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
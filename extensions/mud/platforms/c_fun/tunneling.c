@@ -0,0 +1,370 @@
+/**
+ * libtunneling: barometric pressure and tunneling score kernels; see tunneling.h for the API.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "tunneling.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Pressure engines. A uniform grid makes p0 * exp(-(base + i*step) / H) a geometric sequence,
+ * so the recurrence engine evaluates one anchor directly every RECUR_ANCHOR samples and
+ * reaches the rest by multiplying with powers of r = exp(-step / H), RECUR_LANES independent
+ * chains at a time so the multiplies vectorize. No sample is more than
+ * RECUR_ANCHOR / RECUR_LANES + RECUR_LANES multiplies from its anchor, which bounds drift to
+ * about 16 roundings (< 4e-15 relative) on top of the anchor's own error. The recurrence
+ * follows the ideal grid, so against direct evaluation of the rounded alt_m values it may also
+ * differ by ulp(alt_m) / H (about 1e-13 relative at 3e5 m with H = 500 m).
+ *
+ * "engine":"auto" (the default) uses the recurrence for uniform grids when "accuracy" is
+ * "fast" and evaluates every sample directly otherwise, so exact output stays libm-exact.
+ * "engine":"recurrence" uses it whenever the grid is uniform; "engine":"direct" never does.
+ * An "altitudes" list counts as uniform when every entry is within 1e-12 scale heights of
+ * the arithmetic sequence through its first two entries (contributing < 1e-12 relative
+ * pressure error); irregular lists always fall back to direct evaluation.
+ */
+#define RECUR_ANCHOR 64
+#define RECUR_LANES 8
+
+static int altitudes_uniform(const double *alts, uint64_t n, double H, double *step) {
+    if (n < 2) return 0;
+    double d = alts[1] - alts[0];
+    double tol = 1e-12 * fabs(H);
+    for (uint64_t i = 2; i < n; i++) {
+        if (!(fabs(alts[i] - (alts[0] + (double)i * d)) <= tol)) return 0;
+    }
+    *step = d;
+    return 1;
+}
+
+/*
+ * Sample kernels. A chunk is filled in three steps: alt_m (identical for every kernel), then
+ * pressure_Pa from a pressure kernel or the recurrence, then score from a score kernel.
+ *
+ * "accuracy":"exact" (the default) uses libm exp(). "accuracy":"fast" uses tg_exp_fast():
+ * Cody-Waite reduction x = k*ln2 + r, |r| <= ln2/2, then a degree-10 Taylor polynomial for
+ * e^r scaled by 2^k built directly in the exponent bits. Truncation error is below
+ * |r|^11/11! < 2.2e-13; measured over x in [-708, 709] the relative error of exp stays under
+ * 3e-13, and results flush to 0 below that range and saturate to +inf above it.
+ *   pressure_Pa: relative error < 5e-13 (exp error plus one rounding of -alt/H, which the
+ *                fast path computes with a reciprocal).
+ *   score:       1 / (1 + e), e = exp(-1e-4 * (p - 50000)). Where e >= 1 the pressure error
+ *                feeds the exponent (|p| <= 5e4 there), so the relative error is < 3e-12;
+ *                elsewhere it is damped by e / (1 + e). Either way far below the 1e-6 that
+ *                JSON output prints.
+ *
+ * The fast kernels are picked on first use from the running CPU: AVX-512F, else AVX2+FMA
+ * on x86, NEON on AArch64. Without any of those (including 32-bit ARM, whose NEON has no
+ * double precision) the polynomial is not faster than libm, so "fast" falls back to the exact
+ * kernels. TG_KERNEL=scalar|avx2 forces the portable polynomial or caps x86 at AVX2, for
+ * comparing kernels against each other.
+ */
+typedef void (*pressure_kernel)(double p0, double H, const double *alt, double *p, size_t n);
+typedef void (*score_kernel)(const double *p, double *score, size_t n);
+
+typedef struct {
+    pressure_kernel pressure;
+    score_kernel score;
+    double (*exp1)(double);  /* scalar exp matching the kernels, for recurrence anchors */
+} kernel_set;
+
+#define EXP_LOG2E 1.4426950408889634
+#define EXP_LN2_HI 6.93147180369123816490e-01
+#define EXP_LN2_LO 1.90821492927058770002e-10
+#define EXP_MIN_X -708.0
+#define EXP_MAX_X 709.0
+/* Adding 1.5 * 2^52 rounds to an integer whose value sits in the low mantissa bits. */
+#define EXP_ROUND_MAGIC 6755399441055744.0
+#define SCORE_SLOPE -0.0001
+#define SCORE_MIDPOINT_PA 50000.0
+
+static const double EXP_POLY[11] = {
+    1.0, 1.0, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040,
+    1.0 / 40320, 1.0 / 362880, 1.0 / 3628800
+};
+
+static void pressure_exact(double p0, double H, const double *alt, double *p, size_t n) {
+    for (size_t i = 0; i < n; i++) p[i] = p0 * exp(-alt[i] / H);
+}
+
+static void score_exact(const double *p, double *score, size_t n) {
+    for (size_t i = 0; i < n; i++) score[i] = 1.0 / (1.0 + exp(SCORE_SLOPE * (p[i] - SCORE_MIDPOINT_PA)));
+}
+
+static double tg_exp_fast(double x) {
+    double xc = x < EXP_MIN_X ? EXP_MIN_X : x > EXP_MAX_X ? EXP_MAX_X : x;
+    double t = xc * EXP_LOG2E + EXP_ROUND_MAGIC;
+    double k = t - EXP_ROUND_MAGIC;
+    double r = xc - k * EXP_LN2_HI - k * EXP_LN2_LO;
+    double e = EXP_POLY[10];
+    for (int j = 9; j >= 0; j--) e = e * r + EXP_POLY[j];
+    uint64_t bits;
+    memcpy(&bits, &t, sizeof(bits));
+    bits = (bits + 1023) << 52;
+    double scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    e *= scale;
+    e = x < EXP_MIN_X ? 0.0 : e;
+    e = x > EXP_MAX_X ? INFINITY : e;
+    return x != x ? x : e;
+}
+
+static void pressure_fast_scalar(double p0, double H, const double *alt, double *p, size_t n) {
+    double negInvH = -1.0 / H;
+    for (size_t i = 0; i < n; i++) p[i] = p0 * tg_exp_fast(alt[i] * negInvH);
+}
+
+static void score_fast_scalar(const double *p, double *score, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        score[i] = 1.0 / (1.0 + tg_exp_fast(SCORE_SLOPE * (p[i] - SCORE_MIDPOINT_PA)));
+    }
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TG_X86_KERNELS 1
+#include <immintrin.h>
+
+/*
+ * Tails shorter than a vector use masked loads and stores rather than the scalar kernels:
+ * calling the SSE-encoded scalar code with dirty upper vector state costs an AVX-SSE
+ * transition, which measured at hundreds of ns per tail sample.
+ */
+__attribute__((target("avx2")))
+static inline __m256i tail_mask_avx2(size_t rem) {
+    return _mm256_cmpgt_epi64(_mm256_set1_epi64x((long long)rem), _mm256_setr_epi64x(0, 1, 2, 3));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256d tg_exp_avx2(__m256d x) {
+    __m256d xc = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(EXP_MIN_X)), _mm256_set1_pd(EXP_MAX_X));
+    __m256d t = _mm256_fmadd_pd(xc, _mm256_set1_pd(EXP_LOG2E), _mm256_set1_pd(EXP_ROUND_MAGIC));
+    __m256d k = _mm256_sub_pd(t, _mm256_set1_pd(EXP_ROUND_MAGIC));
+    __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(EXP_LN2_HI), xc);
+    r = _mm256_fnmadd_pd(k, _mm256_set1_pd(EXP_LN2_LO), r);
+    __m256d e = _mm256_set1_pd(EXP_POLY[10]);
+    for (int j = 9; j >= 0; j--) e = _mm256_fmadd_pd(e, r, _mm256_set1_pd(EXP_POLY[j]));
+    __m256i bits = _mm256_slli_epi64(_mm256_add_epi64(_mm256_castpd_si256(t), _mm256_set1_epi64x(1023)), 52);
+    e = _mm256_mul_pd(e, _mm256_castsi256_pd(bits));
+    e = _mm256_blendv_pd(e, _mm256_setzero_pd(), _mm256_cmp_pd(x, _mm256_set1_pd(EXP_MIN_X), _CMP_LT_OQ));
+    e = _mm256_blendv_pd(e, _mm256_set1_pd(INFINITY), _mm256_cmp_pd(x, _mm256_set1_pd(EXP_MAX_X), _CMP_GT_OQ));
+    return _mm256_blendv_pd(e, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+}
+
+__attribute__((target("avx2,fma")))
+static void pressure_fast_avx2(double p0, double H, const double *alt, double *p, size_t n) {
+    const __m256d negInvH = _mm256_set1_pd(-1.0 / H), vp0 = _mm256_set1_pd(p0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d a = _mm256_loadu_pd(alt + i);
+        _mm256_storeu_pd(p + i, _mm256_mul_pd(vp0, tg_exp_avx2(_mm256_mul_pd(a, negInvH))));
+    }
+    if (i < n) {
+        __m256i m = tail_mask_avx2(n - i);
+        __m256d a = _mm256_maskload_pd(alt + i, m);
+        _mm256_maskstore_pd(p + i, m, _mm256_mul_pd(vp0, tg_exp_avx2(_mm256_mul_pd(a, negInvH))));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void score_fast_avx2(const double *p, double *score, size_t n) {
+    const __m256d slope = _mm256_set1_pd(SCORE_SLOPE), mid = _mm256_set1_pd(SCORE_MIDPOINT_PA);
+    const __m256d one = _mm256_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d e = tg_exp_avx2(_mm256_mul_pd(slope, _mm256_sub_pd(_mm256_loadu_pd(p + i), mid)));
+        _mm256_storeu_pd(score + i, _mm256_div_pd(one, _mm256_add_pd(one, e)));
+    }
+    if (i < n) {
+        __m256i m = tail_mask_avx2(n - i);
+        __m256d e = tg_exp_avx2(_mm256_mul_pd(slope, _mm256_sub_pd(_mm256_maskload_pd(p + i, m), mid)));
+        _mm256_maskstore_pd(score + i, m, _mm256_div_pd(one, _mm256_add_pd(one, e)));
+    }
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d tg_exp_avx512(__m512d x) {
+    __m512d xc = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(EXP_MIN_X)), _mm512_set1_pd(EXP_MAX_X));
+    __m512d t = _mm512_fmadd_pd(xc, _mm512_set1_pd(EXP_LOG2E), _mm512_set1_pd(EXP_ROUND_MAGIC));
+    __m512d k = _mm512_sub_pd(t, _mm512_set1_pd(EXP_ROUND_MAGIC));
+    __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(EXP_LN2_HI), xc);
+    r = _mm512_fnmadd_pd(k, _mm512_set1_pd(EXP_LN2_LO), r);
+    __m512d e = _mm512_set1_pd(EXP_POLY[10]);
+    for (int j = 9; j >= 0; j--) e = _mm512_fmadd_pd(e, r, _mm512_set1_pd(EXP_POLY[j]));
+    __m512i bits = _mm512_slli_epi64(_mm512_add_epi64(_mm512_castpd_si512(t), _mm512_set1_epi64(1023)), 52);
+    e = _mm512_mul_pd(e, _mm512_castsi512_pd(bits));
+    e = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_set1_pd(EXP_MIN_X), _CMP_LT_OQ), e, _mm512_setzero_pd());
+    e = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_set1_pd(EXP_MAX_X), _CMP_GT_OQ), e, _mm512_set1_pd(INFINITY));
+    return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, x, _CMP_UNORD_Q), e, x);
+}
+
+__attribute__((target("avx512f")))
+static void pressure_fast_avx512(double p0, double H, const double *alt, double *p, size_t n) {
+    const __m512d negInvH = _mm512_set1_pd(-1.0 / H), vp0 = _mm512_set1_pd(p0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d a = _mm512_loadu_pd(alt + i);
+        _mm512_storeu_pd(p + i, _mm512_mul_pd(vp0, tg_exp_avx512(_mm512_mul_pd(a, negInvH))));
+    }
+    if (i < n) {
+        __mmask8 m = (__mmask8)((1u << (n - i)) - 1);
+        __m512d a = _mm512_maskz_loadu_pd(m, alt + i);
+        _mm512_mask_storeu_pd(p + i, m, _mm512_mul_pd(vp0, tg_exp_avx512(_mm512_mul_pd(a, negInvH))));
+    }
+}
+
+__attribute__((target("avx512f")))
+static void score_fast_avx512(const double *p, double *score, size_t n) {
+    const __m512d slope = _mm512_set1_pd(SCORE_SLOPE), mid = _mm512_set1_pd(SCORE_MIDPOINT_PA);
+    const __m512d one = _mm512_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d e = tg_exp_avx512(_mm512_mul_pd(slope, _mm512_sub_pd(_mm512_loadu_pd(p + i), mid)));
+        _mm512_storeu_pd(score + i, _mm512_div_pd(one, _mm512_add_pd(one, e)));
+    }
+    if (i < n) {
+        __mmask8 m = (__mmask8)((1u << (n - i)) - 1);
+        __m512d e = tg_exp_avx512(_mm512_mul_pd(slope, _mm512_sub_pd(_mm512_maskz_loadu_pd(m, p + i), mid)));
+        _mm512_mask_storeu_pd(score + i, m, _mm512_div_pd(one, _mm512_add_pd(one, e)));
+    }
+}
+#endif
+
+#if defined(__aarch64__)
+#define TG_NEON_KERNELS 1
+#include <arm_neon.h>
+
+static inline float64x2_t tg_exp_neon(float64x2_t x) {
+    float64x2_t xc = vminq_f64(vmaxq_f64(x, vdupq_n_f64(EXP_MIN_X)), vdupq_n_f64(EXP_MAX_X));
+    float64x2_t t = vfmaq_f64(vdupq_n_f64(EXP_ROUND_MAGIC), xc, vdupq_n_f64(EXP_LOG2E));
+    float64x2_t k = vsubq_f64(t, vdupq_n_f64(EXP_ROUND_MAGIC));
+    float64x2_t r = vfmsq_f64(xc, k, vdupq_n_f64(EXP_LN2_HI));
+    r = vfmsq_f64(r, k, vdupq_n_f64(EXP_LN2_LO));
+    float64x2_t e = vdupq_n_f64(EXP_POLY[10]);
+    for (int j = 9; j >= 0; j--) e = vfmaq_f64(vdupq_n_f64(EXP_POLY[j]), e, r);
+    int64x2_t bits = vshlq_n_s64(vaddq_s64(vreinterpretq_s64_f64(t), vdupq_n_s64(1023)), 52);
+    e = vmulq_f64(e, vreinterpretq_f64_s64(bits));
+    e = vbslq_f64(vcltq_f64(x, vdupq_n_f64(EXP_MIN_X)), vdupq_n_f64(0.0), e);
+    e = vbslq_f64(vcgtq_f64(x, vdupq_n_f64(EXP_MAX_X)), vdupq_n_f64(INFINITY), e);
+    return vbslq_f64(vceqq_f64(x, x), e, x);
+}
+
+static void pressure_fast_neon(double p0, double H, const double *alt, double *p, size_t n) {
+    const float64x2_t negInvH = vdupq_n_f64(-1.0 / H), vp0 = vdupq_n_f64(p0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t a = vld1q_f64(alt + i);
+        vst1q_f64(p + i, vmulq_f64(vp0, tg_exp_neon(vmulq_f64(a, negInvH))));
+    }
+    pressure_fast_scalar(p0, H, alt + i, p + i, n - i);
+}
+
+static void score_fast_neon(const double *p, double *score, size_t n) {
+    const float64x2_t slope = vdupq_n_f64(SCORE_SLOPE), mid = vdupq_n_f64(SCORE_MIDPOINT_PA);
+    const float64x2_t one = vdupq_n_f64(1.0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t e = tg_exp_neon(vmulq_f64(slope, vsubq_f64(vld1q_f64(p + i), mid)));
+        vst1q_f64(score + i, vdivq_f64(one, vaddq_f64(one, e)));
+    }
+    score_fast_scalar(p + i, score + i, n - i);
+}
+#endif
+
+static const kernel_set EXACT_KERNELS = { pressure_exact, score_exact, exp };
+static kernel_set fast_kernels = { pressure_exact, score_exact, exp };
+static const char *fast_kernel_name = "exact";
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+/* Pick the fast kernels for this CPU; runs once, before the first grid is prepared. */
+static void select_fast_kernel(void) {
+    const char *force = getenv("TG_KERNEL");
+    if (force && strcmp(force, "scalar") == 0) {
+        fast_kernels = (kernel_set){ pressure_fast_scalar, score_fast_scalar, tg_exp_fast };
+        fast_kernel_name = "scalar";
+        return;
+    }
+#if defined(TG_X86_KERNELS)
+    __builtin_cpu_init();
+    int avx512 = __builtin_cpu_supports("avx512f");
+    int avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (force && strcmp(force, "avx2") == 0) avx512 = 0;
+    if (avx512) {
+        fast_kernels = (kernel_set){ pressure_fast_avx512, score_fast_avx512, tg_exp_fast };
+        fast_kernel_name = "avx512";
+    } else if (avx2) {
+        fast_kernels = (kernel_set){ pressure_fast_avx2, score_fast_avx2, tg_exp_fast };
+        fast_kernel_name = "avx2";
+    }
+#elif defined(TG_NEON_KERNELS)
+    fast_kernels = (kernel_set){ pressure_fast_neon, score_fast_neon, tg_exp_fast };
+    fast_kernel_name = "neon";
+#endif
+}
+
+const char *tg_kernel_name(void) {
+    pthread_once(&kernel_once, select_fast_kernel);
+    return fast_kernel_name;
+}
+
+void tg_params_init(tg_params *params) {
+    *params = (tg_params){
+        .baseAlt_m = 0, .step_m = 1, .scaleHeight_m = 8500, .surfacePressure_Pa = 101325,
+        .altitudes = NULL, .accuracy = TG_ACCURACY_EXACT, .engine = TG_ENGINE_AUTO
+    };
+}
+
+/* Resolve the pressure engine for a grid once its parameters are final. */
+void tg_grid_prepare(tg_grid *grid) {
+    const tg_params *g = &grid->params;
+    pthread_once(&kernel_once, select_fast_kernel);
+    int uniform = 1;
+    double step = g->step_m;
+    if (g->altitudes) uniform = altitudes_uniform(g->altitudes, grid->n, g->scaleHeight_m, &step);
+    int want = g->engine == TG_ENGINE_RECURRENCE ||
+               (g->engine == TG_ENGINE_AUTO && g->accuracy == TG_ACCURACY_FAST);
+    grid->recurrence = want && uniform && grid->n > RECUR_LANES;
+    grid->ratio = grid->recurrence ? exp(-step / g->scaleHeight_m) : 0;
+}
+
+/* Recurrence pressure for a uniform chunk whose alt[] is already filled; see tg_grid_prepare(). */
+static void pressure_recurrence(const tg_grid *grid, const kernel_set *ks,
+                                const double *alt, double *p, size_t n) {
+    double p0 = grid->params.surfacePressure_Pa, H = grid->params.scaleHeight_m;
+    double rpow[RECUR_LANES + 1];
+    rpow[0] = 1.0;
+    for (int j = 1; j <= RECUR_LANES; j++) rpow[j] = rpow[j - 1] * grid->ratio;
+    for (size_t a = 0; a < n; a += RECUR_ANCHOR) {
+        size_t m = n - a < RECUR_ANCHOR ? n - a : RECUR_ANCHOR;
+        double anchor = p0 * ks->exp1(-alt[a] / H);
+        double *q = p + a;
+        size_t j = 0;
+        for (; j < m && j < RECUR_LANES; j++) q[j] = anchor * rpow[j];
+        for (; j < m; j++) q[j] = q[j - RECUR_LANES] * rpow[RECUR_LANES];
+    }
+}
+
+void tg_grid_eval(const tg_grid *grid, uint64_t start, size_t count,
+                  double *alt, double *pressure, double *score) {
+    const tg_params *g = &grid->params;
+    const kernel_set *ks = g->accuracy == TG_ACCURACY_FAST ? &fast_kernels : &EXACT_KERNELS;
+    if (g->altitudes) {
+        memcpy(alt, g->altitudes + start, count * sizeof(double));
+    } else {
+        for (size_t i = 0; i < count; i++) alt[i] = g->baseAlt_m + (double)(start + i) * g->step_m;
+    }
+    if (grid->recurrence) pressure_recurrence(grid, ks, alt, pressure, count);
+    else ks->pressure(g->surfacePressure_Pa, g->scaleHeight_m, alt, pressure, count);
+    ks->score(pressure, score, count);
+}
+
+int tg_sample(const tg_params *params, double *alt, double *pressure, double *score, size_t n) {
+    if (!params || (n && (!alt || !pressure || !score))) return TG_EINVAL;
+    tg_grid grid = { .params = *params, .n = n };
+    tg_grid_prepare(&grid);
+    tg_grid_eval(&grid, 0, n, alt, pressure, score);
+    return TG_OK;
+}
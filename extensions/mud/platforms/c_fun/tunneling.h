@@ -0,0 +1,76 @@
+/**
+ * libtunneling: the sampling kernel behind tunneling_grid, callable in-process.
+ * Build: make libtunneling   (libtunneling.a and libtunneling.so)
+ *
+ *   tg_params p;
+ *   tg_params_init(&p);
+ *   p.step_m = 2;
+ *   tg_sample(&p, alt, pressure, score, n);
+ *
+ * Every call writes n samples straight into the caller's arrays: alt_m, pressure_Pa and a toy
+ * tunneling score in [0, 1]. Nothing is allocated and no global state changes after the first
+ * call, so any number of threads may sample concurrently. The accuracy and engine knobs
+ * behave exactly like the "accuracy" and "engine" request keys of tunneling_grid.
+ */
+#ifndef TUNNELING_H
+#define TUNNELING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever tg_params or tg_grid change layout. */
+#define TG_API_VERSION 1
+
+#define TG_OK 0
+#define TG_EINVAL -1
+
+enum { TG_ACCURACY_EXACT = 0, TG_ACCURACY_FAST = 1 };
+enum { TG_ENGINE_AUTO = 0, TG_ENGINE_DIRECT = 1, TG_ENGINE_RECURRENCE = 2 };
+
+typedef struct {
+    double baseAlt_m;           /* altitude of sample 0 */
+    double step_m;              /* spacing between samples */
+    double scaleHeight_m;       /* barometric scale height H */
+    double surfacePressure_Pa;  /* pressure at 0 m */
+    const double *altitudes;    /* explicit altitudes (n entries) instead of base/step, or NULL */
+    int accuracy;               /* TG_ACCURACY_* */
+    int engine;                 /* TG_ENGINE_* */
+} tg_params;
+
+/*
+ * A grid of n samples prepared for repeated, chunked evaluation. Fill `params` and `n`, call
+ * tg_grid_prepare() once, then tg_grid_eval() any sub-range from any thread. The fields
+ * below the marker are derived and private.
+ */
+typedef struct {
+    tg_params params;
+    uint64_t n;
+    /* Derived by tg_grid_prepare(): */
+    int recurrence;
+    double ratio;
+} tg_grid;
+
+/* Defaults: base 0 m, step 1 m, H 8500 m, 101325 Pa, exact, auto. */
+void tg_params_init(tg_params *params);
+
+void tg_grid_prepare(tg_grid *grid);
+
+/* Fill samples [start, start + count) of a prepared grid. */
+void tg_grid_eval(const tg_grid *grid, uint64_t start, size_t count,
+                  double *alt, double *pressure, double *score);
+
+/* Prepare and evaluate n samples in one call; TG_EINVAL on NULL arguments. */
+int tg_sample(const tg_params *params, double *alt, double *pressure, double *score, size_t n);
+
+/* Name of the kernel "fast" accuracy runs on this CPU: avx512, avx2, neon, scalar or exact. */
+const char *tg_kernel_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
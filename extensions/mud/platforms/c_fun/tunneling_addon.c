@@ -0,0 +1,137 @@
+/**
+ * N-API binding for libtunneling: samples straight into caller-owned Float64Arrays.
+ * Build: npx node-gyp rebuild   (from this directory; produces build/Release/tunneling.node)
+ *
+ *   const tg = require('./build/Release/tunneling.node');
+ *   const n = 4096;
+ *   const alt = new Float64Array(n), p = new Float64Array(n), score = new Float64Array(n);
+ *   tg.sample({ baseAlt_m: 0, step_m: 2, accuracy: 'fast' }, alt, p, score);
+ *
+ * sample(params, alt, pressure, score) fills all three arrays (n = alt.length; the other two
+ * must be at least that long) and returns n. params takes the tunneling_grid request keys
+ * baseAlt_m, step_m, scaleHeight_m, surfacePressure_Pa, accuracy, engine, plus altitudes as a
+ * Float64Array of at least n entries. Nothing is copied or serialized; the call runs on the
+ * calling thread. tg.kernel names the kernel "fast" accuracy uses on this machine.
+ */
+#define NAPI_VERSION 6
+#include <node_api.h>
+#include <string.h>
+
+#include "tunneling.h"
+
+#define NAPI_CALL(env, call)                \
+    do {                                    \
+        if ((call) != napi_ok) return NULL; \
+    } while (0)
+
+static int get_f64_array(napi_env env, napi_value v, double **data, size_t *len) {
+    bool isTyped = false;
+    napi_typedarray_type type;
+    void *ptr = NULL;
+    if (napi_is_typedarray(env, v, &isTyped) != napi_ok || !isTyped) return -1;
+    if (napi_get_typedarray_info(env, v, &type, len, &ptr, NULL, NULL) != napi_ok) return -1;
+    if (type != napi_float64_array) return -1;
+    *data = ptr;
+    return 0;
+}
+
+/* Read params[key] as a number into *out if present; -1 if present with another type. */
+static int get_number(napi_env env, napi_value obj, const char *key, double *out) {
+    bool has = false;
+    napi_value v;
+    napi_valuetype t;
+    if (napi_has_named_property(env, obj, key, &has) != napi_ok) return -1;
+    if (!has) return 0;
+    if (napi_get_named_property(env, obj, key, &v) != napi_ok || napi_typeof(env, v, &t) != napi_ok) return -1;
+    if (t == napi_undefined) return 0;
+    if (t != napi_number) return -1;
+    return napi_get_value_double(env, v, out) == napi_ok ? 0 : -1;
+}
+
+/* Match params[key] against `options`; *out keeps its value when the key is absent. */
+static int get_choice(napi_env env, napi_value obj, const char *key,
+                      const char *const *options, int count, int *out) {
+    bool has = false;
+    napi_value v;
+    napi_valuetype t;
+    char buf[16];
+    size_t len = 0;
+    if (napi_has_named_property(env, obj, key, &has) != napi_ok) return -1;
+    if (!has) return 0;
+    if (napi_get_named_property(env, obj, key, &v) != napi_ok || napi_typeof(env, v, &t) != napi_ok) return -1;
+    if (t == napi_undefined) return 0;
+    if (t != napi_string || napi_get_value_string_utf8(env, v, buf, sizeof(buf), &len) != napi_ok) return -1;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(options[i], buf) == 0) {
+            *out = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static const char *const ACCURACY_NAMES[] = { "exact", "fast" };
+static const char *const ENGINE_NAMES[] = { "auto", "direct", "recurrence" };
+
+static napi_value tg_sample_js(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value argv[4], result;
+    napi_valuetype t;
+    double *alt, *p, *score;
+    size_t n, np, ns;
+    tg_params params;
+    NAPI_CALL(env, napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+    if (argc < 4 || napi_typeof(env, argv[0], &t) != napi_ok || t != napi_object) {
+        napi_throw_type_error(env, NULL, "sample(params, alt, pressure, score) expects a params object");
+        return NULL;
+    }
+    if (get_f64_array(env, argv[1], &alt, &n) || get_f64_array(env, argv[2], &p, &np) ||
+        get_f64_array(env, argv[3], &score, &ns)) {
+        napi_throw_type_error(env, NULL, "alt, pressure and score must be Float64Arrays");
+        return NULL;
+    }
+    if (np < n || ns < n) {
+        napi_throw_range_error(env, NULL, "pressure and score must be at least as long as alt");
+        return NULL;
+    }
+    tg_params_init(&params);
+    if (get_number(env, argv[0], "baseAlt_m", &params.baseAlt_m) ||
+        get_number(env, argv[0], "step_m", &params.step_m) ||
+        get_number(env, argv[0], "scaleHeight_m", &params.scaleHeight_m) ||
+        get_number(env, argv[0], "surfacePressure_Pa", &params.surfacePressure_Pa) ||
+        get_choice(env, argv[0], "accuracy", ACCURACY_NAMES, 2, &params.accuracy) ||
+        get_choice(env, argv[0], "engine", ENGINE_NAMES, 3, &params.engine)) {
+        napi_throw_type_error(env, NULL, "malformed tunneling params");
+        return NULL;
+    }
+    bool hasAlts = false;
+    NAPI_CALL(env, napi_has_named_property(env, argv[0], "altitudes", &hasAlts));
+    if (hasAlts) {
+        napi_value v;
+        double *alts;
+        size_t na;
+        NAPI_CALL(env, napi_get_named_property(env, argv[0], "altitudes", &v));
+        NAPI_CALL(env, napi_typeof(env, v, &t));
+        if (t != napi_undefined && t != napi_null) {
+            if (get_f64_array(env, v, &alts, &na) || na < n) {
+                napi_throw_type_error(env, NULL, "altitudes must be a Float64Array at least as long as alt");
+                return NULL;
+            }
+            params.altitudes = alts;
+        }
+    }
+    tg_sample(&params, alt, p, score, n);
+    NAPI_CALL(env, napi_create_double(env, (double)n, &result));
+    return result;
+}
+
+static napi_value init(napi_env env, napi_value exports) {
+    napi_value fn, kernel;
+    NAPI_CALL(env, napi_create_function(env, "sample", NAPI_AUTO_LENGTH, tg_sample_js, NULL, &fn));
+    NAPI_CALL(env, napi_set_named_property(env, exports, "sample", fn));
+    NAPI_CALL(env, napi_create_string_utf8(env, tg_kernel_name(), NAPI_AUTO_LENGTH, &kernel));
+    NAPI_CALL(env, napi_set_named_property(env, exports, "kernel", kernel));
+    return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, init)
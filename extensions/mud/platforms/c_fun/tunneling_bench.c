@@ -0,0 +1,283 @@
+/**
+ * Benchmark driver for libtunneling and tunneling_grid.
+ * Build and run: make bench   (or ./tunneling_bench [--quick] [--grid ./tunneling_grid])
+ *
+ * Prints one JSON object per line so results can be appended to a log and compared:
+ *   {"bench":"host",...}       the fast kernel this CPU selects and the core count
+ *   {"bench":"kernel",...}     samples/sec of one kernel at one grid size
+ *   {"bench":"latency",...}    p50/p99 wall time of one small request end to end
+ *
+ * Kernel runs cover exact (libm), the portable polynomial ("scalar"), the SIMD kernel picked
+ * for this CPU, and the recurrence engine over exact and fast anchors, at sizes 8 through
+ * 1e7. Each variant runs in a forked child with TG_KERNEL set, because the library picks its
+ * kernels once per process. Grids are evaluated in CHUNK_SAMPLES pieces into cache-resident
+ * buffers, as tunneling_grid does, so the figures are kernel cost rather than memory
+ * bandwidth. A size is repeated until MIN_SECONDS have elapsed and the median rep is reported.
+ *
+ * Latency runs time a numSamples=8 request: spawned as a fresh ./tunneling_grid process per
+ * request ("oneshot"), and pipelined one at a time through a single --serve process ("serve").
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tunneling.h"
+
+extern char **environ;
+
+#define CHUNK_SAMPLES 1024
+#define MIN_SECONDS 0.2
+#define MAX_REPS 1001
+#define ONESHOT_REQUESTS 200
+#define SERVE_REQUESTS 5000
+
+static const char LATENCY_REQUEST[] = "{\"id\":1,\"baseAlt_m\":0,\"step_m\":2,\"numSamples\":8}\n";
+
+typedef struct {
+    const char *name;
+    const char *tgKernel;  /* TG_KERNEL for the child process, or NULL for the CPU default */
+    int accuracy;
+    int engine;
+} variant;
+
+static const variant VARIANTS[] = {
+    { "exact", NULL, TG_ACCURACY_EXACT, TG_ENGINE_DIRECT },
+    { "scalar", "scalar", TG_ACCURACY_FAST, TG_ENGINE_DIRECT },
+    { "simd", NULL, TG_ACCURACY_FAST, TG_ENGINE_DIRECT },
+    { "recurrence", NULL, TG_ACCURACY_EXACT, TG_ENGINE_RECURRENCE },
+    { "recurrence-fast", NULL, TG_ACCURACY_FAST, TG_ENGINE_RECURRENCE },
+};
+
+static const uint64_t SIZES[] = { 8, 100, 1000, 10000, 100000, 1000000, 10000000 };
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* q-th quantile (0..1) of the sorted samples, nearest rank. */
+static double quantile(const double *sorted, int n, double q) {
+    int k = (int)(q * n + 0.999999) - 1;
+    if (k < 0) k = 0;
+    if (k >= n) k = n - 1;
+    return sorted[k];
+}
+
+/* Keeps the optimizer from discarding results. */
+static volatile double sink;
+
+static void run_variant(const variant *v, int quick) {
+    static double alt[CHUNK_SAMPLES], p[CHUNK_SAMPLES], score[CHUNK_SAMPLES];
+    static double reps[MAX_REPS];
+    const char *kernel = v->accuracy == TG_ACCURACY_FAST ? tg_kernel_name() : "exact";
+    int nSizes = (int)(sizeof(SIZES) / sizeof(SIZES[0])) - (quick ? 2 : 0);
+    for (int si = 0; si < nSizes; si++) {
+        tg_grid g;
+        tg_params_init(&g.params);
+        g.params.accuracy = v->accuracy;
+        g.params.engine = v->engine;
+        g.params.step_m = 0.01;
+        g.n = SIZES[si];
+        int nReps = -1;  /* rep -1 is an untimed warm-up */
+        double started = now_s();
+        while (nReps < MAX_REPS && (nReps < 3 || now_s() - started < (quick ? MIN_SECONDS / 4 : MIN_SECONDS))) {
+            double t0 = now_s();
+            tg_grid_prepare(&g);
+            for (uint64_t start = 0; start < g.n; start += CHUNK_SAMPLES) {
+                size_t count = (size_t)(g.n - start < CHUNK_SAMPLES ? g.n - start : CHUNK_SAMPLES);
+                tg_grid_eval(&g, start, count, alt, p, score);
+            }
+            sink = score[0];
+            if (nReps >= 0) reps[nReps] = now_s() - t0;
+            nReps++;
+        }
+        qsort(reps, (size_t)nReps, sizeof(double), cmp_double);
+        double median = reps[nReps / 2];
+        printf("{\"bench\":\"kernel\",\"variant\":\"%s\",\"kernel\":\"%s\",\"recurrence\":%s,"
+               "\"n\":%llu,\"reps\":%d,\"seconds\":%.9f,\"samplesPerSec\":%.0f}\n",
+               v->name, kernel, g.recurrence ? "true" : "false", (unsigned long long)g.n, nReps,
+               median, median > 0 ? (double)g.n / median : 0.0);
+    }
+    fflush(stdout);
+}
+
+/* Run every variant in its own child so TG_KERNEL takes effect. */
+static int run_kernels(int quick) {
+    for (size_t i = 0; i < sizeof(VARIANTS) / sizeof(VARIANTS[0]); i++) {
+        const variant *v = &VARIANTS[i];
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0) return -1;
+        if (pid == 0) {
+            if (v->tgKernel) setenv("TG_KERNEL", v->tgKernel, 1);
+            else unsetenv("TG_KERNEL");
+            /* The SIMD variant is only meaningful when the CPU has a SIMD kernel. */
+            const char *name = tg_kernel_name();
+            if (strcmp(v->name, "simd") == 0 && (strcmp(name, "exact") == 0 || strcmp(name, "scalar") == 0)) _exit(0);
+            run_variant(v, quick);
+            _exit(0);
+        }
+        int status;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) return -1;
+    }
+    return 0;
+}
+
+typedef struct {
+    pid_t pid;
+    int in;   /* write end of the child's stdin */
+    int out;  /* read end of the child's stdout */
+} child;
+
+static int spawn_grid(const char *grid, int serve, child *c) {
+    int toChild[2], fromChild[2];
+    if (pipe(toChild)) return -1;
+    if (pipe(fromChild)) {
+        close(toChild[0]);
+        close(toChild[1]);
+        return -1;
+    }
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, toChild[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, fromChild[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&fa, toChild[1]);
+    posix_spawn_file_actions_addclose(&fa, fromChild[0]);
+    char *argv[] = { (char *)grid, serve ? "--serve" : NULL, NULL };
+    int rc = posix_spawn(&c->pid, grid, &fa, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    close(toChild[0]);
+    close(fromChild[1]);
+    c->in = toChild[1];
+    c->out = fromChild[0];
+    if (rc) {
+        close(c->in);
+        close(c->out);
+        return -1;
+    }
+    return 0;
+}
+
+static int write_all(int fd, const char *s, size_t n) {
+    while (n) {
+        ssize_t k = write(fd, s, n);
+        if (k <= 0) return -1;
+        s += k;
+        n -= (size_t)k;
+    }
+    return 0;
+}
+
+/* Read up to and including the next newline; 0 on success. */
+static int read_line(int fd) {
+    char buf[4096];
+    for (;;) {
+        ssize_t k = read(fd, buf, sizeof(buf));
+        if (k <= 0) return -1;
+        if (memchr(buf, '\n', (size_t)k)) return 0;
+    }
+}
+
+static void print_latency(const char *mode, double *lat, int n) {
+    qsort(lat, (size_t)n, sizeof(double), cmp_double);
+    printf("{\"bench\":\"latency\",\"mode\":\"%s\",\"requests\":%d,\"p50_us\":%.1f,\"p99_us\":%.1f,"
+           "\"max_us\":%.1f}\n", mode, n, quantile(lat, n, 0.50) * 1e6, quantile(lat, n, 0.99) * 1e6,
+           lat[n - 1] * 1e6);
+    fflush(stdout);
+}
+
+static int run_oneshot(const char *grid, int requests) {
+    double *lat = malloc(sizeof(double) * (size_t)requests);
+    if (!lat) return -1;
+    for (int i = 0; i < requests; i++) {
+        child c;
+        double t0 = now_s();
+        if (spawn_grid(grid, 0, &c)) {
+            free(lat);
+            return -1;
+        }
+        int ok = write_all(c.in, LATENCY_REQUEST, sizeof(LATENCY_REQUEST) - 1) == 0;
+        close(c.in);
+        ok = ok && read_line(c.out) == 0;
+        close(c.out);
+        int status;
+        waitpid(c.pid, &status, 0);
+        lat[i] = now_s() - t0;
+        if (!ok) {
+            free(lat);
+            return -1;
+        }
+    }
+    print_latency("oneshot", lat, requests);
+    free(lat);
+    return 0;
+}
+
+static int run_serve(const char *grid, int requests) {
+    double *lat = malloc(sizeof(double) * (size_t)requests);
+    child c;
+    if (!lat || spawn_grid(grid, 1, &c)) {
+        free(lat);
+        return -1;
+    }
+    int ok = 1;
+    for (int i = 0; ok && i < requests; i++) {
+        double t0 = now_s();
+        ok = write_all(c.in, LATENCY_REQUEST, sizeof(LATENCY_REQUEST) - 1) == 0 && read_line(c.out) == 0;
+        lat[i] = now_s() - t0;
+    }
+    close(c.in);
+    close(c.out);
+    int status;
+    waitpid(c.pid, &status, 0);
+    if (ok) print_latency("serve", lat, requests);
+    free(lat);
+    return ok ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    const char *grid = "./tunneling_grid";
+    int quick = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) quick = 1;
+        else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) grid = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--quick] [--grid PATH]\n", argv[0]);
+            return 2;
+        }
+    }
+    signal(SIGPIPE, SIG_IGN);
+    /* Report the default kernel from a child too, so this process stays uninitialized. */
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        printf("{\"bench\":\"host\",\"fastKernel\":\"%s\",\"cpus\":%ld,\"apiVersion\":%d}\n",
+               tg_kernel_name(), sysconf(_SC_NPROCESSORS_ONLN), TG_API_VERSION);
+        fflush(stdout);
+        _exit(0);
+    }
+    if (pid > 0) waitpid(pid, NULL, 0);
+    if (run_kernels(quick)) {
+        fprintf(stderr, "tunneling_bench: kernel run failed\n");
+        return 1;
+    }
+    if (run_oneshot(grid, quick ? ONESHOT_REQUESTS / 4 : ONESHOT_REQUESTS) ||
+        run_serve(grid, quick ? SERVE_REQUESTS / 5 : SERVE_REQUESTS)) {
+        fprintf(stderr, "tunneling_bench: latency run against %s failed\n", grid);
+        return 1;
+    }
+    return 0;
+}
@@ -1,12 +1,78 @@
 /**
  * Optional numeric kernel: sample a toy tunneling score on a 1D grid of altitudes (m).
  * Build: make tunneling_grid
+ * The sampling math lives in libtunneling (tunneling.h); this file is the request front end.
  * Usage: echo '{"baseAlt_m":0,"step_m":2,"numSamples":5,"scaleHeight_m":8500,"surfacePressure_Pa":101325}' | ./tunneling_grid
+ *
+ * Server mode: ./tunneling_grid --serve
+ *   Reads one JSON request per line and writes one response line per request, flushed
+ *   immediately, until stdin closes. An optional "id" (number or string) is echoed back
+ *   verbatim so callers can pipeline requests and match responses.
+ *
+ * Batch: {"grids":[{"id":"p1","baseAlt_m":0,"numSamples":64},{"id":"p2","baseAlt_m":500}],"threads":4}
+ *   Evaluates every grid in one request; top-level keys are defaults for each grid and
+ *   "threads" (0 = one per core) spreads whole grids across worker threads.
+ *
+ * Irregular grids: "altitudes":[0,10,35,80] replaces baseAlt_m/step_m/numSamples.
+ * "engine" (auto | direct | recurrence) picks how pressure is evaluated; see tunneling.c.
+ *
+ * Volumes: "latMin_deg"/"latMax_deg"/"latStep_deg" (and the lon equivalents) evaluate a
+ * lat x lon grid of altitude columns across threads into one contiguous, mappable array,
+ * optionally written in place to "outPath"; see handle_volume().
+ *
+ * Keys a build does not know are skipped and listed in the response as "unknownKeys"; a known
+ * key with a value of the wrong type fails with {"ok":false,"error":"malformed","key":...}.
+ *
+ * numSamples is not capped. Samples are evaluated CHUNK_SAMPLES at a time and formatted
+ * straight into a fixed OUT_BUF_SIZE output buffer, so a single grid (or an unthreaded
+ * batch) streams JSON in constant memory however many samples it asks for. A binary frame
+ * holds its pressure and score arrays (16 bytes a sample) until alt_m is written, in one
+ * buffer an unthreaded batch sizes for its largest grid and takes before the first frame,
+ * and threaded batches hold each grid's samples until it is written.
+ *
+ * Binary output: "format":"f64le" in a request, or --binary on the command line (any
+ * request may still ask for "format":"json"). Each grid is written as one frame:
+ *   offset  size  field
+ *        0     4  magic "TGF1"
+ *        4     2  version (1), u16 LE
+ *        6     2  header size in bytes (40), u16 LE
+ *        8     4  flags, u32 LE (bit 0: header carries a numeric request id;
+ *                                 bit 1: the request had keys this build does not know)
+ *       12     4  grid index, u32 LE
+ *       16     4  grid count, u32 LE
+ *       20     4  reserved (0)
+ *       24     8  numSamples n, u64 LE
+ *       32     8  request id, i64 LE (integral "id" values only; 0 otherwise)
+ *       40   8*n  alt_m[n], then pressure_Pa[n], then score[n], f64 LE
+ * Every array starts on an 8-byte boundary, so a reader can wrap it in a Float64Array
+ * without copying. Errors are still reported as a single JSON line (first byte '{').
  */
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <limits.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "tunneling.h"
+
+#define MAX_THREADS 64
+#define CHUNK_SAMPLES 1024
+#define OUT_BUF_SIZE (1 << 20)
+/* %.6f of the largest double is 317 chars; a sample is three of those plus keys. */
+#define MAX_FIXED6_TEXT 320
+#define MAX_SAMPLE_TEXT (3 * MAX_FIXED6_TEXT + 64)
+#define FRAME_MAGIC "TGF1"
+#define FRAME_VERSION 1
+#define FRAME_HEADER_BYTES 40
+#define FRAME_FLAG_ID 1u
+#define FRAME_FLAG_UNKNOWN_KEYS 2u
 
 static int read_all_stdin(char **out, size_t *len) {
     size_t cap = 4096;
@@ -31,48 +97,1092 @@ static int read_all_stdin(char **out, size_t *len) {
     return 0;
 }
 
-static double parse_json_number(const char *key, const char *json) {
-    char pat[128];
-    snprintf(pat, sizeof(pat), "\"%s\":", key);
-    const char *p = strstr(json, pat);
-    if (!p) return NAN;
-    p += strlen(pat);
-    while (*p == ' ' || *p == '\t') p++;
-    return strtod(p, NULL);
+/* ---- Output ---------------------------------------------------------------------- */
+
+typedef struct {
+    FILE *f;
+    size_t len;
+    char buf[OUT_BUF_SIZE];
+} tg_writer;
+
+static void tw_flush(tg_writer *w) {
+    if (w->len) fwrite(w->buf, 1, w->len, w->f);
+    w->len = 0;
+}
+
+/* Make room for `need` more bytes; `need` must not exceed OUT_BUF_SIZE. */
+static inline char *tw_reserve(tg_writer *w, size_t need) {
+    if (w->len + need > OUT_BUF_SIZE) tw_flush(w);
+    return w->buf + w->len;
+}
+
+static void tw_write(tg_writer *w, const char *s, size_t n) {
+    if (n > OUT_BUF_SIZE) {
+        tw_flush(w);
+        fwrite(s, 1, n, w->f);
+        return;
+    }
+    memcpy(tw_reserve(w, n), s, n);
+    w->len += n;
+}
+
+static void tw_puts(tg_writer *w, const char *s) {
+    tw_write(w, s, strlen(s));
+}
+
+static void tw_putc(tg_writer *w, char c) {
+    *tw_reserve(w, 1) = c;
+    w->len++;
+}
+
+static const char DIGIT_PAIRS[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/*
+ * Format `v` like printf("%.6f") into `d` and return the end. Values below 1e15 in magnitude
+ * take an integer fast path: the integer part is split off exactly, so only the fraction is
+ * scaled and output matches printf except at exact rounding ties. Anything larger (or
+ * non-finite) falls back to snprintf.
+ */
+static char *fmt_fixed6(char *d, double v) {
+    if (!(fabs(v) < 1e15)) return d + snprintf(d, MAX_FIXED6_TEXT, "%.6f", v);
+    if (signbit(v)) {
+        *d++ = '-';
+        v = -v;
+    }
+    double whole = floor(v);
+    uint64_t ip = (uint64_t)whole;
+    uint32_t fp = (uint32_t)((v - whole) * 1e6 + 0.5);
+    if (fp == 1000000) {
+        ip++;
+        fp = 0;
+    }
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + ip % 10);
+        ip /= 10;
+    } while (ip);
+    while (n) *d++ = tmp[--n];
+    *d++ = '.';
+    memcpy(d, DIGIT_PAIRS + 2 * (fp / 10000), 2);
+    memcpy(d + 2, DIGIT_PAIRS + 2 * (fp / 100 % 100), 2);
+    memcpy(d + 4, DIGIT_PAIRS + 2 * (fp % 100), 2);
+    return d + 6;
 }
 
-int main(void) {
+/* ---- Request parsing ------------------------------------------------------------- */
+
+/*
+ * Requests are read in one linear pass: a small recursive-descent tokenizer walks the line once
+ * and fills fixed grid_fields records, so the cost is O(input) however many keys or grids a
+ * request carries. Keys are matched exactly at the level they appear (a "step_m" inside a
+ * string or a nested object can no longer be mistaken for a parameter). Unknown keys are
+ * skipped and reported back; a known key with a value of the wrong type fails the request
+ * with "error":"malformed" and the offending "key".
+ */
+enum {
+    KEY_BASE_ALT,
+    KEY_STEP,
+    KEY_NUM_SAMPLES,
+    KEY_SCALE_HEIGHT,
+    KEY_SURFACE_PRESSURE,
+    /* Keys from here on are only read at the top level. */
+    KEY_THREADS,
+    KEY_LAT_MIN,
+    KEY_LAT_MAX,
+    KEY_LAT_STEP,
+    KEY_LON_MIN,
+    KEY_LON_MAX,
+    KEY_LON_STEP,
+    NUM_NUMBER_KEYS
+};
+
+static const char *const NUMBER_KEYS[NUM_NUMBER_KEYS] = {
+    "baseAlt_m", "step_m", "numSamples", "scaleHeight_m", "surfacePressure_Pa", "threads",
+    "latMin_deg", "latMax_deg", "latStep_deg", "lonMin_deg", "lonMax_deg", "lonStep_deg"
+};
+
+#define VOLUME_KEYS (0x3fu << KEY_LAT_MIN)
+
+#define MAX_UNKNOWN_KEYS 16
+#define MAX_JSON_DEPTH 64
+
+/* Every recognised key of one request object (the top level or one entry of "grids"). */
+typedef struct {
+    unsigned present;            /* bit KEY_* set for each number key seen */
+    double num[NUM_NUMBER_KEYS];
+    int accuracy;                /* -1 unset, else TG_ACCURACY_* */
+    int engine;                  /* -1 unset, else TG_ENGINE_* */
+    int format;                  /* -1 unset, 0 json, 1 f64le (top level only) */
+    const char *id;              /* raw "id" token (number or quoted string), or NULL */
+    size_t idLen;
+    double *alts;                /* owned "altitudes" list, or NULL */
+    long long nAlts;
+    double *scaleHeights;        /* owned "scaleHeights_m" per-column list (top level only) */
+    long long nScaleHeights;
+    const char *outPath;         /* raw "outPath" contents (top level only), or NULL */
+    size_t outPathLen;
+} grid_fields;
+
+typedef struct {
+    grid_fields top;
+    grid_fields *grids;          /* owned; NULL unless the request had "grids" */
+    int nGrids;
+    int hasGrids;
+    int nUnknown;
+    const char *unknown[MAX_UNKNOWN_KEYS];  /* raw key text, escapes intact */
+    size_t unknownLen[MAX_UNKNOWN_KEYS];
+    const char *error;           /* NULL, "parse", "malformed" or "memory" */
+    const char *errorKey;
+    size_t errorKeyLen;
+} request;
+
+typedef struct {
+    const char *p;
+    const char *end;
+    request *req;
+} json_parser;
+
+static const double POW10[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static void init_fields(grid_fields *f) {
+    memset(f, 0, sizeof(*f));
+    f->accuracy = f->engine = f->format = -1;
+}
+
+static inline void skip_ws(json_parser *jp) {
+    while (jp->p < jp->end && (*jp->p == ' ' || *jp->p == '\t' || *jp->p == '\r' || *jp->p == '\n')) jp->p++;
+}
+
+/* Scan a string starting at its opening quote; *s / *len get the raw contents. */
+static int scan_string(json_parser *jp, const char **s, size_t *len) {
+    const char *p = jp->p + 1;
+    while (p < jp->end && *p != '"') p += (*p == '\\') ? 2 : 1;
+    if (p >= jp->end) return -1;
+    *s = jp->p + 1;
+    *len = (size_t)(p - *s);
+    jp->p = p + 1;
+    return 0;
+}
+
+/*
+ * Parse a JSON number. A decimal mantissa that fits in 53 bits with an exponent within +-22 is
+ * converted exactly with one multiply or divide (the Clinger fast path); anything else goes
+ * through strtod, which the NUL-terminated request buffer keeps safe.
+ */
+static int scan_number(json_parser *jp, double *out) {
+    const char *p = jp->p;
+    int neg = 0;
+    if (p < jp->end && *p == '-') {
+        neg = 1;
+        p++;
+    }
+    if (p >= jp->end || *p < '0' || *p > '9') return -1;
+    uint64_t mant = 0;
+    int exp10 = 0, exact = 1;
+    for (; p < jp->end && *p >= '0' && *p <= '9'; p++) {
+        if (mant < 1000000000000000000ull) mant = mant * 10 + (uint64_t)(*p - '0');
+        else {
+            exp10++;
+            if (*p != '0') exact = 0;
+        }
+    }
+    if (p < jp->end && *p == '.') {
+        p++;
+        if (p >= jp->end || *p < '0' || *p > '9') return -1;
+        for (; p < jp->end && *p >= '0' && *p <= '9'; p++) {
+            if (mant < 1000000000000000000ull) {
+                mant = mant * 10 + (uint64_t)(*p - '0');
+                exp10--;
+            } else if (*p != '0') {
+                exact = 0;
+            }
+        }
+    }
+    if (p < jp->end && (*p == 'e' || *p == 'E')) {
+        p++;
+        int eneg = 0, e = 0;
+        if (p < jp->end && (*p == '+' || *p == '-')) eneg = *p++ == '-';
+        if (p >= jp->end || *p < '0' || *p > '9') return -1;
+        for (; p < jp->end && *p >= '0' && *p <= '9'; p++) {
+            if (e < 100000) e = e * 10 + (*p - '0');
+        }
+        exp10 += eneg ? -e : e;
+    }
+    double v;
+    if (exact && mant <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+        v = exp10 >= 0 ? (double)mant * POW10[exp10] : (double)mant / POW10[-exp10];
+        if (neg) v = -v;
+    } else {
+        v = strtod(jp->p, NULL);
+    }
+    jp->p = p;
+    *out = v;
+    return 0;
+}
+
+static int match_literal(json_parser *jp, const char *lit) {
+    size_t n = strlen(lit);
+    if ((size_t)(jp->end - jp->p) < n || memcmp(jp->p, lit, n) != 0) return -1;
+    jp->p += n;
+    return 0;
+}
+
+/* Skip any value (used for unknown keys). */
+static int skip_value(json_parser *jp, int depth) {
+    const char *s;
+    size_t len;
+    double v;
+    skip_ws(jp);
+    if (jp->p >= jp->end || depth > MAX_JSON_DEPTH) return -1;
+    char c = *jp->p;
+    if (c == '"') return scan_string(jp, &s, &len);
+    if (c == 't') return match_literal(jp, "true");
+    if (c == 'f') return match_literal(jp, "false");
+    if (c == 'n') return match_literal(jp, "null");
+    if (c != '{' && c != '[') return scan_number(jp, &v);
+    char close = c == '{' ? '}' : ']';
+    jp->p++;
+    skip_ws(jp);
+    if (jp->p < jp->end && *jp->p == close) {
+        jp->p++;
+        return 0;
+    }
+    for (;;) {
+        if (c == '{') {
+            skip_ws(jp);
+            if (jp->p >= jp->end || *jp->p != '"' || scan_string(jp, &s, &len)) return -1;
+            skip_ws(jp);
+            if (jp->p >= jp->end || *jp->p++ != ':') return -1;
+        }
+        if (skip_value(jp, depth + 1)) return -1;
+        skip_ws(jp);
+        if (jp->p >= jp->end) return -1;
+        if (*jp->p == ',') {
+            jp->p++;
+            continue;
+        }
+        if (*jp->p++ != close) return -1;
+        return 0;
+    }
+}
+
+static int malformed(json_parser *jp, const char *key, size_t keyLen) {
+    jp->req->error = "malformed";
+    jp->req->errorKey = key;
+    jp->req->errorKeyLen = keyLen;
+    return -1;
+}
+
+/* Match a quoted string value against `options`; returns its index or -1. */
+static int scan_choice(json_parser *jp, const char *const *options, int count) {
+    const char *s;
+    size_t len;
+    if (jp->p >= jp->end || *jp->p != '"' || scan_string(jp, &s, &len)) return -1;
+    for (int i = 0; i < count; i++) {
+        if (strlen(options[i]) == len && memcmp(options[i], s, len) == 0) return i;
+    }
+    return -1;
+}
+
+/* Scan an array of numbers into a new *out (never NULL on success); -2 on allocation failure. */
+static int scan_number_list(json_parser *jp, double **out, long long *n) {
+    size_t cap = 0;
+    if (jp->p >= jp->end || *jp->p != '[') return -1;
+    jp->p++;
+    skip_ws(jp);
+    free(*out);
+    *out = NULL;
+    *n = 0;
+    if (jp->p < jp->end && *jp->p == ']') {
+        jp->p++;
+        *out = malloc(sizeof(double));
+        return *out ? 0 : -2;
+    }
+    for (;;) {
+        double v;
+        skip_ws(jp);
+        if (scan_number(jp, &v)) return -1;
+        if ((size_t)*n == cap) {
+            cap = cap ? cap * 2 : 256;
+            double *nv = realloc(*out, cap * sizeof(double));
+            if (!nv) return -2;
+            *out = nv;
+        }
+        (*out)[(*n)++] = v;
+        skip_ws(jp);
+        if (jp->p >= jp->end) return -1;
+        if (*jp->p == ',') {
+            jp->p++;
+            continue;
+        }
+        if (*jp->p++ != ']') return -1;
+        return 0;
+    }
+}
+
+static int parse_object(json_parser *jp, grid_fields *f, int top);
+
+static int scan_grids(json_parser *jp) {
+    request *req = jp->req;
+    int cap = 0;
+    if (jp->p >= jp->end || *jp->p != '[') return -1;
+    jp->p++;
+    req->hasGrids = 1;
+    skip_ws(jp);
+    if (jp->p < jp->end && *jp->p == ']') {
+        jp->p++;
+        return 0;
+    }
+    for (;;) {
+        skip_ws(jp);
+        if (req->nGrids == cap) {
+            cap = cap ? cap * 2 : 16;
+            grid_fields *ng = realloc(req->grids, sizeof(grid_fields) * (size_t)cap);
+            if (!ng) {
+                req->error = "memory";
+                return -1;
+            }
+            req->grids = ng;
+        }
+        grid_fields *g = &req->grids[req->nGrids++];
+        init_fields(g);
+        if (parse_object(jp, g, 0)) return -1;
+        skip_ws(jp);
+        if (jp->p >= jp->end) return -1;
+        if (*jp->p == ',') {
+            jp->p++;
+            continue;
+        }
+        if (*jp->p++ != ']') return -1;
+        return 0;
+    }
+}
+
+static const char *const ACCURACY_NAMES[] = { "exact", "fast" };
+static const char *const ENGINE_NAMES[] = { "auto", "direct", "recurrence" };
+static const char *const FORMAT_NAMES[] = { "json", "f64le" };
+
+static int parse_value_for_key(json_parser *jp, grid_fields *f, int top, const char *key, size_t keyLen) {
+    request *req = jp->req;
+    for (int k = 0; k < NUM_NUMBER_KEYS; k++) {
+        if (k >= KEY_THREADS && !top) continue;
+        if (strlen(NUMBER_KEYS[k]) != keyLen || memcmp(NUMBER_KEYS[k], key, keyLen) != 0) continue;
+        if (scan_number(jp, &f->num[k])) return malformed(jp, key, keyLen);
+        f->present |= 1u << k;
+        return 0;
+    }
+#define KEY_IS(lit) (keyLen == sizeof(lit) - 1 && memcmp(key, lit, keyLen) == 0)
+    if (KEY_IS("id")) {
+        const char *start = jp->p;
+        double v;
+        const char *s;
+        size_t len;
+        int rc = (jp->p < jp->end && *jp->p == '"') ? scan_string(jp, &s, &len) : scan_number(jp, &v);
+        if (rc || jp->p - start > 256) return malformed(jp, key, keyLen);
+        f->id = start;
+        f->idLen = (size_t)(jp->p - start);
+        return 0;
+    }
+    if (KEY_IS("accuracy")) {
+        if ((f->accuracy = scan_choice(jp, ACCURACY_NAMES, 2)) < 0) return malformed(jp, key, keyLen);
+        return 0;
+    }
+    if (KEY_IS("engine")) {
+        if ((f->engine = scan_choice(jp, ENGINE_NAMES, 3)) < 0) return malformed(jp, key, keyLen);
+        return 0;
+    }
+    if (KEY_IS("altitudes") || (top && KEY_IS("scaleHeights_m"))) {
+        int rc = key[0] == 'a' ? scan_number_list(jp, &f->alts, &f->nAlts)
+                               : scan_number_list(jp, &f->scaleHeights, &f->nScaleHeights);
+        if (rc == -2) req->error = "memory";
+        if (rc) return rc == -2 ? -1 : malformed(jp, key, keyLen);
+        return 0;
+    }
+    if (top && KEY_IS("outPath")) {
+        /* Paths are taken verbatim, so escapes are not accepted. */
+        if (jp->p >= jp->end || *jp->p != '"' || scan_string(jp, &f->outPath, &f->outPathLen) ||
+            f->outPathLen == 0 || memchr(f->outPath, '\\', f->outPathLen)) {
+            return malformed(jp, key, keyLen);
+        }
+        return 0;
+    }
+    if (top && KEY_IS("format")) {
+        if ((f->format = scan_choice(jp, FORMAT_NAMES, 2)) < 0) return malformed(jp, key, keyLen);
+        return 0;
+    }
+    if (top && KEY_IS("grids")) {
+        if (req->hasGrids) return malformed(jp, key, keyLen);
+        if (scan_grids(jp)) return req->error ? -1 : malformed(jp, key, keyLen);
+        return 0;
+    }
+#undef KEY_IS
+    if (req->nUnknown < MAX_UNKNOWN_KEYS) {
+        req->unknown[req->nUnknown] = key;
+        req->unknownLen[req->nUnknown++] = keyLen;
+    }
+    return skip_value(jp, 1);
+}
+
+static int parse_object(json_parser *jp, grid_fields *f, int top) {
+    skip_ws(jp);
+    if (jp->p >= jp->end || *jp->p != '{') return -1;
+    jp->p++;
+    skip_ws(jp);
+    if (jp->p < jp->end && *jp->p == '}') {
+        jp->p++;
+        return 0;
+    }
+    for (;;) {
+        const char *key;
+        size_t keyLen;
+        skip_ws(jp);
+        if (jp->p >= jp->end || *jp->p != '"' || scan_string(jp, &key, &keyLen)) return -1;
+        skip_ws(jp);
+        if (jp->p >= jp->end || *jp->p++ != ':') return -1;
+        skip_ws(jp);
+        if (parse_value_for_key(jp, f, top, key, keyLen)) return -1;
+        skip_ws(jp);
+        if (jp->p >= jp->end) return -1;
+        if (*jp->p == ',') {
+            jp->p++;
+            continue;
+        }
+        if (*jp->p++ != '}') return -1;
+        return 0;
+    }
+}
+
+/* Parse `len` bytes of `buf` (which must be NUL-terminated at buf[len]) into `req`. */
+static void parse_request(const char *buf, size_t len, request *req) {
+    memset(req, 0, sizeof(*req));
+    init_fields(&req->top);
+    json_parser jp = { .p = buf, .end = buf + len, .req = req };
+    if (parse_object(&jp, &req->top, 1) == 0) {
+        skip_ws(&jp);
+        if (jp.p == jp.end) return;
+    }
+    if (!req->error) req->error = "parse";
+}
+
+static void free_request(request *req) {
+    free(req->top.alts);
+    free(req->top.scaleHeights);
+    for (int k = 0; k < req->nGrids; k++) free(req->grids[k].alts);
+    free(req->grids);
+}
+
+/* ---- Sampling -------------------------------------------------------------------- */
+
+static const tg_grid GRID_DEFAULTS = {
+    .params = { .baseAlt_m = 0, .step_m = 1, .scaleHeight_m = 8500, .surfacePressure_Pa = 101325,
+                .accuracy = TG_ACCURACY_EXACT, .engine = TG_ENGINE_AUTO },
+    .n = 8
+};
+
+/* Overlay the keys of one request object on `defaults`; `g` borrows f->alts. */
+static void apply_grid_fields(const grid_fields *f, const tg_grid *defaults, tg_grid *g) {
+    tg_params *p = &g->params;
+    *g = *defaults;
+    if (f->present & (1u << KEY_BASE_ALT)) p->baseAlt_m = f->num[KEY_BASE_ALT];
+    if (f->present & (1u << KEY_STEP)) p->step_m = f->num[KEY_STEP];
+    if (f->present & (1u << KEY_SCALE_HEIGHT)) p->scaleHeight_m = f->num[KEY_SCALE_HEIGHT];
+    if (f->present & (1u << KEY_SURFACE_PRESSURE)) p->surfacePressure_Pa = f->num[KEY_SURFACE_PRESSURE];
+    if (f->accuracy >= 0) p->accuracy = f->accuracy;
+    if (f->engine >= 0) p->engine = f->engine;
+    if (f->alts) {
+        p->altitudes = f->alts;
+        g->n = (uint64_t)f->nAlts;
+    } else if ((f->present & (1u << KEY_NUM_SAMPLES)) && !p->altitudes) {
+        /* An inherited altitude list fixes n; the grid can still override it with its own list. */
+        double nraw = f->num[KEY_NUM_SAMPLES];
+        g->n = nraw < 1 ? 1 : nraw > 9e18 ? (uint64_t)9e18 : (uint64_t)llround(nraw);
+    }
+}
+
+static void write_samples(tg_writer *w, uint64_t start, size_t count,
+                          const double *alt, const double *p, const double *score) {
+    for (size_t i = 0; i < count; i++) {
+        char *d = tw_reserve(w, MAX_SAMPLE_TEXT), *s = d;
+        if (start + i) *d++ = ',';
+        memcpy(d, "{\"alt_m\":", 9);
+        d = fmt_fixed6(d + 9, alt[i]);
+        memcpy(d, ",\"pressure_Pa\":", 15);
+        d = fmt_fixed6(d + 15, p[i]);
+        memcpy(d, ",\"score\":", 9);
+        d = fmt_fixed6(d + 9, score[i]);
+        *d++ = '}';
+        w->len += (size_t)(d - s);
+    }
+}
+
+/* Evaluate and write grid `g` chunk by chunk, so memory use does not depend on g->n. */
+static void stream_grid_samples(tg_writer *w, const tg_grid *g) {
+    double alt[CHUNK_SAMPLES], p[CHUNK_SAMPLES], score[CHUNK_SAMPLES];
+    tw_puts(w, "\"samples\":[");
+    for (uint64_t start = 0; start < g->n; start += CHUNK_SAMPLES) {
+        size_t count = (size_t)(g->n - start < CHUNK_SAMPLES ? g->n - start : CHUNK_SAMPLES);
+        tg_grid_eval(g, start, count, alt, p, score);
+        write_samples(w, start, count, alt, p, score);
+    }
+    tw_putc(w, ']');
+}
+
+/* ---- Binary frames --------------------------------------------------------------- */
+
+typedef struct {
+    uint32_t index;
+    uint32_t count;
+    uint32_t flags;      /* FRAME_FLAG_* */
+    int64_t id;
+} frame_info;
+
+static void put_le(char *d, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) d[i] = (char)(v >> (8 * i));
+}
+
+static void write_frame_header(tg_writer *w, const frame_info *fi, uint64_t n) {
+    char *d = tw_reserve(w, FRAME_HEADER_BYTES);
+    memcpy(d, FRAME_MAGIC, 4);
+    put_le(d + 4, FRAME_VERSION, 2);
+    put_le(d + 6, FRAME_HEADER_BYTES, 2);
+    put_le(d + 8, fi->flags, 4);
+    put_le(d + 12, fi->index, 4);
+    put_le(d + 16, fi->count, 4);
+    put_le(d + 20, 0, 4);
+    put_le(d + 24, n, 8);
+    put_le(d + 32, (uint64_t)((fi->flags & FRAME_FLAG_ID) ? fi->id : 0), 8);
+    w->len += FRAME_HEADER_BYTES;
+}
+
+static void write_f64le(tg_writer *w, const double *v, size_t n) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < n; i++) {
+        uint64_t u;
+        memcpy(&u, &v[i], sizeof(u));
+        put_le(tw_reserve(w, 8), u, 8);
+        w->len += 8;
+    }
+#else
+    tw_write(w, (const char *)v, n * sizeof(double));
+#endif
+}
+
+/* Room to hold pressure and score for a frame of n samples; NULL if they do not fit. */
+static double *alloc_frame_held(uint64_t n) {
+    if (n > SIZE_MAX / (2 * sizeof(double))) return NULL;
+    return malloc(sizeof(double) * 2 * (size_t)(n ? n : 1));
+}
+
+/*
+ * Stream grid `g` as one frame, evaluating each chunk once. The arrays are struct-of-arrays,
+ * so alt_m goes out as it is computed while pressure and score wait in `held` (from
+ * alloc_frame_held(g->n) or larger) until it is done.
+ */
+static void stream_grid_frame(tg_writer *w, const tg_grid *g, const frame_info *fi, double *held) {
+    size_t n = (size_t)g->n;
+    double alt[CHUNK_SAMPLES], *p = held, *score = held + n;
+    write_frame_header(w, fi, (uint64_t)n);
+    for (size_t start = 0; start < n; start += CHUNK_SAMPLES) {
+        size_t count = n - start < CHUNK_SAMPLES ? n - start : CHUNK_SAMPLES;
+        tg_grid_eval(g, start, count, alt, p + start, score + start);
+        write_f64le(w, alt, count);
+    }
+    write_f64le(w, held, 2 * n);
+}
+
+/* ---- Batch ----------------------------------------------------------------------- */
+
+typedef struct {
+    const grid_fields *fields;
+    tg_grid params;
+    double *samples;     /* alt[n], pressure[n], score[n] (threaded mode only) */
+} grid_job;
+
+typedef struct {
+    grid_job *jobs;
+    int count;
+    atomic_int next;
+} grid_pool;
+
+static void *grid_worker(void *arg) {
+    grid_pool *pool = arg;
+    for (;;) {
+        int k = atomic_fetch_add(&pool->next, 1);
+        if (k >= pool->count) break;
+        grid_job *job = &pool->jobs[k];
+        size_t n = (size_t)job->params.n;
+        tg_grid_eval(&job->params, 0, n, job->samples, job->samples + n, job->samples + 2 * n);
+    }
+    return NULL;
+}
+
+/* Evaluate every job, spreading whole grids across up to `threads` workers. */
+static int run_grid_pool(grid_job *jobs, int count, int threads) {
+    grid_pool pool = { .jobs = jobs, .count = count };
+    atomic_init(&pool.next, 0);
+    for (int k = 0; k < count; k++) {
+        size_t n = (size_t)jobs[k].params.n;
+        if (n > SIZE_MAX / (3 * sizeof(double))) return -1;
+        jobs[k].samples = malloc(sizeof(double) * 3 * (n ? n : 1));
+        if (!jobs[k].samples) return -1;
+    }
+    if (threads > count) threads = count;
+    pthread_t tids[MAX_THREADS];
+    int started = 0;
+    for (; started < threads - 1; started++) {
+        if (pthread_create(&tids[started], NULL, grid_worker, &pool)) break;
+    }
+    grid_worker(&pool);
+    for (int t = 0; t < started; t++) pthread_join(tids[t], NULL);
+    return 0;
+}
+
+static int resolve_threads(const grid_fields *top) {
+    if (!(top->present & (1u << KEY_THREADS))) return 1;
+    /* Clamp both ends before rounding: lround is unspecified outside long's range. Anything
+     * that would round below 1, -inf and NaN included, asks for one thread per CPU. */
+    double traw = top->num[KEY_THREADS];
+    long t = !(traw >= 0.5) ? 0 : traw > MAX_THREADS ? MAX_THREADS : lround(traw);
+    if (t <= 0) t = sysconf(_SC_NPROCESSORS_ONLN);
+    if (t < 1) t = 1;
+    if (t > MAX_THREADS) t = MAX_THREADS;
+    return (int)t;
+}
+
+/* Per-request response state shared by the single-grid and batch paths. */
+typedef struct {
+    tg_writer *w;
+    const request *req;
+    int binary;
+    frame_info frame;
+} response;
+
+/*
+ * Open a JSON response object, echoing the request id if there is one and listing any keys
+ * that were skipped as "unknownKeys" (at most MAX_UNKNOWN_KEYS of them).
+ */
+static void begin_json(const response *r) {
+    const request *req = r->req;
+    tw_putc(r->w, '{');
+    if (req->top.id) {
+        tw_puts(r->w, "\"id\":");
+        tw_write(r->w, req->top.id, req->top.idLen);
+        tw_putc(r->w, ',');
+    }
+    if (req->nUnknown) {
+        tw_puts(r->w, "\"unknownKeys\":[");
+        for (int k = 0; k < req->nUnknown; k++) {
+            if (k) tw_putc(r->w, ',');
+            tw_putc(r->w, '"');
+            tw_write(r->w, req->unknown[k], req->unknownLen[k]);
+            tw_putc(r->w, '"');
+        }
+        tw_puts(r->w, "],");
+    }
+}
+
+static void write_error_key(const response *r, const char *error, const char *key, size_t keyLen) {
+    begin_json(r);
+    tw_puts(r->w, "\"ok\":false,\"error\":\"");
+    tw_puts(r->w, error);
+    tw_putc(r->w, '"');
+    if (key) {
+        tw_puts(r->w, ",\"key\":\"");
+        tw_write(r->w, key, keyLen);
+        tw_putc(r->w, '"');
+    }
+    tw_puts(r->w, "}\n");
+}
+
+static void write_error(const response *r, const char *error) {
+    write_error_key(r, error, r->req->errorKey, r->req->errorKeyLen);
+}
+
+/* A value that parsed but does not make sense together with the rest of the request. */
+static void write_malformed(const response *r, const char *key) {
+    write_error_key(r, "malformed", key, strlen(key));
+}
+
+/*
+ * Batch request: {"grids":[{...},{...}], "threads":4, ...}. Keys outside the array act as
+ * defaults for every grid; each grid may carry its own "id", echoed in its result.
+ */
+static void handle_batch(response *r) {
+    tg_writer *w = r->w;
+    const request *req = r->req;
+    int count = req->nGrids;
+    tg_grid defaults;
+    apply_grid_fields(&req->top, &GRID_DEFAULTS, &defaults);
+    grid_job *jobs = calloc(count ? (size_t)count : 1, sizeof(grid_job));
+    if (!jobs) {
+        write_error(r, "memory");
+        return;
+    }
+    for (int k = 0; k < count; k++) {
+        jobs[k].fields = &req->grids[k];
+        apply_grid_fields(&req->grids[k], &defaults, &jobs[k].params);
+        tg_grid_prepare(&jobs[k].params);
+    }
+    int threads = resolve_threads(&req->top);
+    if (threads > 1 && run_grid_pool(jobs, count, threads)) {
+        write_error(r, "memory");
+    } else if (r->binary) {
+        /* Unthreaded, every frame streams through one buffer sized for the largest grid. It
+         * is taken before the first frame, so running out of memory is still answered with a
+         * lone JSON error line rather than one after frames already sent. */
+        uint64_t largest = 0;
+        for (int k = 0; k < count && threads <= 1; k++) {
+            if (jobs[k].params.n > largest) largest = jobs[k].params.n;
+        }
+        double *held = threads <= 1 ? alloc_frame_held(largest) : NULL;
+        if (threads <= 1 && !held) {
+            write_error(r, "memory");
+        } else {
+            r->frame.count = (uint32_t)count;
+            for (int k = 0; k < count; k++) {
+                const grid_job *job = &jobs[k];
+                r->frame.index = (uint32_t)k;
+                if (job->samples) {
+                    write_frame_header(w, &r->frame, (uint64_t)job->params.n);
+                    write_f64le(w, job->samples, 3 * (size_t)job->params.n);
+                } else {
+                    stream_grid_frame(w, &job->params, &r->frame, held);
+                }
+            }
+        }
+        free(held);
+    } else {
+        begin_json(r);
+        tw_puts(w, "\"ok\":true,\"grids\":[");
+        for (int k = 0; k < count; k++) {
+            const grid_job *job = &jobs[k];
+            if (k) tw_putc(w, ',');
+            tw_putc(w, '{');
+            if (job->fields->id) {
+                tw_puts(w, "\"id\":");
+                tw_write(w, job->fields->id, job->fields->idLen);
+                tw_putc(w, ',');
+            }
+            if (job->samples) {
+                size_t n = (size_t)job->params.n;
+                tw_puts(w, "\"samples\":[");
+                write_samples(w, 0, n, job->samples, job->samples + n, job->samples + 2 * n);
+                tw_putc(w, ']');
+            } else {
+                stream_grid_samples(w, &job->params);
+            }
+            tw_putc(w, '}');
+        }
+        tw_puts(w, "]}\n");
+    }
+    for (int k = 0; k < count; k++) free(jobs[k].samples);
+    free(jobs);
+}
+
+/* ---- Volumes --------------------------------------------------------------------- */
+
+/*
+ * Volume request: any latMin_deg / latMax_deg / latStep_deg / lonMin_deg / lonMax_deg /
+ * lonStep_deg key (or "scaleHeights_m") turns the request into a lat x lon grid of altitude
+ * columns. Each horizontal axis runs from its min to its max inclusive in steps of its step
+ * (an axis left out is a single row at 0 deg); the altitude axis is the usual
+ * baseAlt_m/step_m/numSamples or "altitudes" list. "scaleHeights_m" overrides scaleHeight_m
+ * per column: numLat * numLon entries, lon varying fastest.
+ *
+ * The result is one contiguous little-endian volume:
+ *   offset  size  field
+ *        0     4  magic "TGV1"
+ *        4     2  version (1), u16 LE
+ *        6     2  header size in bytes (96), u16 LE
+ *        8     4  flags, u32 LE (as for frames)
+ *       12     4  reserved (0)
+ *       16    24  numLat, numLon, numAlt, u64 LE
+ *       40    32  latMin_deg, latStep_deg, lonMin_deg, lonStep_deg, f64 LE
+ *       72     8  request id, i64 LE (integral "id" values only; 0 otherwise)
+ *       80    16  reserved (0)
+ *       96  8*nA  alt_m[numAlt]
+ *             8*N  pressure_Pa[numLat][numLon][numAlt], N = numLat * numLon * numAlt
+ *             8*N  score[numLat][numLon][numAlt]
+ * With "outPath" the file is sized up front, mapped, and filled in place, and the response is
+ * a JSON summary line; the file can be mapped straight back by a reader. Without it the
+ * volume is built in memory and written to stdout, which needs "format":"f64le" (or --binary).
+ *
+ * Columns are handed out in tiles of about VOLUME_TILE_SAMPLES samples through an atomic
+ * counter, so "threads" workers fill disjoint stretches of the output with no locking and
+ * uneven columns (per-column recurrence or not) balance themselves.
+ */
+#define VOLUME_MAGIC "TGV1"
+#define VOLUME_VERSION 1
+#define VOLUME_HEADER_BYTES 96
+#define VOLUME_TILE_SAMPLES 32768
+#define VOLUME_MAX_AXIS 1000000000ull
+
+typedef struct {
+    tg_grid column;              /* the altitude axis, shared by every column */
+    uint64_t nLat, nLon;
+    const double *scaleHeights;  /* per-column H, or NULL */
+    double *pressure;            /* nLat * nLon * column.n, then score the same size */
+    double *score;
+    uint64_t columnsPerTile;
+    uint64_t nTiles;
+    atomic_uint_fast64_t next;
+} volume_job;
+
+/* Number of points on [min, max] in `step`s; 0 when the axis is malformed. */
+static uint64_t axis_count(double min, double max, double step) {
+    if (!(step > 0) || !(max >= min) || !isfinite(max - min)) return 0;
+    double n = floor((max - min) / step + 1e-9) + 1;
+    return n > (double)VOLUME_MAX_AXIS ? 0 : (uint64_t)n;
+}
+
+static void f64_to_le(double *v, uint64_t n) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (uint64_t i = 0; i < n; i++) {
+        uint64_t u;
+        memcpy(&u, &v[i], sizeof(u));
+        put_le((char *)&v[i], u, 8);
+    }
+#else
+    (void)v;
+    (void)n;
+#endif
+}
+
+static void *volume_worker(void *arg) {
+    volume_job *v = arg;
+    uint64_t nAlt = v->column.n, nCols = v->nLat * v->nLon;
+    double alt[CHUNK_SAMPLES];
+    for (;;) {
+        uint64_t t = atomic_fetch_add(&v->next, 1);
+        if (t >= v->nTiles) break;
+        uint64_t c0 = t * v->columnsPerTile;
+        uint64_t c1 = c0 + v->columnsPerTile < nCols ? c0 + v->columnsPerTile : nCols;
+        for (uint64_t c = c0; c < c1; c++) {
+            tg_grid g = v->column;
+            if (v->scaleHeights) {
+                g.params.scaleHeight_m = v->scaleHeights[c];
+                tg_grid_prepare(&g);
+            }
+            double *p = v->pressure + c * nAlt, *s = v->score + c * nAlt;
+            for (uint64_t start = 0; start < nAlt; start += CHUNK_SAMPLES) {
+                size_t count = (size_t)(nAlt - start < CHUNK_SAMPLES ? nAlt - start : CHUNK_SAMPLES);
+                tg_grid_eval(&g, start, count, alt, p + start, s + start);
+            }
+        }
+        f64_to_le(v->pressure + c0 * nAlt, (c1 - c0) * nAlt);
+        f64_to_le(v->score + c0 * nAlt, (c1 - c0) * nAlt);
+    }
+    return NULL;
+}
+
+static void put_f64le(char *d, double v) {
+    uint64_t u;
+    memcpy(&u, &v, sizeof(u));
+    put_le(d, u, 8);
+}
+
+/* Fill the whole volume at `base` (VOLUME_HEADER_BYTES + arrays) using up to `threads` workers. */
+static void fill_volume(volume_job *v, char *base, const frame_info *fi, double lat0, double latStep,
+                        double lon0, double lonStep, int threads) {
+    uint64_t nAlt = v->column.n, nCols = v->nLat * v->nLon;
+    memset(base, 0, VOLUME_HEADER_BYTES);
+    memcpy(base, VOLUME_MAGIC, 4);
+    put_le(base + 4, VOLUME_VERSION, 2);
+    put_le(base + 6, VOLUME_HEADER_BYTES, 2);
+    put_le(base + 8, fi->flags, 4);
+    put_le(base + 16, v->nLat, 8);
+    put_le(base + 24, v->nLon, 8);
+    put_le(base + 32, nAlt, 8);
+    put_f64le(base + 40, lat0);
+    put_f64le(base + 48, latStep);
+    put_f64le(base + 56, lon0);
+    put_f64le(base + 64, lonStep);
+    put_le(base + 72, (uint64_t)((fi->flags & FRAME_FLAG_ID) ? fi->id : 0), 8);
+    double *alt = (double *)(base + VOLUME_HEADER_BYTES);
+    v->pressure = alt + nAlt;
+    v->score = v->pressure + nCols * nAlt;
+    double scratch[CHUNK_SAMPLES];
+    for (uint64_t start = 0; start < nAlt; start += CHUNK_SAMPLES) {
+        size_t count = (size_t)(nAlt - start < CHUNK_SAMPLES ? nAlt - start : CHUNK_SAMPLES);
+        /* alt_m does not depend on H; the other two outputs are discarded. */
+        double p[CHUNK_SAMPLES];
+        tg_grid_eval(&v->column, start, count, alt + start, p, scratch);
+    }
+    f64_to_le(alt, nAlt);
+    v->columnsPerTile = nAlt >= VOLUME_TILE_SAMPLES ? 1 : VOLUME_TILE_SAMPLES / (nAlt ? nAlt : 1);
+    v->nTiles = (nCols + v->columnsPerTile - 1) / v->columnsPerTile;
+    atomic_init(&v->next, 0);
+    if ((uint64_t)threads > v->nTiles) threads = (int)v->nTiles;
+    pthread_t tids[MAX_THREADS];
+    int started = 0;
+    for (; started < threads - 1; started++) {
+        if (pthread_create(&tids[started], NULL, volume_worker, v)) break;
+    }
+    volume_worker(v);
+    for (int t = 0; t < started; t++) pthread_join(tids[t], NULL);
+}
+
+static void handle_volume(response *r) {
+    const request *req = r->req;
+    const grid_fields *top = &req->top;
+    double num[NUM_NUMBER_KEYS];
+    for (int k = KEY_LAT_MIN; k <= KEY_LON_STEP; k++) {
+        num[k] = (top->present & (1u << k)) ? top->num[k] : k == KEY_LAT_STEP || k == KEY_LON_STEP ? 1 : 0;
+    }
+    if (!(top->present & (1u << KEY_LAT_MAX))) num[KEY_LAT_MAX] = num[KEY_LAT_MIN];
+    if (!(top->present & (1u << KEY_LON_MAX))) num[KEY_LON_MAX] = num[KEY_LON_MIN];
+    volume_job v = { .scaleHeights = top->scaleHeights };
+    apply_grid_fields(top, &GRID_DEFAULTS, &v.column);
+    tg_grid_prepare(&v.column);
+    v.nLat = axis_count(num[KEY_LAT_MIN], num[KEY_LAT_MAX], num[KEY_LAT_STEP]);
+    v.nLon = axis_count(num[KEY_LON_MIN], num[KEY_LON_MAX], num[KEY_LON_STEP]);
+    uint64_t nAlt = v.column.n, nCols = v.nLat * v.nLon;
+    const char *badKey = !v.nLat ? "latStep_deg" : !v.nLon ? "lonStep_deg" : NULL;
+    if (!badKey && top->scaleHeights && (uint64_t)top->nScaleHeights != nCols) badKey = "scaleHeights_m";
+    if (badKey) {
+        write_malformed(r, badKey);
+        return;
+    }
+    /* Header, alt_m[nAlt], then pressure and score at nCols * nAlt each. */
+    uint64_t maxSamples = (SIZE_MAX - VOLUME_HEADER_BYTES) / sizeof(double) / 3;
+    if (nAlt > maxSamples || (nAlt && nCols > maxSamples / nAlt)) {
+        write_error(r, "memory");
+        return;
+    }
+    size_t total = VOLUME_HEADER_BYTES + sizeof(double) * (size_t)(nAlt + 2 * nCols * nAlt);
+    int threads = resolve_threads(top);
+    if (top->outPath) {
+        char path[PATH_MAX];
+        if (top->outPathLen >= sizeof(path)) {
+            write_error(r, "io");
+            return;
+        }
+        memcpy(path, top->outPath, top->outPathLen);
+        path[top->outPathLen] = '\0';
+        int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            write_error(r, "io");
+            return;
+        }
+        void *map = MAP_FAILED;
+        if (ftruncate(fd, (off_t)total) == 0) map = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            write_error(r, "io");
+            return;
+        }
+        fill_volume(&v, map, &r->frame, num[KEY_LAT_MIN], num[KEY_LAT_STEP], num[KEY_LON_MIN],
+                    num[KEY_LON_STEP], threads);
+        munmap(map, total);
+        char summary[160];
+        begin_json(r);
+        tw_puts(r->w, "\"ok\":true,\"volume\":{\"path\":\"");
+        tw_write(r->w, top->outPath, top->outPathLen);
+        snprintf(summary, sizeof(summary), "\",\"dims\":[%llu,%llu,%llu],\"bytes\":%llu}}\n",
+                 (unsigned long long)v.nLat, (unsigned long long)v.nLon, (unsigned long long)nAlt,
+                 (unsigned long long)total);
+        tw_puts(r->w, summary);
+    } else if (!r->binary) {
+        write_error(r, "format");
+    } else {
+        char *buf = malloc(total);
+        if (!buf) {
+            write_error(r, "memory");
+            return;
+        }
+        fill_volume(&v, buf, &r->frame, num[KEY_LAT_MIN], num[KEY_LAT_STEP], num[KEY_LON_MIN],
+                    num[KEY_LON_STEP], threads);
+        tw_write(r->w, buf, total);
+        free(buf);
+    }
+}
+
+/* ---- Requests -------------------------------------------------------------------- */
+
+/*
+ * Evaluate one request and write its response (one JSON line or binary frames) through `w`.
+ * `buf` holds `len` bytes of JSON and must be NUL-terminated at buf[len].
+ */
+static void handle_request(const char *buf, size_t len, tg_writer *w, int binaryDefault) {
+    request req;
+    parse_request(buf, len, &req);
+    response r = { .w = w, .req = &req, .frame = { .index = 0, .count = 1 } };
+    /* A request's "format" wins over the --binary default. */
+    r.binary = req.top.format >= 0 ? req.top.format : binaryDefault;
+    if (req.nUnknown) r.frame.flags |= FRAME_FLAG_UNKNOWN_KEYS;
+    if (req.top.id && req.top.id[0] != '"') {
+        double idNum = strtod(req.top.id, NULL);
+        if (idNum == trunc(idNum) && fabs(idNum) < 9.2e18) {
+            r.frame.flags |= FRAME_FLAG_ID;
+            r.frame.id = (int64_t)idNum;
+        }
+    }
+    if (req.error) {
+        write_error(&r, req.error);
+    } else if ((req.top.present & VOLUME_KEYS) || req.top.scaleHeights) {
+        if (req.hasGrids) write_malformed(&r, "grids");
+        else handle_volume(&r);
+    } else if (req.hasGrids) {
+        handle_batch(&r);
+    } else {
+        tg_grid g;
+        apply_grid_fields(&req.top, &GRID_DEFAULTS, &g);
+        tg_grid_prepare(&g);
+        if (r.binary) {
+            double *held = alloc_frame_held(g.n);
+            if (held) stream_grid_frame(w, &g, &r.frame, held);
+            else write_error(&r, "memory");
+            free(held);
+        } else {
+            begin_json(&r);
+            tw_puts(w, "\"ok\":true,");
+            stream_grid_samples(w, &g);
+            tw_puts(w, "}\n");
+        }
+    }
+    free_request(&req);
+}
+
+static tg_writer stdout_writer;
+
+static int serve(int binaryDefault) {
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    while ((n = getline(&line, &cap, stdin)) != -1) {
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = '\0';
+        if (n == 0) continue;
+        handle_request(line, (size_t)n, &stdout_writer, binaryDefault);
+        tw_flush(&stdout_writer);
+        fflush(stdout);
+    }
+    free(line);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int serveMode = 0, binaryDefault = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--serve") == 0) serveMode = 1;
+        else if (strcmp(argv[i], "--binary") == 0) binaryDefault = 1;
+    }
+    stdout_writer.f = stdout;
+    if (serveMode) return serve(binaryDefault);
     char *buf = NULL;
     size_t len = 0;
     if (read_all_stdin(&buf, &len) || !buf) {
         fputs("{\"ok\":false,\"error\":\"stdin\"}\n", stdout);
         return 1;
     }
-    double base = parse_json_number("baseAlt_m", buf);
-    double step = parse_json_number("step_m", buf);
-    double nraw = parse_json_number("numSamples", buf);
-    double H = parse_json_number("scaleHeight_m", buf);
-    double p0 = parse_json_number("surfacePressure_Pa", buf);
-    if (isnan(base)) base = 0;
-    if (isnan(step)) step = 1;
-    if (isnan(H)) H = 8500;
-    if (isnan(p0)) p0 = 101325;
-    int ni = 8;
-    if (!isnan(nraw)) {
-        long nl = lround(nraw);
-        if (nl < 1) nl = 1;
-        if (nl > 256) nl = 256;
-        ni = (int)nl;
-    }
-    printf("{\"ok\":true,\"samples\":[");
-    for (int i = 0; i < ni; i++) {
-        double alt = base + i * step;
-        double p = p0 * exp(-alt / H);
-        double score = 1.0 / (1.0 + exp(-0.0001 * (p - 50000)));
-        if (i) printf(",");
-        printf("{\"alt_m\":%.6f,\"pressure_Pa\":%.6f,\"score\":%.6f}", alt, p, score);
-    }
-    printf("]}\n");
+    handle_request(buf, len, &stdout_writer, binaryDefault);
+    tw_flush(&stdout_writer);
     free(buf);
     return 0;
 }
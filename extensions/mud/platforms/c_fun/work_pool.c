@@ -0,0 +1,220 @@
+/**
+ * work_pool: batch thread pool with per-thread shares and stealing; see work_pool.h for the API.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "work_pool.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Polls of the batch counter before a thread sleeps; a few tens of microseconds, about one
+ * exchange round, so back-to-back batches skip the condition variable. */
+#define WP_SPIN 20000
+
+/* One thread's share of a batch: tasks [next, end) packed as end << 32 | next, on its own
+ * cache line so owners and thieves of different shares do not contend. */
+typedef struct {
+    _Alignas(64) _Atomic uint64_t span;
+} wp_share;
+
+struct wp_pool {
+    unsigned threads;
+    pthread_t tids[WP_MAX_THREADS];
+    wp_share *shares;
+
+    /* The current batch, published by the release store to generation */
+    wp_task_fn fn;
+    void *user;
+    _Atomic uint64_t generation;
+    _Atomic unsigned busy;      /* helper threads still working on the batch */
+    _Atomic int stop;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+
+    uint64_t batches;
+    uint64_t tasks;
+    _Atomic uint64_t stolen;
+};
+
+typedef struct {
+    wp_pool *pool;
+    unsigned index;
+} wp_thread_arg;
+
+static int take_front(wp_share *share, size_t *task) {
+    uint64_t span = atomic_load_explicit(&share->span, memory_order_relaxed);
+    for (;;) {
+        uint32_t next = (uint32_t)span, end = (uint32_t)(span >> 32);
+        if (next >= end) return 0;
+        uint64_t taken = (uint64_t)end << 32 | (next + 1);
+        if (atomic_compare_exchange_weak_explicit(&share->span, &span, taken,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            *task = next;
+            return 1;
+        }
+    }
+}
+
+static int take_back(wp_share *share, size_t *task) {
+    uint64_t span = atomic_load_explicit(&share->span, memory_order_relaxed);
+    for (;;) {
+        uint32_t next = (uint32_t)span, end = (uint32_t)(span >> 32);
+        if (next >= end) return 0;
+        uint64_t taken = (uint64_t)(end - 1) << 32 | next;
+        if (atomic_compare_exchange_weak_explicit(&share->span, &span, taken,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            *task = end - 1;
+            return 1;
+        }
+    }
+}
+
+/* Drain our own share, then steal until every share is empty. */
+static void work(wp_pool *p, unsigned self) {
+    size_t task;
+    while (take_front(&p->shares[self], &task)) p->fn(task, p->user);
+    uint64_t stolen = 0;
+    for (unsigned k = 1; k < p->threads; k++) {
+        wp_share *victim = &p->shares[(self + k) % p->threads];
+        while (take_back(victim, &task)) {
+            p->fn(task, p->user);
+            stolen++;
+        }
+    }
+    if (stolen) atomic_fetch_add_explicit(&p->stolen, stolen, memory_order_relaxed);
+}
+
+static void *thread_main(void *arg) {
+    wp_thread_arg a = *(wp_thread_arg *)arg;
+    free(arg);
+    wp_pool *p = a.pool;
+    uint64_t seen = 0;
+    for (;;) {
+        uint64_t gen = 0;
+        for (int spin = 0; spin < WP_SPIN; spin++) {
+            gen = atomic_load_explicit(&p->generation, memory_order_acquire);
+            if (gen != seen || atomic_load_explicit(&p->stop, memory_order_relaxed)) break;
+        }
+        if (gen == seen) {
+            pthread_mutex_lock(&p->lock);
+            while ((gen = atomic_load_explicit(&p->generation, memory_order_acquire)) == seen &&
+                   !atomic_load_explicit(&p->stop, memory_order_relaxed)) {
+                pthread_cond_wait(&p->start, &p->lock);
+            }
+            pthread_mutex_unlock(&p->lock);
+        }
+        if (atomic_load_explicit(&p->stop, memory_order_relaxed)) break;
+        seen = gen;
+        work(p, a.index);
+        if (atomic_fetch_sub_explicit(&p->busy, 1, memory_order_acq_rel) == 1) {
+            pthread_mutex_lock(&p->lock);
+            pthread_cond_signal(&p->done);
+            pthread_mutex_unlock(&p->lock);
+        }
+    }
+    return NULL;
+}
+
+wp_pool *wp_create(unsigned threads) {
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (unsigned)online : 1;
+    }
+    if (threads > WP_MAX_THREADS) threads = WP_MAX_THREADS;
+
+    wp_pool *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    p->shares = aligned_alloc(64, threads * sizeof(wp_share));
+    if (!p->shares) {
+        free(p);
+        return NULL;
+    }
+    for (unsigned t = 0; t < threads; t++) atomic_init(&p->shares[t].span, 0);
+    atomic_init(&p->generation, 0);
+    atomic_init(&p->busy, 0);
+    atomic_init(&p->stop, 0);
+    atomic_init(&p->stolen, 0);
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->start, NULL);
+    pthread_cond_init(&p->done, NULL);
+
+    p->threads = 1;
+    for (unsigned t = 1; t < threads; t++) {
+        wp_thread_arg *arg = malloc(sizeof(*arg));
+        if (!arg) break;
+        *arg = (wp_thread_arg){ p, t };
+        if (pthread_create(&p->tids[t], NULL, thread_main, arg) != 0) {
+            free(arg);
+            break;
+        }
+        p->threads++;
+    }
+    return p;
+}
+
+void wp_destroy(wp_pool *p) {
+    if (!p) return;
+    pthread_mutex_lock(&p->lock);
+    atomic_store_explicit(&p->stop, 1, memory_order_relaxed);
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+    for (unsigned t = 1; t < p->threads; t++) pthread_join(p->tids[t], NULL);
+    pthread_cond_destroy(&p->done);
+    pthread_cond_destroy(&p->start);
+    pthread_mutex_destroy(&p->lock);
+    free(p->shares);
+    free(p);
+}
+
+unsigned wp_threads(const wp_pool *p) {
+    return p ? p->threads : 0;
+}
+
+int wp_run(wp_pool *p, size_t tasks, wp_task_fn fn, void *user) {
+    if (!p || !fn || tasks > UINT32_MAX) return WP_EINVAL;
+    if (tasks == 0) return WP_OK;
+    p->batches++;
+    p->tasks += tasks;
+
+    /* Few tasks, or a pool of one: no point waking anyone */
+    unsigned helpers = tasks > 1 ? p->threads - 1 : 0;
+    if (helpers == 0) {
+        for (size_t i = 0; i < tasks; i++) fn(i, user);
+        return WP_OK;
+    }
+
+    for (unsigned t = 0; t < p->threads; t++) {
+        uint64_t begin = tasks * t / p->threads, end = tasks * (t + 1) / p->threads;
+        atomic_store_explicit(&p->shares[t].span, end << 32 | begin, memory_order_relaxed);
+    }
+    p->fn = fn;
+    p->user = user;
+    atomic_store_explicit(&p->busy, helpers, memory_order_relaxed);
+    pthread_mutex_lock(&p->lock);
+    atomic_fetch_add_explicit(&p->generation, 1, memory_order_release);
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+
+    work(p, 0);
+
+    for (int spin = 0; spin < WP_SPIN; spin++) {
+        if (atomic_load_explicit(&p->busy, memory_order_acquire) == 0) return WP_OK;
+    }
+    pthread_mutex_lock(&p->lock);
+    while (atomic_load_explicit(&p->busy, memory_order_acquire) != 0) {
+        pthread_cond_wait(&p->done, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return WP_OK;
+}
+
+void wp_stats_get(const wp_pool *p, wp_stats *stats) {
+    if (!p || !stats) return;
+    stats->batches = p->batches;
+    stats->tasks = p->tasks;
+    stats->stolen = atomic_load_explicit(&((wp_pool *)p)->stolen, memory_order_relaxed);
+}
@@ -0,0 +1,63 @@
+/**
+ * work_pool: a fixed set of threads that run batches of independent tasks, stealing from
+ * each other when their own share runs dry.
+ *
+ *   wp_pool *pool = wp_create(0);                    one thread per core, counting the caller
+ *   wp_run(pool, n, step_replica, engine);           step_replica(i, engine) for every i < n
+ *   wp_destroy(pool);
+ *
+ * wp_run deals a batch out in contiguous shares, one per thread, and returns once every task
+ * has finished. A thread takes tasks from the front of its own share. When that is empty it
+ * steals them one at a time from the back of the others', so uneven tasks, or a core lost to
+ * another process, do not leave the rest idle. Each share is a single 64-bit word (next, end)
+ * updated by compare-and-swap: taking a task costs one CAS and no lock.
+ *
+ * The calling thread works as thread 0, so a pool of one runs everything inline. The others
+ * spin briefly after a batch, then sleep on a condition variable until the next. Not
+ * thread-safe: one thread at a time submits batches to a pool, and a task must not call
+ * wp_run on its own pool.
+ */
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WP_OK 0
+#define WP_EINVAL -1
+
+#define WP_MAX_THREADS 256
+
+typedef void (*wp_task_fn)(size_t index, void *user);
+
+typedef struct {
+    uint64_t batches;
+    uint64_t tasks;
+    uint64_t stolen;            /* tasks run by a thread other than the one dealt them */
+} wp_stats;
+
+typedef struct wp_pool wp_pool;
+
+/* Start a pool of `threads` (0 for one per online core), the caller included. Threads that
+ * fail to start are left out. NULL if even the pool cannot be allocated. */
+wp_pool *wp_create(unsigned threads);
+
+void wp_destroy(wp_pool *pool);
+
+/* Threads that take part in a batch, the caller included. */
+unsigned wp_threads(const wp_pool *pool);
+
+/* Run fn(i, user) for every i in [0, tasks) and wait for all of them. WP_OK or WP_EINVAL. */
+int wp_run(wp_pool *pool, size_t tasks, wp_task_fn fn, void *user);
+
+void wp_stats_get(const wp_pool *pool, wp_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
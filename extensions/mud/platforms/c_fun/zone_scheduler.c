@@ -0,0 +1,259 @@
+/**
+ * zone_scheduler: fixed-rate sharded ticks and Philox streams; see zone_scheduler.h for the API.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "zone_scheduler.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Philox4x32 multipliers and Weyl key increments (Salmon et al., SC'11) */
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+static void philox_block(const uint32_t key[2], const uint32_t counter[4], uint32_t out[4]) {
+    uint32_t k0 = key[0], k1 = key[1];
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    for (int r = 0; r < PHILOX_ROUNDS; r++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0, p1 = (uint64_t)PHILOX_M1 * c2;
+        c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t)p1;
+        c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/* Counter words: block, stream low, stream high, tick low. The tick's high half goes into the
+ * key, so every (seed, stream, tick) is a different stream. */
+void zs_rng_init(zs_rng *rng, uint64_t seed, uint64_t stream, uint64_t tick) {
+    rng->key[0] = (uint32_t)seed;
+    rng->key[1] = (uint32_t)(seed >> 32) ^ (uint32_t)(tick >> 32);
+    rng->counter[0] = 0;
+    rng->counter[1] = (uint32_t)stream;
+    rng->counter[2] = (uint32_t)(stream >> 32);
+    rng->counter[3] = (uint32_t)tick;
+    philox_block(rng->key, rng->counter, rng->out);
+    rng->used = 0;
+}
+
+uint32_t zs_rng_next(zs_rng *rng) {
+    if (rng->used == 4) {
+        rng->counter[0]++;
+        philox_block(rng->key, rng->counter, rng->out);
+        rng->used = 0;
+    }
+    return rng->out[rng->used++];
+}
+
+float zs_uniform(zs_rng *rng) {
+    return (float)(zs_rng_next(rng) >> 8) * 0x1p-24f;
+}
+
+/* One thread's items and figures. Only that thread writes them; readers use relaxed loads. */
+typedef struct {
+    _Alignas(64) struct zs_scheduler *scheduler;
+    size_t begin, end;
+    pthread_t tid;
+    _Atomic uint64_t ticks;
+    _Atomic uint64_t overruns;
+    _Atomic uint64_t skipped;
+    _Atomic uint64_t max_late_ns;
+    _Atomic uint64_t max_busy_ns;
+    _Atomic uint64_t busy_ns;
+    _Atomic uint64_t finished_ns;   /* when the thread stopped, or 0 while it runs */
+} zs_shard;
+
+struct zs_scheduler {
+    zs_config config;
+    uint64_t period_ns;
+    uint64_t start_ns;
+    unsigned threads;
+    zs_shard *shards;
+    _Atomic int stop;
+
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    unsigned running;
+    int joined;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t ns) {
+    struct timespec ts = { (time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull) };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+static void store_max(_Atomic uint64_t *slot, uint64_t v) {
+    if (v > atomic_load_explicit(slot, memory_order_relaxed)) {
+        atomic_store_explicit(slot, v, memory_order_relaxed);
+    }
+}
+
+static void *shard_main(void *arg) {
+    zs_shard *sh = (zs_shard *)arg;
+    zs_scheduler *s = sh->scheduler;
+    const zs_config *c = &s->config;
+    zs_rng rng;
+    uint64_t n = 0, busy = 0, release = s->start_ns + s->period_ns;
+    while (c->ticks == 0 || n < c->ticks) {
+        sleep_until(release);
+        if (atomic_load_explicit(&s->stop, memory_order_relaxed)) break;
+
+        uint64_t begin = now_ns();
+        for (size_t item = sh->begin; item < sh->end; item++) {
+            zs_rng_init(&rng, c->seed, item, n);
+            c->tick(item, n, &rng, c->user);
+        }
+        uint64_t end = now_ns();
+        n++;
+
+        store_max(&sh->max_late_ns, begin > release ? begin - release : 0);
+        store_max(&sh->max_busy_ns, end - begin);
+        busy += end - begin;
+        atomic_store_explicit(&sh->busy_ns, busy, memory_order_relaxed);
+        atomic_store_explicit(&sh->ticks, n, memory_order_relaxed);
+
+        /* Due by the next release; past it, start late, and drop releases already gone by */
+        release += s->period_ns;
+        if (end > release) {
+            uint64_t behind = (end - release) / s->period_ns;
+            atomic_fetch_add_explicit(&sh->overruns, 1, memory_order_relaxed);
+            if (behind) atomic_fetch_add_explicit(&sh->skipped, behind, memory_order_relaxed);
+            release += behind * s->period_ns;
+        }
+    }
+    atomic_store_explicit(&sh->finished_ns, now_ns(), memory_order_relaxed);
+
+    pthread_mutex_lock(&s->lock);
+    if (--s->running == 0) pthread_cond_broadcast(&s->done);
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+zs_scheduler *zs_start(const zs_config *config) {
+    if (!config || !config->tick || config->items == 0 || !(config->rate_hz > 0.0)) return NULL;
+    unsigned threads = config->threads;
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (unsigned)online : 1;
+    }
+    if (threads > ZS_MAX_THREADS) threads = ZS_MAX_THREADS;
+    if (threads > config->items) threads = (unsigned)config->items;
+
+    zs_scheduler *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->shards = aligned_alloc(64, threads * sizeof(zs_shard));
+    if (!s->shards) {
+        free(s);
+        return NULL;
+    }
+    s->config = *config;
+    s->period_ns = (uint64_t)(1e9 / config->rate_hz);
+    if (s->period_ns == 0) s->period_ns = 1;
+    s->threads = threads;
+    atomic_init(&s->stop, 0);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->done, NULL);
+    s->start_ns = now_ns();
+
+    unsigned started = 0;
+    for (unsigned t = 0; t < threads; t++) {
+        zs_shard *sh = &s->shards[t];
+        sh->scheduler = s;
+        sh->begin = config->items * t / threads;
+        sh->end = config->items * (t + 1) / threads;
+        atomic_init(&sh->ticks, 0);
+        atomic_init(&sh->overruns, 0);
+        atomic_init(&sh->skipped, 0);
+        atomic_init(&sh->max_late_ns, 0);
+        atomic_init(&sh->max_busy_ns, 0);
+        atomic_init(&sh->busy_ns, 0);
+        atomic_init(&sh->finished_ns, 0);
+    }
+    pthread_mutex_lock(&s->lock);
+    for (; started < threads; started++) {
+        zs_shard *sh = &s->shards[started];
+        if (pthread_create(&sh->tid, NULL, shard_main, sh) != 0) break;
+        s->running++;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    if (started < threads) {
+        atomic_store_explicit(&s->stop, 1, memory_order_relaxed);
+        for (unsigned t = 0; t < started; t++) pthread_join(s->shards[t].tid, NULL);
+        pthread_cond_destroy(&s->done);
+        pthread_mutex_destroy(&s->lock);
+        free(s->shards);
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void zs_stop(zs_scheduler *s) {
+    if (s) atomic_store_explicit(&s->stop, 1, memory_order_relaxed);
+}
+
+void zs_wait(zs_scheduler *s) {
+    if (!s) return;
+    pthread_mutex_lock(&s->lock);
+    while (s->running) pthread_cond_wait(&s->done, &s->lock);
+    int join = !s->joined;
+    s->joined = 1;
+    pthread_mutex_unlock(&s->lock);
+    if (join) {
+        for (unsigned t = 0; t < s->threads; t++) pthread_join(s->shards[t].tid, NULL);
+    }
+}
+
+void zs_stats_get(const zs_scheduler *s, zs_stats *stats) {
+    if (!s || !stats) return;
+    uint64_t now = now_ns(), max_late = 0, max_busy = 0, busy = 0, elapsed = 0;
+    *stats = (zs_stats){ .threads = s->threads };
+    for (unsigned t = 0; t < s->threads; t++) {
+        zs_shard *sh = &s->shards[t];
+        stats->ticks += atomic_load_explicit(&sh->ticks, memory_order_relaxed);
+        stats->overruns += atomic_load_explicit(&sh->overruns, memory_order_relaxed);
+        stats->skipped += atomic_load_explicit(&sh->skipped, memory_order_relaxed);
+        uint64_t late = atomic_load_explicit(&sh->max_late_ns, memory_order_relaxed);
+        uint64_t longest = atomic_load_explicit(&sh->max_busy_ns, memory_order_relaxed);
+        if (late > max_late) max_late = late;
+        if (longest > max_busy) max_busy = longest;
+        busy += atomic_load_explicit(&sh->busy_ns, memory_order_relaxed);
+        uint64_t finished = atomic_load_explicit(&sh->finished_ns, memory_order_relaxed);
+        elapsed += (finished ? finished : now) - s->start_ns;
+    }
+    stats->max_late_s = max_late * 1e-9;
+    stats->max_busy_s = max_busy * 1e-9;
+    stats->mean_busy_s = stats->ticks ? busy * 1e-9 / stats->ticks : 0.0;
+    stats->utilization = elapsed ? (double)busy / elapsed : 0.0;
+}
+
+void zs_destroy(zs_scheduler *s) {
+    if (!s) return;
+    zs_stop(s);
+    zs_wait(s);
+    pthread_cond_destroy(&s->done);
+    pthread_mutex_destroy(&s->lock);
+    free(s->shards);
+    free(s);
+}
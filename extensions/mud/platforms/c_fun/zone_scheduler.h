@@ -0,0 +1,100 @@
+/**
+ * zone_scheduler: tick thousands of items at a fixed rate on a few threads, with deadlines.
+ *
+ *   static void tick(size_t zone, uint64_t n, zs_rng *rng, void *zones) { ... zs_uniform(rng) ... }
+ *
+ *   zs_scheduler *s = zs_start(&(zs_config){ .items = 4096, .rate_hz = 100, .ticks = 1000,
+ *                                             .seed = 42, .tick = tick, .user = zones });
+ *   zs_wait(s);                                      returns after 1000 ticks (10 s)
+ *   zs_stats st;
+ *   zs_stats_get(s, &st);                            overruns, lateness, busy time
+ *   zs_destroy(s);
+ *
+ * Items are sharded into contiguous ranges, one per thread. Tick n of every shard is released
+ * at start + n / rate_hz on CLOCK_MONOTONIC and is due by the next release. A thread sleeps
+ * until a release with clock_nanosleep(TIMER_ABSTIME), so the rate does not drift with the
+ * work done. A tick that finishes after its deadline is an overrun, and the next one starts
+ * at once, late. Any further releases that have already passed are skipped and counted rather
+ * than run back to back, so an overloaded shard falls back into phase instead of bursting.
+ *
+ * Randomness is counter-based (Philox4x32-10). Every item gets a stream keyed by (seed, item,
+ * tick), so an item's draws depend on nothing but the seed and how many ticks it has run:
+ * not on the thread count, the sharding, the timing or the order of calls. Each thread owns
+ * one zs_rng and rekeys it before every call to tick.
+ *
+ * tick runs on the scheduler's threads, concurrently for items in different shards. It may
+ * touch its own item freely.
+ */
+#ifndef ZONE_SCHEDULER_H
+#define ZONE_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ZS_MAX_THREADS 256
+
+/* Philox4x32-10 keyed by a seed and positioned at (stream, tick): 2^32 blocks of four words
+ * each before a stream wraps. */
+typedef struct {
+    uint32_t key[2];
+    uint32_t counter[4];
+    uint32_t out[4];
+    unsigned used;              /* words of out already handed out */
+} zs_rng;
+
+void zs_rng_init(zs_rng *rng, uint64_t seed, uint64_t stream, uint64_t tick);
+uint32_t zs_rng_next(zs_rng *rng);
+float zs_uniform(zs_rng *rng);          /* [0, 1) with 24 random bits */
+
+/* `tick` counts the ticks this item has run, skipped releases excluded. */
+typedef void (*zs_tick_fn)(size_t item, uint64_t tick, zs_rng *rng, void *user);
+
+typedef struct {
+    size_t items;
+    unsigned threads;           /* 0 for one per online core; never more than items */
+    double rate_hz;             /* ticks per second */
+    uint64_t ticks;             /* ticks per shard before zs_wait returns; 0 to run until zs_stop */
+    uint64_t seed;
+    zs_tick_fn tick;
+    void *user;
+} zs_config;
+
+typedef struct {
+    unsigned threads;
+    uint64_t ticks;             /* shard ticks run, summed over threads */
+    uint64_t overruns;          /* finished after their deadline */
+    uint64_t skipped;           /* releases dropped to get back in phase */
+    double max_late_s;          /* worst wake-up after a release */
+    double max_busy_s;          /* worst time to run one shard tick */
+    double mean_busy_s;
+    double utilization;         /* busy time / elapsed time, averaged over threads */
+} zs_stats;
+
+typedef struct zs_scheduler zs_scheduler;
+
+/* Start ticking; the first release is one period from now. NULL on a bad config, or if the
+ * scheduler cannot be allocated or a thread fails to start. */
+zs_scheduler *zs_start(const zs_config *config);
+
+/* Ask every shard to stop at its next release, at most one period away. Safe from any
+ * thread, including tick. */
+void zs_stop(zs_scheduler *scheduler);
+
+/* Block until every shard has run `ticks` ticks or stopped. */
+void zs_wait(zs_scheduler *scheduler);
+
+/* Live figures; safe while the scheduler runs. */
+void zs_stats_get(const zs_scheduler *scheduler, zs_stats *stats);
+
+/* Stop, join the threads and free. NULL does nothing. */
+void zs_destroy(zs_scheduler *scheduler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * adc_sampler: off-thread sensor sampling through an SPSC frame ring; see adc_sampler.h for
+ * the API.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "adc_sampler.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define AS_DEFAULT_CAPACITY 256
+
+typedef struct {
+    float values[AS_MAX_CHANNELS];
+} as_frame;
+
+struct as_sampler {
+    as_config config;
+    as_frame *frames;
+    uint64_t mask;
+    pthread_t thread;
+    atomic_bool stop;
+
+    _Alignas(64) _Atomic uint64_t tail;     /* written by the sampler; also frames queued */
+    _Atomic uint64_t dropped;
+    _Atomic uint64_t errors;
+
+    _Alignas(64) _Atomic uint64_t head;     /* written by the consumer */
+};
+
+static void take_frame(as_sampler *s) {
+    as_frame frame;
+    if (s->config.read(frame.values, s->config.channels, s->config.user) != 0) {
+        atomic_fetch_add_explicit(&s->errors, 1, memory_order_relaxed);
+        return;
+    }
+    uint64_t tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&s->head, memory_order_acquire) > s->mask) {
+        atomic_fetch_add_explicit(&s->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    s->frames[tail & s->mask] = frame;
+    atomic_store_explicit(&s->tail, tail + 1, memory_order_release);
+}
+
+static void *run_sampler(void *arg) {
+    as_sampler *s = arg;
+    /* Paces the thread at rate_hz; with `wait` it only applies the realtime settings */
+    rt_loop loop;
+    rt_loop_init(&loop, &(rt_config){
+        .rate_hz = s->config.wait ? 1.0 : s->config.rate_hz,
+        .priority = s->config.priority,
+        .cpus = s->config.cpus,
+        .clock = s->config.clock
+    });
+    while (!atomic_load_explicit(&s->stop, memory_order_relaxed)) {
+        if (!s->config.wait) {
+            take_frame(s);
+            if (!rt_loop_wait(&loop)) break;
+            continue;
+        }
+        int ready = s->config.wait(s->config.user);
+        if (ready > 0) take_frame(s);
+        else if (ready < 0) atomic_fetch_add_explicit(&s->errors, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+as_sampler *as_start(const as_config *config) {
+    if (!config || !config->read || config->channels == 0 ||
+        config->channels > AS_MAX_CHANNELS) {
+        return NULL;
+    }
+    if (!config->wait && !(config->rate_hz > 0.0)) return NULL;
+    uint64_t capacity = config->capacity ? config->capacity : AS_DEFAULT_CAPACITY;
+    if (capacity > (1u << 24)) return NULL;
+    uint64_t rounded = 2;
+    while (rounded < capacity) rounded <<= 1;
+
+    as_sampler *s = aligned_alloc(64, sizeof(as_sampler));
+    if (!s) return NULL;
+    s->frames = malloc(rounded * sizeof(as_frame));
+    if (!s->frames) {
+        free(s);
+        return NULL;
+    }
+    s->config = *config;
+    s->mask = rounded - 1;
+    atomic_init(&s->stop, false);
+    atomic_init(&s->tail, 0);
+    atomic_init(&s->dropped, 0);
+    atomic_init(&s->errors, 0);
+    atomic_init(&s->head, 0);
+    if (pthread_create(&s->thread, NULL, run_sampler, s) != 0) {
+        free(s->frames);
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+unsigned as_drain(as_sampler *s, float *mean) {
+    if (!s || !mean) return 0;
+    uint64_t head = atomic_load_explicit(&s->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&s->tail, memory_order_acquire);
+    if (tail == head) return 0;
+
+    unsigned channels = s->config.channels;
+    double sum[AS_MAX_CHANNELS] = { 0 };
+    for (uint64_t p = head; p < tail; p++) {
+        const as_frame *frame = &s->frames[p & s->mask];
+        for (unsigned c = 0; c < channels; c++) sum[c] += frame->values[c];
+    }
+    atomic_store_explicit(&s->head, tail, memory_order_release);
+
+    uint64_t n = tail - head;
+    for (unsigned c = 0; c < channels; c++) mean[c] = (float)(sum[c] / (double)n);
+    return (unsigned)n;
+}
+
+void as_stats_get(const as_sampler *sampler, as_stats *stats) {
+    if (!sampler || !stats) return;
+    as_sampler *s = (as_sampler *)sampler;
+    stats->frames = atomic_load_explicit(&s->tail, memory_order_relaxed);
+    stats->drained = atomic_load_explicit(&s->head, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&s->dropped, memory_order_relaxed);
+    stats->errors = atomic_load_explicit(&s->errors, memory_order_relaxed);
+}
+
+void as_stop(as_sampler *s) {
+    if (!s) return;
+    atomic_store(&s->stop, true);
+    pthread_join(s->thread, NULL);
+    free(s->frames);
+    free(s);
+}
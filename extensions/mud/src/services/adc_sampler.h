@@ -0,0 +1,78 @@
+/**
+ * adc_sampler: sample analog sensors on a thread of their own into a ring the control loop
+ * drains without blocking.
+ *
+ *   static int read_adc(float *v, unsigned n, void *u) { ... v[i] = analogRead(pin[i]) ...; }
+ *
+ *   as_sampler *s = as_start(&(as_config){ .channels = 4, .rate_hz = 1000, .read = read_adc });
+ *   float readings[4];
+ *   unsigned frames = as_drain(s, readings);     each tick: the mean of the frames since the
+ *                                                last drain; readings untouched if none
+ *   as_stop(s);
+ *
+ * The sampling thread takes a frame of every channel at rate_hz, paced by rt_loop, or each
+ * time `wait` says the converter has one ready: wiringPi's waitForInterrupt on an ADC's
+ * data-ready pin, for instance. Either way a slow conversion stalls only the sampler, and
+ * averaging the frames between control ticks oversamples away some of the noise.
+ *
+ * Frames go through a single-producer, single-consumer ring with one release store a side;
+ * if the consumer stops draining, new frames are dropped and counted until there is room.
+ * One thread drains a sampler.
+ */
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include <stdint.h>
+
+#include "rt_loop.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AS_MAX_CHANNELS 8
+
+/* Convert one frame, a value per channel; 0 on success. Runs on the sampling thread. */
+typedef int (*as_read_fn)(float *values, unsigned channels, void *user);
+
+/* Block until a frame is ready; above 0 if one is, 0 on a timeout, below 0 on an error. */
+typedef int (*as_wait_fn)(void *user);
+
+typedef struct {
+    unsigned channels;          /* 1 to AS_MAX_CHANNELS */
+    double rate_hz;             /* frames per second; unused with `wait` */
+    unsigned capacity;          /* frames, rounded up to a power of two; 0 for 256 */
+    int priority;               /* for the sampling thread, as in rt_config */
+    uint64_t cpus;
+    const rt_clock *clock;      /* paces rate_hz; NULL for CLOCK_MONOTONIC */
+    as_read_fn read;
+    as_wait_fn wait;            /* NULL to sample at rate_hz */
+    void *user;
+} as_config;
+
+typedef struct {
+    uint64_t frames;            /* frames queued */
+    uint64_t drained;           /* frames the consumer took */
+    uint64_t dropped;           /* frames lost to a full ring */
+    uint64_t errors;            /* failed reads and waits */
+} as_stats;
+
+typedef struct as_sampler as_sampler;
+
+/* Start the sampling thread. NULL on a bad config, out of memory or if the thread fails. */
+as_sampler *as_start(const as_config *config);
+
+/* Average every frame queued since the last drain into `mean`; returns how many there were,
+ * leaving `mean` as it was if none. */
+unsigned as_drain(as_sampler *sampler, float *mean);
+
+void as_stats_get(const as_sampler *sampler, as_stats *stats);
+
+/* Stop and join the sampling thread, then free. NULL does nothing. */
+void as_stop(as_sampler *sampler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,9 +5,14 @@
 #include "swellpro_flight.h"
 #include "swellpro_bait.h"
 #include "swellpro_wing_control.h"
+#include "rt_loop.h"
+#include "wing_frame.h"
 
 // Glide Configuration
-#define GLIDE_CONFIG {
+static const struct {
+    float ARM_ANGLE, WING_SPAN, WING_CHORD, ARM_LENGTH;
+    float MIN_ALTITUDE, GLIDE_RATIO, ROTOR_SPIN_DOWN, BAIT_TOGGLE_INTERVAL;
+} GLIDE_CONFIG = {
     .ARM_ANGLE = 45.0,        // Degrees from vertical
     .WING_SPAN = 2.5,         // Meters
     .WING_CHORD = 0.4,        // Meters
@@ -16,7 +21,25 @@
     .GLIDE_RATIO = 15.0,      // L/D ratio
     .ROTOR_SPIN_DOWN = 2.0,   // Seconds
     .BAIT_TOGGLE_INTERVAL = 5.0 // Seconds
-}
+};
+
+// Control loop timing
+#define GLIDE_LOOP_HZ 50.0
+#define GLIDE_LOOP_PRIORITY 0     // SCHED_FIFO priority (1-99); 0 keeps the default policy
+#define GLIDE_LOOP_CPUS 0         // CPU mask to pin the loop to; 0 leaves it unpinned
+
+// Stand-in the HIL bench builds with: an rt_clock for the loop
+#ifndef GLIDE_LOOP_CLOCK
+#define GLIDE_LOOP_CLOCK NULL
+#endif
+
+// Where the glide sequence is; each tick advances the current phase by one step
+typedef enum {
+    GLIDE_DEPLOY_ARMS,
+    GLIDE_DEPLOY_WINGS,
+    GLIDE_SPIN_DOWN,
+    GLIDE_GLIDING
+} GlidePhase;
 
 typedef struct {
     float armAngle;
@@ -27,6 +50,10 @@ typedef struct {
     bool rotorsSpinning;
     bool baitActive;
     float lastBaitToggle;
+    GlidePhase phase;
+    float spinDownTime;
+    SwellproFlightCommand lastFlightCmd;
+    bool flightCmdSent;
 } GlideState;
 
 // Global state
@@ -34,6 +61,7 @@ GlideState glideState;
 SwellproFlight* flightController;
 SwellproBait* baitController;
 SwellproWing* wingController;
+wf_frame wingFrame;          // The whole wing as one section
 
 // Initialize glide system
 void initializeGlide() {
@@ -55,72 +83,87 @@ void initializeGlide() {
     glideState.rotorsSpinning = true;
     glideState.baitActive = false;
     glideState.lastBaitToggle = 0.0;
+    glideState.phase = GLIDE_DEPLOY_ARMS;
+    glideState.spinDownTime = 0.0;
+    glideState.flightCmdSent = false;
+    wf_init(&wingFrame, 1, 0.0f);
 }
 
-// Deploy spider-plant style wing system
-void deployWingSystem() {
-    // Calculate required arm angle based on current conditions
-    float targetArmAngle = GLIDE_CONFIG.ARM_ANGLE;
-    float currentArmAngle = glideState.armAngle;
+// Send the wing's changes to the wing controller
+static int sendWingFrame(const wf_change* changes, unsigned count, void* user) {
+    (void)user;
+    for (unsigned c = 0; c < count; c++) {
+        SwellproWingCommand wingCmd = {
+            .deployment = changes[c].value.deployment,
+            .flapAngle = changes[c].value.flap_angle,
+            .ventOpen = changes[c].value.vent_open,
+            .pocketDepth = changes[c].value.pocket_depth
+        };
+        if (swellproExecuteWingCommand(wingController, &wingCmd) != 0) return -1;
+    }
+    return 0;
+}
+
+// Command the wing to a deployment, flaps and vents neutral; nothing is sent if unchanged
+static void commandWingDeployment(float deployment) {
+    wf_set(&wingFrame, 0, &(wf_section){ .deployment = deployment });
+    wf_flush(&wingFrame, sendWingFrame, NULL);
+}
+
+// Deploy spider-plant style wing system: one step of the arms, then of the wings, per call.
+// Returns true once both are out.
+bool deployWingSystem() {
+    if (glideState.phase == GLIDE_DEPLOY_ARMS) {
+        // Calculate required arm angle based on current conditions
+        float targetArmAngle = GLIDE_CONFIG.ARM_ANGLE;
+
+        // Smooth arm deployment
+        if (fabs(glideState.armAngle - targetArmAngle) <= 0.1) {
+            glideState.phase = GLIDE_DEPLOY_WINGS;
+            return false;
+        }
+        glideState.armAngle += (targetArmAngle - glideState.armAngle) * 0.1;
 
-    // Smooth arm deployment
-    while (fabs(currentArmAngle - targetArmAngle) > 0.1) {
-        currentArmAngle += (targetArmAngle - currentArmAngle) * 0.1;
-        
         // Update arm position
         SwellproArmCommand armCmd = {
-            .angle = currentArmAngle,
+            .angle = glideState.armAngle,
             .speed = 0.5
         };
         swellproExecuteArmCommand(wingController, &armCmd);
-        
-        delay(20);
+        return false;
     }
 
     // Deploy wings
     float targetDeployment = 1.0;
-    float currentDeployment = glideState.wingDeployment;
+    if (fabs(glideState.wingDeployment - targetDeployment) <= 0.1) return true;
+    glideState.wingDeployment += (targetDeployment - glideState.wingDeployment) * 0.1;
 
-    while (fabs(currentDeployment - targetDeployment) > 0.1) {
-        currentDeployment += (targetDeployment - currentDeployment) * 0.1;
-        
-        // Update wing deployment
-        SwellproWingCommand wingCmd = {
-            .deployment = currentDeployment,
-            .flapAngle = 0.0,
-            .ventOpen = 0.0,
-            .pocketDepth = 0.0
-        };
-        swellproExecuteWingCommand(wingController, &wingCmd);
-        
-        delay(20);
-    }
+    // Update wing deployment
+    commandWingDeployment(glideState.wingDeployment);
+    return false;
 }
 
-// Spin down rotors
-void spinDownRotors() {
-    if (!glideState.rotorsSpinning) return;
+// Spin down rotors: one step of the ramp per call, `elapsed` seconds further along it.
+// Returns true once they have stopped.
+bool spinDownRotors(float elapsed) {
+    if (!glideState.rotorsSpinning) return true;
 
     // Gradually reduce rotor speed
-    float currentSpeed = 1.0;
-    float targetSpeed = 0.0;
-    float spinDownTime = 0.0;
-
-    while (spinDownTime < GLIDE_CONFIG.ROTOR_SPIN_DOWN) {
-        currentSpeed = 1.0 - (spinDownTime / GLIDE_CONFIG.ROTOR_SPIN_DOWN);
-        
-        // Update rotor speed
-        SwellproRotorCommand rotorCmd = {
-            .speed = currentSpeed,
-            .mode = ROTOR_GLIDE
-        };
-        swellproExecuteRotorCommand(flightController, &rotorCmd);
-        
-        spinDownTime += 0.02;
-        delay(20);
+    if (glideState.spinDownTime >= GLIDE_CONFIG.ROTOR_SPIN_DOWN) {
+        glideState.rotorsSpinning = false;
+        return true;
     }
+    float currentSpeed = 1.0 - (glideState.spinDownTime / GLIDE_CONFIG.ROTOR_SPIN_DOWN);
+
+    // Update rotor speed
+    SwellproRotorCommand rotorCmd = {
+        .speed = currentSpeed,
+        .mode = ROTOR_GLIDE
+    };
+    swellproExecuteRotorCommand(flightController, &rotorCmd);
 
-    glideState.rotorsSpinning = false;
+    glideState.spinDownTime += elapsed;
+    return false;
 }
 
 // Toggle bait system
@@ -154,16 +197,34 @@ void calculateGlideParameters() {
         .heading = 0.0, // Maintain current heading
         .altitude = glideState.targetAltitude
     };
+
+    // The same command again only costs bandwidth
+    const SwellproFlightCommand* last = &glideState.lastFlightCmd;
+    if (glideState.flightCmdSent && last->type == flightCmd.type &&
+        last->speed == flightCmd.speed && last->heading == flightCmd.heading &&
+        last->altitude == flightCmd.altitude) {
+        return;
+    }
     swellproExecuteFlightCommand(flightController, &flightCmd);
+    glideState.lastFlightCmd = flightCmd;
+    glideState.flightCmdSent = true;
 }
 
-// Main glide control loop
+// Main glide control loop, paced by absolute deadlines rather than a delay after the work
 void glideControlLoop() {
-    // Deploy wing system
-    deployWingSystem();
-
-    // Spin down rotors
-    spinDownRotors();
+    rt_loop loop;
+    int status = rt_loop_init(&loop, &(rt_config){
+        .rate_hz = GLIDE_LOOP_HZ,
+        .priority = GLIDE_LOOP_PRIORITY,
+        .cpus = GLIDE_LOOP_CPUS,
+        .clock = GLIDE_LOOP_CLOCK
+    });
+    if (status == RT_EINVAL) {
+        printf("Invalid glide loop timing\n");
+        exit(1);
+    }
+    if (status != RT_OK) printf("Glide loop running without realtime scheduling\n");
+    unsigned periods = 1;
 
     while (1) {
         // Update current altitude
@@ -171,37 +232,46 @@ void glideControlLoop() {
         swellproGetFlightData(flightController, &flightData);
         glideState.currentAltitude = flightData.altitude;
 
-        // Check if we need to exit glide mode
-        if (glideState.currentAltitude < GLIDE_CONFIG.MIN_ALTITUDE * 0.5) {
-            // Restart rotors and retract wings
-            SwellproRotorCommand rotorCmd = {
-                .speed = 1.0,
-                .mode = ROTOR_NORMAL
-            };
-            swellproExecuteRotorCommand(flightController, &rotorCmd);
-            glideState.rotorsSpinning = true;
-
-            // Retract wings
-            SwellproWingCommand wingCmd = {
-                .deployment = 0.0,
-                .flapAngle = 0.0,
-                .ventOpen = 0.0,
-                .pocketDepth = 0.0
-            };
-            swellproExecuteWingCommand(wingController, &wingCmd);
-
-            break;
-        }
+        // Deploy the wing system, then spin down the rotors, a step per tick
+        if (glideState.phase == GLIDE_DEPLOY_ARMS || glideState.phase == GLIDE_DEPLOY_WINGS) {
+            if (deployWingSystem()) glideState.phase = GLIDE_SPIN_DOWN;
+        } else if (glideState.phase == GLIDE_SPIN_DOWN) {
+            if (spinDownRotors(periods * rt_loop_period(&loop))) glideState.phase = GLIDE_GLIDING;
+        } else {
+            // Check if we need to exit glide mode
+            if (glideState.currentAltitude < GLIDE_CONFIG.MIN_ALTITUDE * 0.5) {
+                // Restart rotors and retract wings
+                SwellproRotorCommand rotorCmd = {
+                    .speed = 1.0,
+                    .mode = ROTOR_NORMAL
+                };
+                swellproExecuteRotorCommand(flightController, &rotorCmd);
+                glideState.rotorsSpinning = true;
 
-        // Toggle bait system
-        toggleBaitSystem();
+                // Retract wings
+                glideState.wingDeployment = 0.0;
+                commandWingDeployment(glideState.wingDeployment);
 
-        // Update glide parameters
-        calculateGlideParameters();
+                break;
+            }
 
-        // Small delay for stability
-        delay(20);
+            // Toggle bait system
+            toggleBaitSystem();
+
+            // Update glide parameters
+            calculateGlideParameters();
+        }
+
+        // Wait for the next tick
+        periods = rt_loop_wait(&loop);
+        if (!periods) break;
     }
+
+    rt_stats stats;
+    rt_loop_stats(&loop, &stats);
+    printf("Glide loop: %llu ticks, %llu overruns, worst wake-up %.1f us late\n",
+           (unsigned long long)stats.ticks, (unsigned long long)stats.overruns,
+           stats.max_late_s * 1e6);
 }
 
 int main() {
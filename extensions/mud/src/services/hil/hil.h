@@ -0,0 +1,67 @@
+/**
+ * hil: hardware-in-the-loop replay bench for the wing control loops.
+ *
+ *   make -C hil                                  one bench per control loop
+ *   hil/hil_swellpro [--speed 1000] [--from S] [recording.csv]
+ *
+ * Each bench builds one control loop unchanged against the mock swellpro_* and wiringPi
+ * headers here, with its main renamed. The mocks answer flight data and analog reads from a
+ * recorded flight, sample-and-hold, and count every command and I2C message they are handed.
+ * The loop runs on hil_clock, a replay clock running `speed` times faster than real time, so
+ * at 1000x a 50 Hz loop has 20 us of real time per tick. The recording is open loop: commands
+ * do not change the flight. When it runs out the clock ends the loop, and the bench reports
+ * loop cost in real time and command bandwidth in flight time.
+ *
+ * A recording is CSV with a header line and the columns
+ *   t,altitude,airspeed,x,y,z,vx,vy,vz,roll,pitch,yaw,pressure,ax,ay,az
+ * (seconds, metres, m/s, degrees; the last four as fractions of the ADC range). Without one
+ * the bench flies a built-in synthetic profile: cruise, a long descent through bait-drop and
+ * VTOL altitudes with a gust, and a climb back out.
+ */
+#ifndef HIL_H
+#define HIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../pca9685.h"
+#include "../rt_loop.h"
+
+typedef struct {
+    double t;
+    float altitude;
+    float airspeed;
+    float position[3];
+    float velocity[3];
+    float attitude[3];          /* roll, pitch, yaw */
+    float pressure;
+    float accel[3];
+} hil_sample;
+
+typedef enum {
+    HIL_FLIGHT,
+    HIL_ROTOR,
+    HIL_ARM,
+    HIL_WING,
+    HIL_BAIT,
+    HIL_I2C,                    /* one per message */
+    HIL_KINDS
+} hil_kind;
+
+/* Paces the control loop; hil_sampler_clock paces a sensor sampler's thread. */
+extern const rt_clock hil_clock;
+extern const rt_clock hil_sampler_clock;
+
+/* Seconds of flight since the replay started. */
+double hil_time_s(void);
+
+/* The recorded sample in force at the current replay time. */
+const hil_sample *hil_now(void);
+
+/* Count a command of `bytes` bytes. Safe from any thread. */
+void hil_count(hil_kind kind, size_t bytes);
+
+/* pca_transfer_fn standing in for the I2C bus. */
+int hil_i2c_transfer(const pca_message *messages, unsigned count, void *user);
+
+#endif
@@ -0,0 +1,290 @@
+/**
+ * hil_bench: replay clock, recordings and the report for one control loop; see hil.h.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "hil.h"
+
+#include <math.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef HIL_LOOP
+#define HIL_LOOP "control loop"
+#endif
+
+#define HIL_DEFAULT_SPEED 1000.0
+#define HIL_SPIN_NS 200000          /* closer to a deadline than this, yield instead of sleep */
+#define HIL_SYNTHETIC_HZ 10.0       /* the synthetic recorder's sample rate */
+#define HIL_SYNTHETIC_S 150.0
+
+/* The control loop's own main, renamed by the build */
+int hil_control_main(void);
+
+/* Real-time cost of every tick one loop ran, as its clock saw it */
+typedef struct {
+    uint64_t *costs;
+    size_t count;
+    size_t capacity;
+    uint64_t late;              /* ticks that finished after their next release */
+    uint64_t woke_real;
+    uint64_t last_release;
+    uint64_t period;            /* shortest gap between releases seen; the loop's period */
+} hil_loop;
+
+static struct {
+    hil_sample *samples;
+    size_t count;
+    double speed;
+    double from_s;
+    uint64_t end_ns;            /* replay time at which the recording runs out */
+    uint64_t start_real;
+} replay;
+
+static hil_loop control_loop, sampler_loop;
+static _Atomic uint64_t commands[HIL_KINDS], command_bytes[HIL_KINDS];
+
+static uint64_t replay_ns(void) {
+    if (!replay.start_real) return 0;
+    return (uint64_t)((double)(rt_now_ns() - replay.start_real) * replay.speed);
+}
+
+double hil_time_s(void) {
+    return replay_ns() * 1e-9;
+}
+
+const hil_sample *hil_now(void) {
+    double t = replay.from_s + hil_time_s();
+    size_t lo = 0, hi = replay.count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (replay.samples[mid].t <= t) lo = mid;
+        else hi = mid;
+    }
+    return &replay.samples[lo];
+}
+
+void hil_count(hil_kind kind, size_t bytes) {
+    atomic_fetch_add_explicit(&commands[kind], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&command_bytes[kind], bytes, memory_order_relaxed);
+}
+
+static uint64_t clock_now(void *ctx) {
+    hil_loop *loop = ctx;
+    if (!loop->woke_real) loop->woke_real = rt_now_ns();  /* rt_loop_init: the first tick */
+    return replay_ns();
+}
+
+static int clock_sleep_until(uint64_t ns, void *ctx) {
+    hil_loop *loop = ctx;
+    uint64_t real = rt_now_ns();
+    if (loop->count == loop->capacity) {
+        size_t capacity = loop->capacity ? loop->capacity * 2 : 4096;
+        uint64_t *costs = realloc(loop->costs, capacity * sizeof(uint64_t));
+        if (costs) {
+            loop->costs = costs;
+            loop->capacity = capacity;
+        }
+    }
+    if (loop->count < loop->capacity) loop->costs[loop->count++] = real - loop->woke_real;
+    if (loop->last_release && ns > loop->last_release &&
+        (!loop->period || ns - loop->last_release < loop->period)) {
+        loop->period = ns - loop->last_release;
+    }
+    loop->last_release = ns;
+    if (ns >= replay.end_ns) return 1;
+
+    uint64_t target = replay.start_real + (uint64_t)((double)ns / replay.speed);
+    if (target <= real) {
+        loop->late++;
+    } else {
+        if (target - real > HIL_SPIN_NS) {
+            uint64_t wake = target - HIL_SPIN_NS;
+            struct timespec ts = { (time_t)(wake / 1000000000ull), (long)(wake % 1000000000ull) };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+        while (rt_now_ns() < target) sched_yield();
+    }
+    loop->woke_real = rt_now_ns();
+    return 0;
+}
+
+const rt_clock hil_clock = { clock_now, clock_sleep_until, &control_loop };
+const rt_clock hil_sampler_clock = { clock_now, clock_sleep_until, &sampler_loop };
+
+static int parse_sample(const char *line, hil_sample *s) {
+    float *fields[] = {
+        &s->altitude, &s->airspeed, &s->position[0], &s->position[1], &s->position[2],
+        &s->velocity[0], &s->velocity[1], &s->velocity[2], &s->attitude[0], &s->attitude[1],
+        &s->attitude[2], &s->pressure, &s->accel[0], &s->accel[1], &s->accel[2]
+    };
+    char *end;
+    s->t = strtod(line, &end);
+    if (end == line) return -1;
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        if (*end != ',') return -1;
+        line = end + 1;
+        *fields[i] = strtof(line, &end);
+        if (end == line) return -1;
+    }
+    return 0;
+}
+
+static int load_recording(const char *path) {
+    FILE *in = fopen(path, "r");
+    if (!in) return -1;
+    char line[512];
+    size_t capacity = 0, number = 0;
+    while (fgets(line, sizeof(line), in)) {
+        number++;
+        hil_sample sample;
+        if (parse_sample(line, &sample) != 0) {
+            if (number == 1) continue;                  /* the header */
+            fprintf(stderr, "hil: %s:%zu: expected 16 comma-separated numbers\n", path, number);
+            fclose(in);
+            return -1;
+        }
+        if (replay.count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            hil_sample *samples = realloc(replay.samples, capacity * sizeof(hil_sample));
+            if (!samples) {
+                fclose(in);
+                return -1;
+            }
+            replay.samples = samples;
+        }
+        replay.samples[replay.count++] = sample;
+    }
+    fclose(in);
+    return replay.count ? 0 : -1;
+}
+
+/* Cruise at 300 m, descend through bait-drop and VTOL altitudes (a gust rolls the airframe to
+ * 40 degrees on the way down), hover, then climb back out to 80 m */
+static int synthesize_recording(void) {
+    replay.count = (size_t)(HIL_SYNTHETIC_S * HIL_SYNTHETIC_HZ) + 1;
+    replay.samples = calloc(replay.count, sizeof(hil_sample));
+    if (!replay.samples) return -1;
+    uint64_t noise = 0x9e3779b97f4a7c15ull;
+    float x = 0.0f;
+    for (size_t i = 0; i < replay.count; i++) {
+        hil_sample *s = &replay.samples[i];
+        double t = i / HIL_SYNTHETIC_HZ;
+        float climb, altitude, airspeed;
+        if (t < 20.0) {
+            altitude = 300.0f, climb = 0.0f, airspeed = 15.0f;
+        } else if (t < 100.0) {
+            climb = -298.0f / 80.0f, altitude = 300.0f + climb * (float)(t - 20.0);
+            airspeed = 12.0f;
+        } else if (t < 115.0) {
+            altitude = 2.0f, climb = 0.0f, airspeed = 3.0f;
+        } else {
+            climb = 78.0f / 35.0f, altitude = 2.0f + climb * (float)(t - 115.0);
+            airspeed = 10.0f;
+        }
+        float jitter[4];
+        for (int k = 0; k < 4; k++) {
+            noise ^= noise << 13, noise ^= noise >> 7, noise ^= noise << 17;
+            jitter[k] = (float)(noise >> 40) / (float)(1u << 24) - 0.5f;
+        }
+        x += airspeed / (float)HIL_SYNTHETIC_HZ;
+        s->t = t;
+        s->altitude = altitude;
+        s->airspeed = airspeed;
+        s->position[0] = x, s->position[1] = 0.0f, s->position[2] = altitude;
+        s->velocity[0] = airspeed, s->velocity[1] = 0.0f, s->velocity[2] = climb;
+        s->attitude[0] = t >= 45.0 && t < 47.0 ? 40.0f : 8.0f * (float)sin(0.4 * t);
+        s->attitude[1] = climb * 2.0f;
+        s->attitude[2] = 90.0f;
+        s->pressure = 0.5f + 0.05f * (float)sin(0.7 * t) + 0.02f * jitter[0];
+        s->accel[0] = 0.5f + 0.04f * jitter[1];
+        s->accel[1] = 0.5f + 0.04f * jitter[2];
+        s->accel[2] = 0.7f + 0.04f * jitter[3];
+    }
+    return 0;
+}
+
+static int compare_costs(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report_loop(const char *name, hil_loop *loop) {
+    if (loop->count == 0) return;
+    qsort(loop->costs, loop->count, sizeof(uint64_t), compare_costs);
+    double p50 = loop->costs[loop->count / 2] * 1e-3;
+    double p99 = loop->costs[(size_t)(loop->count * 0.99)] * 1e-3;
+    double worst = loop->costs[loop->count - 1] * 1e-3;
+    double budget = loop->period / replay.speed * 1e-3;
+    printf("%s: %zu ticks at %.0f Hz, cost p50 %.1f us, p99 %.1f us, worst %.1f us, "
+           "budget %.1f us; %llu late\n",
+           name, loop->count, loop->period ? 1e9 / loop->period : 0.0, p50, p99, worst, budget,
+           (unsigned long long)loop->late);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    replay.speed = HIL_DEFAULT_SPEED;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            replay.speed = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            replay.from_s = strtod(argv[++i], NULL);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [--speed X] [--from SECONDS] [recording.csv]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!(replay.speed > 0.0)) {
+        fprintf(stderr, "hil: --speed must be positive\n");
+        return 2;
+    }
+    if (path ? load_recording(path) != 0 : synthesize_recording() != 0) {
+        fprintf(stderr, "hil: cannot load the recording %s\n", path ? path : "(synthetic)");
+        return 1;
+    }
+    double last = replay.samples[replay.count - 1].t;
+    if (!(replay.from_s < last)) {
+        fprintf(stderr, "hil: the recording ends at %.1f s\n", last);
+        return 2;
+    }
+    replay.end_ns = (uint64_t)((last - replay.from_s) * 1e9);
+
+    replay.start_real = rt_now_ns();
+    hil_control_main();
+    double real_s = (rt_now_ns() - replay.start_real) * 1e-9;
+    double flight_s = hil_time_s() < last - replay.from_s ? hil_time_s() : last - replay.from_s;
+
+    printf("\n=== HIL replay: %s ===\n", HIL_LOOP);
+    printf("Flight: %.1f s of %s from %.1f s, at %.0fx in %.3f s real (%.0fx achieved)\n",
+           flight_s, path ? path : "the synthetic profile", replay.from_s, replay.speed, real_s,
+           flight_s / real_s);
+    report_loop("Control loop", &control_loop);
+    report_loop("Sensor sampler", &sampler_loop);
+
+    static const char *const kinds[HIL_KINDS] = {
+        "flight", "rotor", "arm", "wing", "bait", "i2c message"
+    };
+    uint64_t total = 0, total_bytes = 0;
+    printf("%-12s %10s %10s %12s\n", "Commands", "count", "per s", "bytes per s");
+    for (int k = 0; k < HIL_KINDS; k++) {
+        uint64_t n = atomic_load(&commands[k]), bytes = atomic_load(&command_bytes[k]);
+        total += n;
+        total_bytes += bytes;
+        if (n) {
+            printf("%-12s %10llu %10.1f %12.1f\n", kinds[k], (unsigned long long)n,
+                   n / flight_s, bytes / flight_s);
+        }
+    }
+    printf("%-12s %10llu %10.1f %12.1f\n", "total", (unsigned long long)total,
+           total / flight_s, total_bytes / flight_s);
+    free(control_loop.costs);
+    free(sampler_loop.costs);
+    free(replay.samples);
+    return 0;
+}
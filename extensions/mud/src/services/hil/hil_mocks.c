@@ -0,0 +1,99 @@
+/**
+ * hil_mocks: the Swellpro SDK and wiringPi calls answered from the replay; see hil.h.
+ */
+#include "hil.h"
+#include "swellpro_bait.h"
+#include "swellpro_flight.h"
+#include "swellpro_wing_control.h"
+#include "wiringPi.h"
+
+/* Handles only need to be distinct and non-NULL */
+static char flight_handle, bait_handle, wing_handle;
+
+SwellproFlight *swellproFlightInit(void) {
+    return (SwellproFlight *)&flight_handle;
+}
+
+SwellproBait *swellproBaitInit(void) {
+    return (SwellproBait *)&bait_handle;
+}
+
+SwellproWing *swellproWingInit(void) {
+    return (SwellproWing *)&wing_handle;
+}
+
+float swellproGetTime(void) {
+    return (float)hil_time_s();
+}
+
+void swellproGetFlightData(SwellproFlight *flight, SwellproFlightData *data) {
+    (void)flight;
+    const hil_sample *s = hil_now();
+    data->position = (SwellproVector){ s->position[0], s->position[1], s->position[2] };
+    data->velocity = (SwellproVector){ s->velocity[0], s->velocity[1], s->velocity[2] };
+    data->attitude = (SwellproAttitude){ s->attitude[0], s->attitude[1], s->attitude[2] };
+    data->altitude = s->altitude;
+    data->airspeed = s->airspeed;
+}
+
+int swellproExecuteFlightCommand(SwellproFlight *flight, const SwellproFlightCommand *cmd) {
+    (void)flight;
+    hil_count(HIL_FLIGHT, sizeof(*cmd));
+    return 0;
+}
+
+int swellproExecuteRotorCommand(SwellproFlight *flight, const SwellproRotorCommand *cmd) {
+    (void)flight;
+    hil_count(HIL_ROTOR, sizeof(*cmd));
+    return 0;
+}
+
+int swellproExecuteArmCommand(SwellproWing *wing, const SwellproArmCommand *cmd) {
+    (void)wing;
+    hil_count(HIL_ARM, sizeof(*cmd));
+    return 0;
+}
+
+int swellproExecuteWingCommand(void *controller, const SwellproWingCommand *cmd) {
+    (void)controller;
+    hil_count(HIL_WING, sizeof(*cmd));
+    return 0;
+}
+
+int swellproExecuteBaitCommand(SwellproBait *bait, const SwellproBaitCommand *cmd) {
+    (void)bait;
+    hil_count(HIL_BAIT, sizeof(*cmd));
+    return 0;
+}
+
+int wiringPiSetupGpio(void) {
+    return 0;
+}
+
+void pinMode(int pin, int mode) {
+    (void)pin;
+    (void)mode;
+}
+
+/* The BCM pins raspberry_wing_control_flapper.c reads its ADC channels from */
+int analogRead(int pin) {
+    const hil_sample *s = hil_now();
+    float value;
+    switch (pin) {
+        case 17: value = s->pressure; break;
+        case 27: value = s->accel[0]; break;
+        case 22: value = s->accel[1]; break;
+        case 4: value = s->accel[2]; break;
+        default: value = 0.0f; break;
+    }
+    int counts = (int)(value * 1023.0f + 0.5f);
+    return counts < 0 ? 0 : counts > 1023 ? 1023 : counts;
+}
+
+int hil_i2c_transfer(const pca_message *messages, unsigned count, void *user) {
+    (void)user;
+    for (unsigned i = 0; i < count; i++) {
+        hil_count(HIL_I2C, 1 + (size_t)messages[i].length);    /* address byte, then data */
+    }
+    return 0;
+}
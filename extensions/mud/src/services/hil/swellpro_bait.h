@@ -0,0 +1,20 @@
+/**
+ * HIL mock of the Swellpro bait SDK; see swellpro_flight.h.
+ */
+#ifndef SWELLPRO_BAIT_H
+#define SWELLPRO_BAIT_H
+
+typedef struct SwellproBait SwellproBait;
+
+typedef enum { BAIT_ACTIVATE, BAIT_DEACTIVATE, BAIT_RELEASE } SwellproBaitAction;
+
+typedef struct {
+    int sectionId;
+    SwellproBaitAction action;
+    float amount;
+} SwellproBaitCommand;
+
+SwellproBait *swellproBaitInit(void);
+int swellproExecuteBaitCommand(SwellproBait *bait, const SwellproBaitCommand *cmd);
+
+#endif
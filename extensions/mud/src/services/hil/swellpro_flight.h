@@ -0,0 +1,53 @@
+/**
+ * HIL mock of the Swellpro flight SDK: the types and calls the control loops use, answered
+ * from a recorded flight by hil_mocks.c. Only for the replay bench.
+ */
+#ifndef SWELLPRO_FLIGHT_H
+#define SWELLPRO_FLIGHT_H
+
+#include "swellpro_wing_control.h"
+
+typedef struct SwellproFlight SwellproFlight;
+
+typedef struct {
+    float x, y, z;
+} SwellproVector;
+
+typedef struct {
+    float roll, pitch, yaw;
+} SwellproAttitude;
+
+typedef struct {
+    SwellproVector position;
+    SwellproVector velocity;
+    SwellproAttitude attitude;
+    float altitude;
+    float airspeed;
+} SwellproFlightData;
+
+typedef enum { FLIGHT_GLIDE, FLIGHT_CORRECT_ATTITUDE } SwellproFlightType;
+
+typedef struct {
+    SwellproFlightType type;
+    float speed;
+    float heading;
+    float altitude;
+    float roll;
+    float pitch;
+    float yaw;
+} SwellproFlightCommand;
+
+typedef enum { ROTOR_NORMAL, ROTOR_GLIDE } SwellproRotorMode;
+
+typedef struct {
+    float speed;
+    SwellproRotorMode mode;
+} SwellproRotorCommand;
+
+SwellproFlight *swellproFlightInit(void);
+float swellproGetTime(void);
+void swellproGetFlightData(SwellproFlight *flight, SwellproFlightData *data);
+int swellproExecuteFlightCommand(SwellproFlight *flight, const SwellproFlightCommand *cmd);
+int swellproExecuteRotorCommand(SwellproFlight *flight, const SwellproRotorCommand *cmd);
+
+#endif
@@ -0,0 +1,27 @@
+/**
+ * HIL mock of the Swellpro wing SDK; see swellpro_flight.h.
+ */
+#ifndef SWELLPRO_WING_CONTROL_H
+#define SWELLPRO_WING_CONTROL_H
+
+typedef struct SwellproWing SwellproWing;
+
+typedef struct {
+    float angle;
+    float speed;
+} SwellproArmCommand;
+
+typedef struct {
+    int sectionId;
+    float deployment;
+    float flapAngle;
+    float ventOpen;
+    float pocketDepth;
+} SwellproWingCommand;
+
+SwellproWing *swellproWingInit(void);
+int swellproExecuteArmCommand(SwellproWing *wing, const SwellproArmCommand *cmd);
+/* glide.c sends wing commands to the wing controller, the flapper to the flight controller */
+int swellproExecuteWingCommand(void *controller, const SwellproWingCommand *cmd);
+
+#endif
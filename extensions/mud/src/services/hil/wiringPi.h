@@ -0,0 +1,15 @@
+/**
+ * HIL mock of wiringPi: the GPIO calls raspberry_wing_control_flapper.c makes, with analog
+ * reads answered from a recorded flight; see swellpro_flight.h.
+ */
+#ifndef WIRING_PI_H
+#define WIRING_PI_H
+
+#define INPUT 0
+#define OUTPUT 1
+
+int wiringPiSetupGpio(void);
+void pinMode(int pin, int mode);
+int analogRead(int pin);
+
+#endif
@@ -0,0 +1,189 @@
+/**
+ * pca9685: batched, dirty-tracked PCA9685 servo output over Linux I2C; see pca9685.h for the
+ * API.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "pca9685.h"
+
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <math.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PCA_MODE1 0x00
+#define PCA_MODE2 0x01
+#define PCA_LED0_ON_L 0x06
+#define PCA_ALL_LED_ON_L 0xFA
+#define PCA_PRE_SCALE 0xFE
+
+#define PCA_MODE1_AI 0x20       /* register auto-increment */
+#define PCA_MODE1_SLEEP 0x10    /* oscillator off; the prescaler is only writable asleep */
+#define PCA_MODE2_OUTDRV 0x04   /* totem-pole outputs; outputs change on STOP */
+#define PCA_FULL_OFF 0x10       /* bit 4 of LEDn_OFF_H */
+
+#define PCA_OSCILLATOR_HZ 25e6
+#define PCA_COUNTS 4096
+#define PCA_DEFAULT_HZ 50.0
+#define PCA_OFF 0               /* a channel's count when it is fully off */
+
+struct pca_bank {
+    int fd;
+    pca_transfer_fn transfer;
+    void *user;
+    uint8_t addresses[PCA_MAX_BOARDS];
+    unsigned boards;
+    double frequency_hz;
+    uint16_t staged[PCA_MAX_BOARDS * PCA_OUTPUTS];
+    uint16_t sent[PCA_MAX_BOARDS * PCA_OUTPUTS];
+    pca_stats stats;
+    /* One flush at most: a message per run, a register byte and four per channel */
+    pca_message messages[PCA_MAX_BOARDS * PCA_OUTPUTS / 2];
+    uint8_t buffer[PCA_MAX_BOARDS * PCA_OUTPUTS * 5];
+};
+
+static int send_messages(pca_bank *bank, const pca_message *messages, unsigned count) {
+    if (bank->transfer) return bank->transfer(messages, count, bank->user);
+    struct i2c_msg msgs[PCA_MAX_BOARDS * PCA_OUTPUTS / 2];
+    for (unsigned i = 0; i < count; i++) {
+        msgs[i] = (struct i2c_msg){
+            .addr = messages[i].address,
+            .flags = 0,
+            .len = messages[i].length,
+            .buf = (uint8_t *)messages[i].data
+        };
+    }
+    struct i2c_rdwr_ioctl_data transaction = { .msgs = msgs, .nmsgs = count };
+    return ioctl(bank->fd, I2C_RDWR, &transaction) < 0 ? -1 : 0;
+}
+
+static int write_registers(pca_bank *bank, uint8_t address, const uint8_t *data, uint16_t length) {
+    pca_message message = { address, length, data };
+    return send_messages(bank, &message, 1);
+}
+
+/* Sleep, set the prescaler, switch every output off, then wake with auto-increment on */
+static int configure_board(pca_bank *bank, uint8_t address, uint8_t prescale) {
+    const uint8_t sleep[] = { PCA_MODE1, PCA_MODE1_SLEEP | PCA_MODE1_AI };
+    const uint8_t rate[] = { PCA_PRE_SCALE, prescale };
+    const uint8_t mode2[] = { PCA_MODE2, PCA_MODE2_OUTDRV };
+    const uint8_t off[] = { PCA_ALL_LED_ON_L, 0, 0, 0, PCA_FULL_OFF };
+    const uint8_t wake[] = { PCA_MODE1, PCA_MODE1_AI };
+    if (write_registers(bank, address, sleep, sizeof(sleep)) != 0 ||
+        write_registers(bank, address, rate, sizeof(rate)) != 0 ||
+        write_registers(bank, address, mode2, sizeof(mode2)) != 0 ||
+        write_registers(bank, address, off, sizeof(off)) != 0 ||
+        write_registers(bank, address, wake, sizeof(wake)) != 0) {
+        return -1;
+    }
+    /* The oscillator needs 500 us to settle after waking */
+    nanosleep(&(struct timespec){ 0, 500000 }, NULL);
+    return 0;
+}
+
+pca_bank *pca_open(const pca_config *config) {
+    if (!config || config->boards == 0 || config->boards > PCA_MAX_BOARDS) return NULL;
+    if (!config->transfer && !config->bus) return NULL;
+    double frequency = config->frequency_hz > 0.0 ? config->frequency_hz : PCA_DEFAULT_HZ;
+    double prescale = round(PCA_OSCILLATOR_HZ / (PCA_COUNTS * frequency)) - 1.0;
+    if (prescale < 3.0 || prescale > 255.0) return NULL;
+
+    pca_bank *bank = calloc(1, sizeof(pca_bank));
+    if (!bank) return NULL;
+    bank->fd = -1;
+    bank->transfer = config->transfer;
+    bank->user = config->user;
+    bank->boards = config->boards;
+    bank->frequency_hz = PCA_OSCILLATOR_HZ / (PCA_COUNTS * (prescale + 1.0));
+    if (!bank->transfer) {
+        bank->fd = open(config->bus, O_RDWR);
+        if (bank->fd < 0) {
+            free(bank);
+            return NULL;
+        }
+    }
+    for (unsigned b = 0; b < config->boards; b++) {
+        bank->addresses[b] = config->addresses[b];
+        if (configure_board(bank, config->addresses[b], (uint8_t)prescale) != 0) {
+            if (bank->fd >= 0) close(bank->fd);
+            free(bank);
+            return NULL;
+        }
+    }
+    /* calloc left staged and sent at PCA_OFF, which is what the boards now hold */
+    return bank;
+}
+
+int pca_set_pulse_us(pca_bank *bank, unsigned channel, double pulse_us) {
+    if (!bank || channel >= bank->boards * PCA_OUTPUTS || !(pulse_us >= 0.0)) return PCA_EINVAL;
+    double counts = round(pulse_us * 1e-6 * bank->frequency_hz * PCA_COUNTS);
+    bank->staged[channel] = (uint16_t)(counts > PCA_COUNTS - 1 ? PCA_COUNTS - 1 : counts);
+    return PCA_OK;
+}
+
+int pca_flush(pca_bank *bank) {
+    if (!bank) return PCA_EINVAL;
+    bank->stats.flushes++;
+    unsigned count = 0, channels = 0;
+    uint8_t *out = bank->buffer;
+    for (unsigned b = 0; b < bank->boards; b++) {
+        const uint16_t *staged = &bank->staged[b * PCA_OUTPUTS];
+        const uint16_t *sent = &bank->sent[b * PCA_OUTPUTS];
+        for (unsigned first = 0; first < PCA_OUTPUTS; first++) {
+            if (staged[first] == sent[first]) continue;
+
+            /* A run of dirty outputs: the first one's register, then four bytes each */
+            uint8_t *start = out;
+            *out++ = (uint8_t)(PCA_LED0_ON_L + 4 * first);
+            unsigned last = first;
+            for (; last < PCA_OUTPUTS && staged[last] != sent[last]; last++) {
+                uint16_t counts = staged[last];
+                *out++ = 0;
+                *out++ = 0;
+                *out++ = (uint8_t)(counts & 0xFF);
+                *out++ = (uint8_t)(counts == PCA_OFF ? PCA_FULL_OFF : counts >> 8);
+            }
+            bank->messages[count++] = (pca_message){
+                bank->addresses[b], (uint16_t)(out - start), start
+            };
+            channels += last - first;
+            first = last;
+        }
+    }
+    if (count == 0) return PCA_OK;
+
+    if (send_messages(bank, bank->messages, count) != 0) {
+        bank->stats.errors++;
+        return PCA_EIO;
+    }
+    for (unsigned i = 0; i < bank->boards * PCA_OUTPUTS; i++) bank->sent[i] = bank->staged[i];
+    bank->stats.transactions++;
+    bank->stats.channels += channels;
+    bank->stats.bytes += (uint64_t)(out - bank->buffer);
+    return PCA_OK;
+}
+
+unsigned pca_channels(const pca_bank *bank) {
+    return bank ? bank->boards * PCA_OUTPUTS : 0;
+}
+
+double pca_frequency(const pca_bank *bank) {
+    return bank ? bank->frequency_hz : 0.0;
+}
+
+void pca_stats_get(const pca_bank *bank, pca_stats *stats) {
+    if (bank && stats) *stats = bank->stats;
+}
+
+void pca_close(pca_bank *bank) {
+    if (!bank) return;
+    const uint8_t off[] = { PCA_ALL_LED_ON_L, 0, 0, 0, PCA_FULL_OFF };
+    for (unsigned b = 0; b < bank->boards; b++) {
+        write_registers(bank, bank->addresses[b], off, sizeof(off));
+    }
+    if (bank->fd >= 0) close(bank->fd);
+    free(bank);
+}
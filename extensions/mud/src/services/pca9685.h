@@ -0,0 +1,93 @@
+/**
+ * pca9685: drive servos from PCA9685 PWM boards on one I2C bus, a batched write per frame.
+ *
+ *   pca_bank *servos = pca_open(&(pca_config){ .bus = "/dev/i2c-1",
+ *                                              .addresses = { 0x40, 0x41 }, .boards = 2 });
+ *   pca_set_pulse_us(servos, 17, 1500.0);       stage channel 17 (board 1, output 1)
+ *   ...
+ *   pca_flush(servos);                          once per tick: one I2C transaction
+ *   pca_close(servos);
+ *
+ * Channel n is output n % 16 of board n / 16. pca_set_pulse_us only stages a value; a channel
+ * whose pulse rounds to the count it already has stays clean. pca_flush sends every dirty
+ * channel in a single I2C_RDWR transaction: one message per run of consecutive dirty
+ * channels, using the chip's register auto-increment, since restarting costs less than
+ * rewriting a clean channel's four bytes. The boards latch new values on the transaction's
+ * one STOP, so every servo in a frame moves at the same instant. A frame with nothing dirty
+ * costs no bus traffic at all.
+ *
+ * The Pi's own hardware PWM has two channels, too few for a wing; a PCA9685 board has 16
+ * outputs with 12-bit resolution, generated in hardware with no CPU and no jitter.
+ *
+ * `transfer` replaces the bus, for benches and tests: it receives each transaction's
+ * messages instead of the kernel. A bank belongs to one thread.
+ */
+#ifndef PCA9685_H
+#define PCA9685_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PCA_OK 0
+#define PCA_EINVAL -1
+#define PCA_EIO -2              /* the bus refused the transaction; channels stay dirty */
+
+#define PCA_OUTPUTS 16          /* per board */
+#define PCA_MAX_BOARDS 4
+
+typedef struct {
+    uint16_t address;           /* 7-bit I2C address */
+    uint16_t length;
+    const uint8_t *data;        /* first byte is the register */
+} pca_message;
+
+/* Send `count` messages as one transaction; 0 on success. */
+typedef int (*pca_transfer_fn)(const pca_message *messages, unsigned count, void *user);
+
+typedef struct {
+    const char *bus;            /* e.g. "/dev/i2c-1"; unused with `transfer` */
+    uint8_t addresses[PCA_MAX_BOARDS];
+    unsigned boards;
+    double frequency_hz;        /* PWM frequency; 0 for 50, the servo standard */
+    pca_transfer_fn transfer;   /* NULL for the bus */
+    void *user;
+} pca_config;
+
+typedef struct {
+    uint64_t flushes;
+    uint64_t transactions;      /* flushes that had something to send */
+    uint64_t channels;          /* channel writes sent */
+    uint64_t bytes;             /* register and data bytes, addresses excluded */
+    uint64_t errors;
+} pca_stats;
+
+typedef struct pca_bank pca_bank;
+
+/* Open the bus, set every board's PWM frequency and switch its outputs off. NULL on a bad
+ * config or if the bus or a board does not answer. */
+pca_bank *pca_open(const pca_config *config);
+
+/* Stage a pulse width for one channel; 0 switches it fully off. PCA_OK or PCA_EINVAL. */
+int pca_set_pulse_us(pca_bank *bank, unsigned channel, double pulse_us);
+
+/* Send every dirty channel in one transaction. PCA_OK or PCA_EIO. */
+int pca_flush(pca_bank *bank);
+
+unsigned pca_channels(const pca_bank *bank);
+
+/* The PWM frequency the prescaler actually gives, which pulse widths are converted with. */
+double pca_frequency(const pca_bank *bank);
+
+void pca_stats_get(const pca_bank *bank, pca_stats *stats);
+
+/* Switch every output off and close the bus. NULL does nothing. */
+void pca_close(pca_bank *bank);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
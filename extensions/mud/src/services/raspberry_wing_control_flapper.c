@@ -2,25 +2,49 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <wiringPi.h>
-#include <softPwm.h>
 #include <math.h>
-
-// GPIO Pin Definitions
-#define FLAP_SERVO_BASE 18  // PWM pin for flap servos
-#define VENT_SERVO_BASE 23  // PWM pin for vent servos
-#define POCKET_SERVO_BASE 24 // PWM pin for pocket servos
+#include "adc_sampler.h"
+#include "pca9685.h"
+#include "rt_loop.h"
+
+// Servo channels on the PCA9685 boards, NUM_SECTIONS consecutive outputs per function
+#define FLAP_SERVO_BASE 0   // Board 0, outputs 0-7
+#define VENT_SERVO_BASE 8   // Board 0, outputs 8-15
+#define POCKET_SERVO_BASE 16 // Board 1, outputs 0-7
 #define NUM_SECTIONS 8
 
 // Servo Configuration
 #define SERVO_MIN_PULSE 500
 #define SERVO_MAX_PULSE 2500
 #define SERVO_FREQ 50
+#define SERVO_I2C_BUS "/dev/i2c-1"
+#define SERVO_BOARD_0 0x40
+#define SERVO_BOARD_1 0x41
 
 // Sensor Pins
 #define PRESSURE_SENSOR 17
 #define ACCELEROMETER_X 27
 #define ACCELEROMETER_Y 22
 #define ACCELEROMETER_Z 4
+#define NUM_SENSORS 4
+#define SENSOR_SAMPLE_HZ 1000.0   // Averaged down to one reading per control tick
+
+// Control loop timing
+#define CONTROL_LOOP_HZ 50.0
+#define CONTROL_LOOP_PRIORITY 0   // SCHED_FIFO priority (1-99); 0 keeps the default policy
+#define CONTROL_LOOP_CPUS 0       // CPU mask to pin the loop to; 0 leaves it unpinned
+
+// Stand-ins the HIL bench builds with: rt_clocks for the loop and the sampler, and a
+// pca_transfer_fn in place of the I2C bus
+#ifndef CONTROL_LOOP_CLOCK
+#define CONTROL_LOOP_CLOCK NULL
+#endif
+#ifndef SENSOR_SAMPLE_CLOCK
+#define SENSOR_SAMPLE_CLOCK NULL
+#endif
+#ifndef SERVO_TRANSFER
+#define SERVO_TRANSFER NULL
+#endif
 
 typedef struct {
     float position[3];
@@ -38,11 +62,26 @@ typedef struct {
     int targetAngle;
     float springForce;
     float dampingForce;
+    float ventOpen;
+    float pocketDepth;
 } WingSection;
 
 // Global state
 WingState wingState;
 WingSection sections[NUM_SECTIONS];
+pca_bank* servos;
+as_sampler* sensors;
+float sensorReadings[NUM_SENSORS];  // Pressure, then accelerometer X, Y and Z
+
+// Sample every sensor once; runs on the sampler's thread
+static int sampleSensors(float* values, unsigned channels, void* user) {
+    static const int pins[NUM_SENSORS] = {
+        PRESSURE_SENSOR, ACCELEROMETER_X, ACCELEROMETER_Y, ACCELEROMETER_Z
+    };
+    (void)user;
+    for (unsigned i = 0; i < channels; i++) values[i] = analogRead(pins[i]) / 1023.0;
+    return 0;
+}
 
 // Initialize GPIO and PWM
 void initializeGPIO() {
@@ -51,11 +90,17 @@ void initializeGPIO() {
         exit(1);
     }
 
-    // Initialize PWM for all servos
-    for (int i = 0; i < NUM_SECTIONS; i++) {
-        softPwmCreate(FLAP_SERVO_BASE + i, 0, 100);
-        softPwmCreate(VENT_SERVO_BASE + i, 0, 100);
-        softPwmCreate(POCKET_SERVO_BASE + i, 0, 100);
+    // Initialize PWM for all servos: 3 * NUM_SECTIONS outputs across two PCA9685 boards
+    servos = pca_open(&(pca_config){
+        .bus = SERVO_I2C_BUS,
+        .addresses = { SERVO_BOARD_0, SERVO_BOARD_1 },
+        .boards = 2,
+        .frequency_hz = SERVO_FREQ,
+        .transfer = SERVO_TRANSFER
+    });
+    if (!servos) {
+        printf("Failed to initialize the PCA9685 servo boards\n");
+        exit(1);
     }
 
     // Initialize sensor pins
@@ -63,6 +108,18 @@ void initializeGPIO() {
     pinMode(ACCELEROMETER_X, INPUT);
     pinMode(ACCELEROMETER_Y, INPUT);
     pinMode(ACCELEROMETER_Z, INPUT);
+
+    // Sample the sensors off the control loop
+    sensors = as_start(&(as_config){
+        .channels = NUM_SENSORS,
+        .rate_hz = SENSOR_SAMPLE_HZ,
+        .clock = SENSOR_SAMPLE_CLOCK,
+        .read = sampleSensors
+    });
+    if (!sensors) {
+        printf("Failed to start the sensor sampler\n");
+        exit(1);
+    }
 }
 
 // Convert angle to PWM value
@@ -70,22 +127,20 @@ int angleToPWM(float angle) {
     return (int)((angle + 90) * (SERVO_MAX_PULSE - SERVO_MIN_PULSE) / 180 + SERVO_MIN_PULSE);
 }
 
-// Update servo position
-void updateServo(int pin, float angle) {
+// Stage a servo position; pca_flush sends the tick's changes together
+void updateServo(int channel, float angle) {
     int pwm = angleToPWM(angle);
-    softPwmWrite(pin, pwm);
+    pca_set_pulse_us(servos, channel, pwm);
 }
 
-// Read pressure sensor
-float readPressure() {
-    return analogRead(PRESSURE_SENSOR) / 1023.0;
-}
-
-// Read accelerometer
-void readAccelerometer(float* x, float* y, float* z) {
-    *x = analogRead(ACCELEROMETER_X) / 1023.0;
-    *y = analogRead(ACCELEROMETER_Y) / 1023.0;
-    *z = analogRead(ACCELEROMETER_Z) / 1023.0;
+// Take the sensor readings sampled since the last tick, averaged; the previous ones if the
+// sampler has nothing new
+void readSensors(float* pressure, float accel[3]) {
+    as_drain(sensors, sensorReadings);
+    *pressure = sensorReadings[0];
+    accel[0] = sensorReadings[1];
+    accel[1] = sensorReadings[2];
+    accel[2] = sensorReadings[3];
 }
 
 // Calculate required forces
@@ -116,15 +171,27 @@ void updateSection(WingSection* section, int index) {
     section->currentAngle = fmaxf(-45, fminf(60, section->currentAngle));
 }
 
-// Main control loop
+// Main control loop, paced by absolute deadlines rather than a delay after the work
 void controlLoop() {
+    rt_loop loop;
+    int status = rt_loop_init(&loop, &(rt_config){
+        .rate_hz = CONTROL_LOOP_HZ,
+        .priority = CONTROL_LOOP_PRIORITY,
+        .cpus = CONTROL_LOOP_CPUS,
+        .clock = CONTROL_LOOP_CLOCK
+    });
+    if (status == RT_EINVAL) {
+        printf("Invalid control loop timing\n");
+        exit(1);
+    }
+    if (status != RT_OK) printf("Control loop running without realtime scheduling\n");
+
     float pressure;
     float accel[3];
 
     while (1) {
         // Read sensors
-        pressure = readPressure();
-        readAccelerometer(&accel[0], &accel[1], &accel[2]);
+        readSensors(&pressure, accel);
 
         // Update each section
         for (int i = 0; i < NUM_SECTIONS; i++) {
@@ -132,9 +199,16 @@ void controlLoop() {
             updateSection(&sections[i], i);
         }
 
-        // Small delay for stability
-        delay(20);
+        // Send every servo that changed in one I2C transaction
+        pca_flush(servos);
+
+        // Wait for the next tick
+        if (!rt_loop_wait(&loop)) break;
     }
+
+    // Park the servos and stop sampling
+    as_stop(sensors);
+    pca_close(servos);
 }
 
 int main() {
@@ -148,6 +222,8 @@ int main() {
         sections[i].targetAngle = 0;
         sections[i].springForce = 0;
         sections[i].dampingForce = 0;
+        sections[i].ventOpen = 0;
+        sections[i].pocketDepth = 0;
     }
 
     // Start control loop
@@ -0,0 +1,123 @@
+/**
+ * rt_loop: absolute-deadline pacing for control loops; see rt_loop.h for the API.
+ */
+#define _GNU_SOURCE
+#include "rt_loop.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+
+uint64_t rt_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t monotonic_now(void *ctx) {
+    (void)ctx;
+    return rt_now_ns();
+}
+
+static int monotonic_sleep_until(uint64_t ns, void *ctx) {
+    (void)ctx;
+    struct timespec ts = { (time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull) };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+    return 0;
+}
+
+static const rt_clock monotonic = { monotonic_now, monotonic_sleep_until, NULL };
+
+static int make_realtime(int priority) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) return RT_EPRIORITY;
+    struct sched_param param = { .sched_priority = priority };
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) return RT_EPRIORITY;
+    return RT_OK;
+}
+
+static int pin(uint64_t cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; cpu++) {
+        if (cpus & (1ull << cpu)) CPU_SET(cpu, &set);
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) return RT_EAFFINITY;
+    return RT_OK;
+}
+
+int rt_loop_init(rt_loop *loop, const rt_config *config) {
+    if (!loop || !config || !(config->rate_hz > 0.0) || config->rate_hz > 1e9) return RT_EINVAL;
+    if (config->priority < 0 || config->priority > 99) return RT_EINVAL;
+
+    int status = RT_OK;
+    if (config->priority) status = make_realtime(config->priority);
+    if (config->cpus) {
+        int pinned = pin(config->cpus);
+        if (status == RT_OK) status = pinned;
+    }
+
+    loop->clock = config->clock ? config->clock : &monotonic;
+    loop->ended = 0;
+    loop->period_ns = (uint64_t)(1e9 / config->rate_hz + 0.5);
+    if (loop->period_ns == 0) loop->period_ns = 1;
+    loop->release_ns = loop->clock->now_ns(loop->clock->ctx);
+    loop->woke_ns = loop->release_ns;
+    loop->ticks = 0;
+    loop->overruns = 0;
+    loop->skipped = 0;
+    loop->max_late_ns = 0;
+    loop->max_work_ns = 0;
+    loop->work_ns = 0;
+    return status;
+}
+
+unsigned rt_loop_wait(rt_loop *loop) {
+    const rt_clock *clock = loop->clock;
+    if (loop->ended) return 0;
+    uint64_t end = clock->now_ns(clock->ctx);
+    uint64_t work = end - loop->woke_ns;
+    loop->ticks++;
+    loop->work_ns += work;
+    if (work > loop->max_work_ns) loop->max_work_ns = work;
+
+    /* On time, sleep to the next release. Late, take the newest release at or before `end`
+     * instead; the ones before it count as periods too, so a caller stepping by elapsed time
+     * keeps up with the clock. sleep_until is called even for a release already past, which
+     * lets a clock end the loop at any tick. */
+    uint64_t periods = 1;
+    uint64_t release = loop->release_ns + loop->period_ns;
+    if (end > release) {
+        uint64_t behind = (end - release) / loop->period_ns;
+        loop->overruns++;
+        loop->skipped += behind;
+        periods += behind;
+        release += behind * loop->period_ns;
+    }
+    if (clock->sleep_until(release, clock->ctx) != 0) {
+        loop->ended = 1;
+        return 0;
+    }
+    loop->release_ns = release;
+
+    loop->woke_ns = clock->now_ns(clock->ctx);
+    uint64_t late = loop->woke_ns > release ? loop->woke_ns - release : 0;
+    if (late > loop->max_late_ns) loop->max_late_ns = late;
+    return periods > UINT32_MAX ? UINT32_MAX : (unsigned)periods;
+}
+
+double rt_loop_period(const rt_loop *loop) {
+    return loop->period_ns * 1e-9;
+}
+
+void rt_loop_stats(const rt_loop *loop, rt_stats *stats) {
+    if (!loop || !stats) return;
+    stats->ticks = loop->ticks;
+    stats->overruns = loop->overruns;
+    stats->skipped = loop->skipped;
+    stats->max_late_s = loop->max_late_ns * 1e-9;
+    stats->max_work_s = loop->max_work_ns * 1e-9;
+    stats->mean_work_s = loop->ticks ? loop->work_ns * 1e-9 / (double)loop->ticks : 0.0;
+}
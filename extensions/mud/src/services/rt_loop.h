@@ -0,0 +1,104 @@
+/**
+ * rt_loop: pace a control loop at a fixed rate against absolute deadlines.
+ *
+ *   rt_loop loop;
+ *   rt_loop_init(&loop, &(rt_config){ .rate_hz = 50, .priority = 80, .cpus = 1u << 3 });
+ *   for (;;) {
+ *       ... read sensors, command servos ...
+ *       unsigned periods = rt_loop_wait(&loop);    1 on time; more if releases were skipped;
+ *       if (!periods) break;                       0 once the clock has ended the loop
+ *   }
+ *   rt_stats st;
+ *   rt_loop_stats(&loop, &st);                         overruns, lateness, work time
+ *
+ * Release n is at start + n / rate_hz on CLOCK_MONOTONIC, and rt_loop_wait sleeps until the
+ * next one with clock_nanosleep(TIMER_ABSTIME), so neither the work done nor the time spent
+ * asleep shifts the rate: `delay(20)` after 5 ms of work runs at 40 Hz, this runs at 50.
+ * If the work runs past the next release (an overrun), rt_loop_wait does not sleep. It
+ * resumes on the most recent release that has already passed; any earlier ones are counted
+ * as skipped. The return value is the number of periods since the previous wait, skipped ones
+ * included, so a state machine can advance by the time that actually went by.
+ *
+ * rt_loop_init applies the realtime settings to the calling thread: SCHED_FIFO at
+ * `priority`, with memory locked so a page fault cannot stall a tick, and pinning to the
+ * `cpus` mask. Both need privileges (CAP_SYS_NICE) that a desktop run may lack; the loop then
+ * still keeps its rate on the default policy and rt_loop_init says what was refused.
+ *
+ * `clock` replaces CLOCK_MONOTONIC, for benches that replay a flight faster than real time:
+ * the loop reads the time and sleeps through it, and a clock that returns nonzero from
+ * sleep_until ends the loop. The defaults never do.
+ *
+ * A loop belongs to the thread that runs it; rt_loop_stats is for that thread too.
+ */
+#ifndef RT_LOOP_H
+#define RT_LOOP_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RT_OK 0
+#define RT_EINVAL -1            /* bad rate or priority; the loop is unusable */
+#define RT_EPRIORITY -2         /* SCHED_FIFO or the memory lock was refused; the loop runs */
+#define RT_EAFFINITY -3         /* pinning was refused; the loop runs */
+
+typedef struct {
+    uint64_t (*now_ns)(void *ctx);
+    int (*sleep_until)(uint64_t ns, void *ctx);     /* nonzero ends the loop */
+    void *ctx;
+} rt_clock;
+
+typedef struct {
+    double rate_hz;             /* releases per second */
+    int priority;               /* SCHED_FIFO priority, 1 to 99; 0 keeps the current policy */
+    uint64_t cpus;              /* CPUs the thread may run on, bit n for CPU n; 0 to not pin */
+    const rt_clock *clock;      /* NULL for CLOCK_MONOTONIC */
+} rt_config;
+
+typedef struct {
+    uint64_t ticks;             /* calls to rt_loop_wait */
+    uint64_t overruns;          /* work that ended past the next release */
+    uint64_t skipped;           /* releases dropped to get back in phase */
+    double max_late_s;          /* worst wake-up after a release */
+    double max_work_s;          /* worst time between waking and the next rt_loop_wait */
+    double mean_work_s;
+} rt_stats;
+
+typedef struct {
+    const rt_clock *clock;
+    int ended;
+    uint64_t period_ns;
+    uint64_t release_ns;        /* the release the current tick belongs to */
+    uint64_t woke_ns;           /* when the current tick started */
+    uint64_t ticks;
+    uint64_t overruns;
+    uint64_t skipped;
+    uint64_t max_late_ns;
+    uint64_t max_work_ns;
+    uint64_t work_ns;
+} rt_loop;
+
+/* Start the loop now: the first tick is release 0, the next release one period away.
+ * RT_OK, RT_EINVAL, RT_EPRIORITY or RT_EAFFINITY (the first setting refused). */
+int rt_loop_init(rt_loop *loop, const rt_config *config);
+
+/* End the current tick and sleep until the next release; returns the number of periods
+ * since the previous release, 1 unless releases were skipped, or 0 once the clock has ended
+ * the loop. */
+unsigned rt_loop_wait(rt_loop *loop);
+
+/* Seconds per period. */
+double rt_loop_period(const rt_loop *loop);
+
+void rt_loop_stats(const rt_loop *loop, rt_stats *stats);
+
+/* CLOCK_MONOTONIC in nanoseconds, the clock releases use by default. */
+uint64_t rt_now_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,6 +4,8 @@
 #include <math.h>
 #include "swellpro_flight.h"
 #include "swellpro_bait.h"
+#include "rt_loop.h"
+#include "wing_frame.h"
 
 // Wing Configuration
 #define NUM_SECTIONS 8
@@ -16,6 +18,16 @@
 #define MAX_BANK_ANGLE 30.0
 #define MIN_AIRSPEED 5.0
 
+// Control loop timing
+#define CONTROL_LOOP_HZ 50.0
+#define CONTROL_LOOP_PRIORITY 0   // SCHED_FIFO priority (1-99); 0 keeps the default policy
+#define CONTROL_LOOP_CPUS 0       // CPU mask to pin the loop to; 0 leaves it unpinned
+
+// Stand-in the HIL bench builds with: an rt_clock for the loop
+#ifndef CONTROL_LOOP_CLOCK
+#define CONTROL_LOOP_CLOCK NULL
+#endif
+
 typedef struct {
     float position[3];
     float velocity[3];
@@ -41,6 +53,7 @@ FlightState flightState;
 WingSection sections[NUM_SECTIONS];
 SwellproFlight* flightController;
 SwellproBait* baitController;
+wf_frame wingFrame;
 
 // Initialize Swellpro controllers
 void initializeControllers() {
@@ -163,8 +176,36 @@ void updateFlightMode() {
     }
 }
 
-// Main control loop
+// Send one wing frame's changed sections to the flight controller
+static int sendWingSections(const wf_change* changes, unsigned count, void* user) {
+    (void)user;
+    for (unsigned c = 0; c < count; c++) {
+        SwellproWingCommand cmd = {
+            .sectionId = changes[c].index,
+            .flapAngle = changes[c].value.flap_angle,
+            .ventOpen = changes[c].value.vent_open,
+            .pocketDepth = changes[c].value.pocket_depth
+        };
+        if (swellproExecuteWingCommand(flightController, &cmd) != 0) return -1;
+    }
+    return 0;
+}
+
+// Main control loop, paced by absolute deadlines rather than a delay after the work
 void controlLoop() {
+    rt_loop loop;
+    int status = rt_loop_init(&loop, &(rt_config){
+        .rate_hz = CONTROL_LOOP_HZ,
+        .priority = CONTROL_LOOP_PRIORITY,
+        .cpus = CONTROL_LOOP_CPUS,
+        .clock = CONTROL_LOOP_CLOCK
+    });
+    if (status == RT_EINVAL) {
+        printf("Invalid control loop timing\n");
+        exit(1);
+    }
+    if (status != RT_OK) printf("Control loop running without realtime scheduling\n");
+
     while (1) {
         // Update flight state
         updateFlightState();
@@ -180,19 +221,18 @@ void controlLoop() {
             executeBaitDrop();
         }
 
-        // Apply wing configuration to flight controller
+        // Apply wing configuration to flight controller: only the sections that changed
         for (int i = 0; i < NUM_SECTIONS; i++) {
-            SwellproWingCommand cmd = {
-                .sectionId = i,
-                .flapAngle = sections[i].flapAngle,
-                .ventOpen = sections[i].ventOpen,
-                .pocketDepth = sections[i].pocketDepth
-            };
-            swellproExecuteWingCommand(flightController, &cmd);
+            wf_set(&wingFrame, i, &(wf_section){
+                .flap_angle = sections[i].flapAngle,
+                .vent_open = sections[i].ventOpen,
+                .pocket_depth = sections[i].pocketDepth
+            });
         }
+        wf_flush(&wingFrame, sendWingSections, NULL);
 
-        // Small delay for stability
-        delay(20);
+        // Wait for the next tick
+        if (!rt_loop_wait(&loop)) break;
     }
 }
 
@@ -210,6 +250,7 @@ int main() {
         sections[i].baitLoad = sections[i].hasBaitDrop ? 1.0 : 0.0;
         sections[i].baitReleased = false;
     }
+    wf_init(&wingFrame, NUM_SECTIONS, 0.0f);
 
     // Start control loop
     controlLoop();
@@ -0,0 +1,58 @@
+/**
+ * wing_frame: dirty-tracked multi-section wing commands; see wing_frame.h for the API.
+ */
+#include "wing_frame.h"
+
+#include <math.h>
+#include <string.h>
+
+int wf_init(wf_frame *frame, unsigned sections, float tolerance) {
+    if (!frame || sections == 0 || sections > WF_MAX_SECTIONS || !(tolerance >= 0.0f)) {
+        return WF_EINVAL;
+    }
+    memset(frame, 0, sizeof(*frame));
+    frame->sections = sections;
+    frame->tolerance = tolerance;
+    return 0;
+}
+
+int wf_set(wf_frame *frame, unsigned index, const wf_section *section) {
+    if (!frame || !section || index >= frame->sections) return WF_EINVAL;
+    frame->staged[index] = *section;
+    return 0;
+}
+
+static int moved(float staged, float sent, float tolerance) {
+    return fabsf(staged - sent) > tolerance;
+}
+
+static int changed(const wf_frame *frame, unsigned i) {
+    if (!(frame->known & (1u << i))) return 1;
+    const wf_section *a = &frame->staged[i], *b = &frame->sent[i];
+    float t = frame->tolerance;
+    return moved(a->deployment, b->deployment, t) || moved(a->flap_angle, b->flap_angle, t) ||
+           moved(a->vent_open, b->vent_open, t) || moved(a->pocket_depth, b->pocket_depth, t);
+}
+
+int wf_flush(wf_frame *frame, wf_send_fn send, void *user) {
+    if (!frame || !send) return WF_EINVAL;
+    frame->stats.frames++;
+    wf_change changes[WF_MAX_SECTIONS];
+    unsigned count = 0;
+    for (unsigned i = 0; i < frame->sections; i++) {
+        if (!changed(frame, i)) continue;
+        changes[count].index = i;
+        changes[count].value = frame->staged[i];
+        count++;
+    }
+    if (count == 0) return 0;
+
+    if (send(changes, count, user) != 0) return WF_ESEND;
+    for (unsigned c = 0; c < count; c++) {
+        frame->sent[changes[c].index] = changes[c].value;
+        frame->known |= 1u << changes[c].index;
+    }
+    frame->stats.sends++;
+    frame->stats.changes += count;
+    return (int)count;
+}
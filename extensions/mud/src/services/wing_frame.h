@@ -0,0 +1,72 @@
+/**
+ * wing_frame: stage a whole wing's section commands each tick and send only what changed.
+ *
+ *   wf_frame frame;
+ *   wf_init(&frame, NUM_SECTIONS, 0.0f);                 0: any change is sent
+ *   for (...) wf_set(&frame, i, &(wf_section){ .flap_angle = 20.0f, ... });
+ *   int sent = wf_flush(&frame, send_sections, ctx);     one call with the changed sections
+ *
+ * A section is changed when any field differs from what was last sent for it by more than
+ * `tolerance`, so a slow drift is still sent once it adds up. The first flush sends every
+ * section. wf_flush hands all the changed sections of a frame to `send` in one call, in
+ * section order, and a frame where nothing changed does not call it at all. If `send` fails,
+ * nothing is marked as sent and the next flush tries again.
+ */
+#ifndef WING_FRAME_H
+#define WING_FRAME_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WF_EINVAL -1
+#define WF_ESEND -2             /* `send` failed; the changes stay pending */
+
+#define WF_MAX_SECTIONS 32
+
+typedef struct {
+    float deployment;
+    float flap_angle;
+    float vent_open;
+    float pocket_depth;
+} wf_section;
+
+typedef struct {
+    unsigned index;
+    wf_section value;
+} wf_change;
+
+/* Deliver one frame's changes; 0 on success. */
+typedef int (*wf_send_fn)(const wf_change *changes, unsigned count, void *user);
+
+typedef struct {
+    uint64_t frames;            /* flushes */
+    uint64_t sends;             /* flushes that called send */
+    uint64_t changes;           /* sections sent */
+} wf_stats;
+
+typedef struct {
+    unsigned sections;
+    float tolerance;
+    uint32_t known;             /* bit n: section n has been sent at least once */
+    wf_section staged[WF_MAX_SECTIONS];
+    wf_section sent[WF_MAX_SECTIONS];
+    wf_stats stats;
+} wf_frame;
+
+/* Up to WF_MAX_SECTIONS sections, every field staged at 0. 0 or WF_EINVAL. */
+int wf_init(wf_frame *frame, unsigned sections, float tolerance);
+
+/* Stage section `index` for the next flush. 0 or WF_EINVAL. */
+int wf_set(wf_frame *frame, unsigned index, const wf_section *section);
+
+/* Send the changed sections; returns how many there were, or WF_ESEND. */
+int wf_flush(wf_frame *frame, wf_send_fn send, void *user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,318 @@
+// Dispatch micro-benchmarks for vtable.h. Build and run: make bench   (or ./dispatch_bench [--quick])
+//
+// Every variant applies the same stabilization step (the body of StabilityZone's
+// applyStabilization, without the printf) to N zones, and reports the median time per zone
+// as one JSON object per line:
+//   {"bench":"dispatch","variant":"call","n":1000,"cache":"warm","reps":..,"nsPerObject":..}
+//
+// Variants:
+//   direct        a plain (not inlined) function call per zone over an array of ZoneData
+//   switch        a switch on a per-zone kind, then the body inline
+//   static        CALL_STATIC per object: Object -> thisData, then the body inline
+//   call          CALL per object: Object -> vtable -> methods[] -> variadic indirect call
+//   switch-mixed  switch, with the zones split at random between two kinds
+//   call-mixed    CALL, with the objects split at random between two classes
+//   batch         one CALL_BATCH over a ZoneBatch (struct-of-arrays, vectorized loop)
+//
+// Sizes run from 1e3 to 1e7 zones (1e6 with --quick). "warm" repeats over the same data;
+// "cold" streams through a buffer larger than the last-level cache before every rep, so the
+// data and vtables come from memory. A size is repeated until MIN_SECONDS have elapsed.
+//
+// Built with -DVTABLE_PROFILE (make dispatch_bench_profile), every line says "profile":true
+// and the run ends with vprof_report()'s per-site lines, so the two builds together show what
+// profiling costs per call.
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vtable.h"
+#include "vtable_batch.h"
+
+#define MIN_SECONDS 0.2
+#define MAX_REPS 1001
+#define FLUSH_BYTES (64u << 20)
+#define TARGET_STABILITY 95.0
+
+#ifdef VTABLE_PROFILE
+#define PROFILED "true"
+#else
+#define PROFILED "false"
+#endif
+
+// Define method indices
+#define applyStabilization_INDEX 0
+
+// Define data structures; the numeric part of stability_zone.c's ZoneData
+typedef struct {
+    char* name;
+    float env[5];
+    float stabilityScore;
+    bool isActive;
+} ZoneData;
+
+static inline void stabilize(ZoneData* z, double target) {
+    if (z->isActive) z->stabilityScore += ((float)target - z->stabilityScore) * 0.1f;
+}
+
+static inline void stabilize_quantum(ZoneData* z, double target) {
+    if (z->isActive) z->stabilityScore += ((float)target - z->stabilityScore) * 0.2f;
+}
+
+__attribute__((noinline)) static void stabilize_direct(ZoneData* z, double target) {
+    stabilize(z, target);
+}
+
+// Define classes
+DEFINE_CLASS(Zone, Object, ZoneData);
+
+DEFINE_METHOD(Zone, applyStabilization, void, double target) {
+    (void)self;
+    stabilize((ZoneData*)thisData, target);
+}
+
+DEFINE_CLASS(QuantumZone, Zone, ZoneData);
+
+DEFINE_METHOD(QuantumZone, applyStabilization, void, double target) {
+    (void)self;
+    stabilize_quantum((ZoneData*)thisData, target);
+}
+
+#define Zone_METHODS \
+    ADD_METHOD(Zone, applyStabilization)
+
+INIT_CLASS(Zone, Object, Zone_METHODS);
+
+INIT_CLASS(QuantumZone, Zone,
+    ADD_METHOD(QuantumZone, applyStabilization)
+);
+
+// isActive is batched as a 0/1 float so the step below needs no branch or bool conversion
+#define ZONE_FIELDS(X) \
+    X(float, stabilityScore, stabilityScore) \
+    X(float, isActive, isActive)
+
+DEFINE_BATCH_CLASS(ZoneBatch, ZoneData, ZONE_FIELDS);
+
+DEFINE_BATCH_METHOD(ZoneBatch, applyStabilization, void, double target) {
+    (void)self;
+    float* restrict score = batch->stabilityScore;
+    const float* restrict active = batch->isActive;
+    const float t = (float)target;
+    BATCH_FOR(batch, i) score[i] += (t - score[i]) * 0.1f * active[i];
+}
+
+INIT_CLASS(ZoneBatch, Object,
+    ADD_METHOD(ZoneBatch, applyStabilization)
+);
+
+// Everything one size runs over
+typedef struct {
+    size_t n;
+    ZoneData* zones;
+    unsigned char* kinds;       // 0 for every zone
+    unsigned char* mixedKinds;  // 0 or 1 at random
+    Object** objects;           // Zone objects over zones[]
+    Object** mixedObjects;      // Zone or QuantumZone at random, over the same zones[]
+    ZoneBatch* batch;
+} Workload;
+
+typedef void (*VariantFn)(Workload* w);
+
+static void run_direct(Workload* w) {
+    for (size_t i = 0; i < w->n; i++) stabilize_direct(&w->zones[i], TARGET_STABILITY);
+}
+
+static void run_switch_over(Workload* w, const unsigned char* kinds) {
+    for (size_t i = 0; i < w->n; i++) {
+        switch (kinds[i]) {
+        case 0:
+            stabilize(&w->zones[i], TARGET_STABILITY);
+            break;
+        case 1:
+            stabilize_quantum(&w->zones[i], TARGET_STABILITY);
+            break;
+        }
+    }
+}
+
+static void run_switch(Workload* w) {
+    run_switch_over(w, w->kinds);
+}
+
+static void run_switch_mixed(Workload* w) {
+    run_switch_over(w, w->mixedKinds);
+}
+
+static void run_static(Workload* w) {
+    for (size_t i = 0; i < w->n; i++) CALL_STATIC(Zone, w->objects[i], applyStabilization, TARGET_STABILITY);
+}
+
+static void run_call(Workload* w) {
+    for (size_t i = 0; i < w->n; i++) CALL(w->objects[i], applyStabilization, TARGET_STABILITY);
+}
+
+static void run_call_mixed(Workload* w) {
+    for (size_t i = 0; i < w->n; i++) CALL(w->mixedObjects[i], applyStabilization, TARGET_STABILITY);
+}
+
+static void run_batch(Workload* w) {
+    CALL_BATCH(w->batch, applyStabilization, TARGET_STABILITY);
+}
+
+typedef struct {
+    const char* name;
+    VariantFn run;
+} Variant;
+
+static const Variant VARIANTS[] = {
+    { "direct", run_direct },
+    { "switch", run_switch },
+    { "static", run_static },
+    { "call", run_call },
+    { "switch-mixed", run_switch_mixed },
+    { "call-mixed", run_call_mixed },
+    { "batch", run_batch },
+};
+
+static const size_t SIZES[] = { 1000, 10000, 100000, 1000000, 10000000 };
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t xorshift(uint64_t* s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+// Keeps the optimizer from discarding the flush
+static volatile unsigned char sink;
+
+static void flush_caches(unsigned char* buf) {
+    unsigned char acc = 0;
+    for (size_t i = 0; i < FLUSH_BYTES; i += 64) {
+        buf[i]++;
+        acc ^= buf[i];
+    }
+    sink = acc;
+}
+
+static void reset_zones(Workload* w) {
+    for (size_t i = 0; i < w->n; i++) {
+        w->zones[i].stabilityScore = (float)(i % 100);
+        ZoneBatch_set(w->batch, i, &w->zones[i]);
+    }
+}
+
+static void free_workload(Workload* w) {
+    for (size_t i = 0; w->objects && i < w->n; i++) DELETE(w->objects[i]);
+    for (size_t i = 0; w->mixedObjects && i < w->n; i++) DELETE(w->mixedObjects[i]);
+    DELETE(w->batch);
+    free(w->objects);
+    free(w->mixedObjects);
+    free(w->kinds);
+    free(w->mixedKinds);
+    free(w->zones);
+}
+
+static int make_workload(Workload* w, size_t n) {
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    memset(w, 0, sizeof(*w));
+    w->n = n;
+    w->zones = (ZoneData*)calloc(n, sizeof(ZoneData));
+    w->kinds = (unsigned char*)calloc(n, 1);
+    w->mixedKinds = (unsigned char*)malloc(n);
+    w->objects = (Object**)calloc(n, sizeof(Object*));
+    w->mixedObjects = (Object**)calloc(n, sizeof(Object*));
+    w->batch = NEW(ZoneBatch);
+    if (!w->zones || !w->kinds || !w->mixedKinds || !w->objects || !w->mixedObjects || !w->batch ||
+        ZoneBatch_reserve(w->batch, n)) {
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        ZoneData* z = &w->zones[i];
+        z->name = "zone";
+        z->isActive = (i % 8) != 0;
+        w->mixedKinds[i] = (unsigned char)(xorshift(&seed) & 1);
+        w->objects[i] = AS_OBJECT(NEW_WITH_DATA(Zone, ZoneData, z));
+        w->mixedObjects[i] = w->mixedKinds[i] ? AS_OBJECT(NEW_WITH_DATA(QuantumZone, ZoneData, z))
+                                              : AS_OBJECT(NEW_WITH_DATA(Zone, ZoneData, z));
+        if (!w->objects[i] || !w->mixedObjects[i] || ZoneBatch_push(w->batch, z) == (size_t)-1) return -1;
+    }
+    return 0;
+}
+
+static void run_size(Workload* w, unsigned char* flush, double minSeconds) {
+    static double reps[MAX_REPS];
+    for (int cold = 0; cold < 2; cold++) {
+        for (size_t v = 0; v < sizeof(VARIANTS) / sizeof(VARIANTS[0]); v++) {
+            reset_zones(w);
+            int nReps = -1;  // rep -1 is an untimed warm-up
+            double started = now_s();
+            while (nReps < MAX_REPS && (nReps < 3 || now_s() - started < minSeconds)) {
+                if (cold) flush_caches(flush);
+                double t0 = now_s();
+                VARIANTS[v].run(w);
+                double t = now_s() - t0;
+                if (nReps >= 0) reps[nReps] = t;
+                nReps++;
+            }
+            qsort(reps, (size_t)nReps, sizeof(double), cmp_double);
+            double median = reps[nReps / 2];
+            printf("{\"bench\":\"dispatch\",\"variant\":\"%s\",\"n\":%zu,\"cache\":\"%s\",\"reps\":%d,"
+                   "\"seconds\":%.9f,\"nsPerObject\":%.3f,\"profile\":" PROFILED "}\n",
+                   VARIANTS[v].name, w->n, cold ? "cold" : "warm", nReps, median, median * 1e9 / (double)w->n);
+            fflush(stdout);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int quick = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = 1;
+        } else {
+            fprintf(stderr, "usage: %s [--quick]\n", argv[0]);
+            return 2;
+        }
+    }
+    unsigned char* flush = (unsigned char*)calloc(FLUSH_BYTES, 1);
+    if (!flush) {
+        fprintf(stderr, "dispatch_bench: out of memory\n");
+        return 1;
+    }
+    size_t nSizes = sizeof(SIZES) / sizeof(SIZES[0]) - (quick ? 1 : 0);
+    for (size_t s = 0; s < nSizes; s++) {
+        Workload w;
+        if (make_workload(&w, SIZES[s])) {
+            fprintf(stderr, "dispatch_bench: out of memory at n=%zu\n", SIZES[s]);
+            free_workload(&w);
+            free(flush);
+            return 1;
+        }
+        run_size(&w, flush, quick ? MIN_SECONDS / 4 : MIN_SECONDS);
+        free_workload(&w);
+    }
+    free(flush);
+#ifdef VTABLE_PROFILE
+    if (vprof_report(stdout)) {
+        fprintf(stderr, "dispatch_bench: profile report failed\n");
+        return 1;
+    }
+#endif
+    return 0;
+}
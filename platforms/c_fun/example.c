@@ -3,9 +3,9 @@
 #include "vtable.h"
 
 // Define method indices
-#define MAKE_SOUND_INDEX 0
-#define MOVE_INDEX 1
-#define WAG_TAIL_INDEX 2
+#define makeSound_INDEX 0
+#define move_INDEX 1
+#define wagTail_INDEX 2
 
 // Define data structures
 typedef struct {
@@ -47,15 +47,15 @@ DEFINE_METHOD(Dog, wagTail, void) {
            data->base.name, data->tailLength);
 }
 
-// Initialize classes
-INIT_CLASS(Animal, Object,
-    ADD_METHOD(Animal, makeSound),
+// Initialize classes; Dog inherits Animal's move
+#define Animal_METHODS \
+    ADD_METHOD(Animal, makeSound), \
     ADD_METHOD(Animal, move)
-);
+
+INIT_CLASS(Animal, Object, Animal_METHODS);
 
 INIT_CLASS(Dog, Animal,
     ADD_METHOD(Dog, makeSound),
-    ADD_METHOD(Dog, move),
     ADD_METHOD(Dog, wagTail)
 );
 
@@ -0,0 +1,223 @@
+// Shared-object reclamation benchmark for vtable.h, built with -DVTABLE_REFCOUNT -DVTABLE_EPOCH
+// -DVTABLE_SLAB_ALLOC. Build and run: make bench   (or ./reclaim_bench [--quick] [--readers N])
+//
+// One writer thread replaces a shared object SWAPS times while N reader threads keep calling
+// it, and reports one JSON object per variant:
+//   {"bench":"reclaim","variant":"retire","readers":4,"swaps":..,"nsPerSwap":..,"reads":..,..}
+//
+// Variants:
+//   retire   readers CALL the current object inside vepoch_enter/exit; the writer swaps in a
+//            fresh one and RETIREs the old one, which the writer's thread frees
+//   release  the writer hands each new object to every reader with a reference of its own;
+//            readers CALL it and RELEASE it, so the last reference is usually dropped (and the
+//            slot freed back to the writer's slab) on a reader thread
+//
+// Once every thread has drained its retired objects, exactly one object (the current one) may
+// still be allocated from the writer's slab. Anything else is a leak or a lost free: the
+// variant reports it as "outstanding" and the bench exits with status 1.
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vtable.h"
+
+#define SWAPS (1u << 18)
+#define MAX_READERS 64
+#define DEFAULT_READERS 4
+#define PAYLOADS 64
+
+// Define method indices
+#define read_INDEX 0
+
+typedef struct {
+    long value;
+} BoxData;
+
+// Define classes
+DEFINE_CLASS(Box, Object, BoxData);
+
+DEFINE_METHOD(Box, read, void, long* sum) {
+    (void)self;
+    *sum += ((BoxData*)thisData)->value;
+}
+
+INIT_CLASS(Box, Object,
+    ADD_METHOD(Box, read)
+);
+
+static BoxData payloads[PAYLOADS];
+
+// What one variant runs over
+typedef struct {
+    int readers;
+    unsigned swaps;
+    _Atomic(Object*) shared;                 // retire: the current object
+    _Atomic(Object*) mailbox[MAX_READERS];   // release: each reader's next object, or NULL
+    atomic_bool done;
+    _Atomic unsigned long long reads;
+    _Atomic long sink;                       // Keeps the reads from being optimized out
+} Run;
+
+typedef struct {
+    Run* run;
+    int index;
+} Reader;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Objects allocated from `slab` and not yet freed, counting frees still on its remote list
+static size_t outstanding(VSlab* slab) {
+    size_t remote = 0;
+    for (void* p = atomic_load(&slab->remoteFree); p; p = *(void**)p) remote++;
+    return slab->live - remote;
+}
+
+static Box* new_box(unsigned i) {
+    Box* box = NEW_WITH_DATA(Box, BoxData, &payloads[i % PAYLOADS]);
+    if (!box) {
+        fprintf(stderr, "reclaim_bench: out of memory\n");
+        exit(1);
+    }
+    return box;
+}
+
+static void* retire_reader(void* arg) {
+    Run* run = ((Reader*)arg)->run;
+    unsigned long long reads = 0;
+    long sum = 0;
+    while (!atomic_load_explicit(&run->done, memory_order_relaxed)) {
+        vepoch_enter();
+        Object* box = atomic_load_explicit(&run->shared, memory_order_acquire);
+        CALL(box, read, &sum);
+        vepoch_exit();
+        reads++;
+    }
+    vepoch_drain();
+    atomic_fetch_add(&run->reads, reads);
+    atomic_fetch_add(&run->sink, sum);
+    return NULL;
+}
+
+static void retire_writer(Run* run) {
+    for (unsigned i = 1; i <= run->swaps; i++) {
+        Object* old = atomic_exchange_explicit(&run->shared, AS_OBJECT(new_box(i)), memory_order_acq_rel);
+        RETIRE(old);
+    }
+}
+
+static void* release_reader(void* arg) {
+    Reader* reader = (Reader*)arg;
+    Run* run = reader->run;
+    _Atomic(Object*)* mailbox = &run->mailbox[reader->index];
+    unsigned long long reads = 0;
+    long sum = 0;
+    for (;;) {
+        Object* box = atomic_exchange_explicit(mailbox, NULL, memory_order_acquire);
+        if (!box) {
+            if (atomic_load_explicit(&run->done, memory_order_acquire) && !atomic_load(mailbox)) break;
+            sched_yield();
+            continue;
+        }
+        CALL(box, read, &sum);
+        RELEASE(box);
+        reads++;
+    }
+    vepoch_drain();
+    atomic_fetch_add(&run->reads, reads);
+    atomic_fetch_add(&run->sink, sum);
+    return NULL;
+}
+
+static void release_writer(Run* run) {
+    for (unsigned i = 1; i <= run->swaps; i++) {
+        Box* box = new_box(i);
+        for (int r = 0; r < run->readers; r++) {
+            while (atomic_load_explicit(&run->mailbox[r], memory_order_relaxed)) sched_yield();
+            atomic_store_explicit(&run->mailbox[r], AS_OBJECT(RETAIN(box)), memory_order_release);
+        }
+        RELEASE(box);
+    }
+}
+
+typedef struct {
+    const char* name;
+    void* (*reader)(void*);
+    void (*writer)(Run*);
+} Variant;
+
+static const Variant VARIANTS[] = {
+    { "retire", retire_reader, retire_writer },
+    { "release", release_reader, release_writer },
+};
+
+// Run one variant and print its line; returns 0 if nothing leaked
+static int run_variant(const Variant* v, int readers, unsigned swaps) {
+    Run run;
+    memset(&run, 0, sizeof(run));
+    run.readers = readers;
+    run.swaps = swaps;
+    atomic_init(&run.shared, AS_OBJECT(new_box(0)));
+    pthread_t tids[MAX_READERS];
+    Reader args[MAX_READERS];
+    int started = 0;
+    double t0 = now_s();
+    for (; started < readers; started++) {
+        args[started] = (Reader){ &run, started };
+        if (pthread_create(&tids[started], NULL, v->reader, &args[started])) break;
+    }
+    if (started < readers) {
+        fprintf(stderr, "reclaim_bench: started only %d reader threads\n", started);
+        run.readers = readers = started;
+    }
+    v->writer(&run);
+    double seconds = now_s() - t0;
+    atomic_store_explicit(&run.done, true, memory_order_release);
+    for (int t = 0; t < started; t++) pthread_join(tids[t], NULL);
+    vepoch_drain();
+
+    size_t left = outstanding(Box_slab());
+    unsigned long long reads = atomic_load(&run.reads);
+    printf("{\"bench\":\"reclaim\",\"variant\":\"%s\",\"readers\":%d,\"swaps\":%u,\"seconds\":%.9f,"
+           "\"nsPerSwap\":%.3f,\"reads\":%llu,\"nsPerRead\":%.3f,\"outstanding\":%zu}\n",
+           v->name, readers, swaps, seconds, seconds * 1e9 / swaps, reads,
+           reads ? seconds * 1e9 * readers / (double)reads : 0.0, left);
+    fflush(stdout);
+    DELETE(atomic_load(&run.shared));
+    return left == 1 ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    int readers = DEFAULT_READERS;
+    unsigned swaps = SWAPS;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            swaps = SWAPS / 16;
+        } else if (strcmp(argv[i], "--readers") == 0 && i + 1 < argc) {
+            readers = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--readers N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (readers < 1 || readers > MAX_READERS) {
+        fprintf(stderr, "reclaim_bench: --readers must be 1 to %d\n", MAX_READERS);
+        return 2;
+    }
+    for (int p = 0; p < PAYLOADS; p++) payloads[p].value = p + 1;
+    int rc = 0;
+    for (size_t v = 0; v < sizeof(VARIANTS) / sizeof(VARIANTS[0]); v++) {
+        if (run_variant(&VARIANTS[v], readers, swaps)) rc = 1;
+    }
+    vslab_destroy(Box_slab());
+    return rc;
+}
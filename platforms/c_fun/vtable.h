@@ -1,82 +1,174 @@
 #ifndef VTABLE_H
 #define VTABLE_H
 
+#include <stdatomic.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vtable_alloc.h"
+#include "vtable_lookup.h"
 
 // Function pointer types
 typedef void* (*MethodPtr)(void* self, void* thisData, ...);
 typedef void* (*ConstructorPtr)(void* self, void* thisData, ...);
 typedef void (*DestructorPtr)(void* self, void* thisData);
 
-// V-Table structure
+// V-Table structure. One per class, read-only and shared by every instance (and thread);
+// per-instance state lives in the Object.
 typedef struct {
     const char* className;
     ConstructorPtr constructor;
     DestructorPtr destructor;
-    MethodPtr* methods;
+    const MethodPtr* methods;
     size_t methodCount;
-    void* thisData;  // Class-specific data pointer
+    VSlab* (*slab)(void);  // This thread's slab for the class (see VTABLE_SLAB_ALLOC)
+    const char* const* methodNames;  // Indexed by slot, for vtable_find_method
+    const uint8_t* lookup;  // Name hash bucket -> slot + 1 (see vtable_lookup.h)
 } VTable;
 
-// Base object structure
+// Base object structure. Every class embeds its parent first, so any instance can be
+// viewed as an Object to reach its vtable and data.
 typedef struct {
     const VTable* vtable;
+    void* thisData;  // Instance-specific data pointer
+#ifdef VTABLE_REFCOUNT
+    _Atomic size_t refs;  // See RETAIN / RELEASE
+#endif
 } Object;
 
+// View any instance as its base Object
+#define AS_OBJECT(obj) ((Object*)(obj))
+
 // Macro to define a new class with templated data
 #define DEFINE_CLASS(ClassName, ParentClass, DataType) \
     typedef struct { \
         ParentClass parent; \
-        DataType* thisData; \
     } ClassName; \
     \
-    static VTable ClassName##_vtable; \
+    static const VTable ClassName##_vtable; \
+    \
+    static VSlab* ClassName##_slab(void) { \
+        static _Thread_local VSlab slab = VSLAB_INIT(sizeof(ClassName)); \
+        return &slab; \
+    } \
     \
     static void* ClassName##_constructor(void* self, void* thisData, ...) { \
         ClassName* obj = (ClassName*)self; \
-        obj->parent.vtable = &ClassName##_vtable; \
-        obj->thisData = (DataType*)thisData; \
-        obj->parent.vtable->thisData = thisData; \
+        AS_OBJECT(obj)->vtable = &ClassName##_vtable; \
+        AS_OBJECT(obj)->thisData = (DataType*)thisData; \
         /* Initialize your class-specific members here */ \
         return obj; \
     } \
     \
     static void ClassName##_destructor(void* self, void* thisData) { \
-        ClassName* obj = (ClassName*)self; \
+        (void)self; \
+        (void)thisData; \
         /* Clean up your class-specific members here */ \
     }
 
-// Macro to define a method
+// Macro to define a method. Also declares ClassName_MethodName_fn, a pointer type with the
+// method's real prototype, for typed calls that skip default argument promotion.
 #define DEFINE_METHOD(ClassName, MethodName, ReturnType, ...) \
+    typedef ReturnType (*ClassName##_##MethodName##_fn)(void* self, void* thisData, ##__VA_ARGS__); \
+    \
     static ReturnType ClassName##_##MethodName(void* self, void* thisData, ##__VA_ARGS__); \
     \
     static ReturnType ClassName##_##MethodName(void* self, void* thisData, ##__VA_ARGS__)
 
-// Macro to add a method to the V-Table
+// Macro to add a method to the V-Table (only meaningful inside INIT_CLASS)
 #define ADD_METHOD(ClassName, MethodName) \
-    (MethodPtr)ClassName##_##MethodName
+    (1, ClassName, MethodName)
 
-// Macro to initialize a class
+// The methods every class inherits from Object: none
+#define Object_METHODS (0, Object, none)
+
+// Macro to initialize a class. The table starts as a copy of the parent's and the listed
+// methods are added or override the parent's in their slots (MethodName_INDEX), all in a
+// constant initializer: no copying at startup, and CALL stays a single indirection however
+// deep the hierarchy. The parent's list is read from ParentClassName_METHODS, so a class that
+// others inherit from must define ClassName_METHODS as its complete list, i.e. its parent's
+// list and then its own ADD_METHODs, and pass that here (entries then repeat, harmlessly).
+// Besides the method table this builds, also at compile time, the name table and name-hash
+// index behind vtable_find_method(), and fails to compile if two method names share a bucket.
 #define INIT_CLASS(ClassName, ParentClassName, ...) \
-    static MethodPtr ClassName##_methods[] = { \
-        __VA_ARGS__ \
+    VTABLE_OVERRIDES_BEGIN_ \
+    static const MethodPtr ClassName##_methods[] = { \
+        VTABLE_EACH_(VTABLE_METHOD_ENTRY_, ~, ParentClassName##_METHODS, __VA_ARGS__) \
+    }; \
+    \
+    static const char* const ClassName##_methodNames[sizeof(ClassName##_methods) / sizeof(MethodPtr)] = { \
+        VTABLE_EACH_(VTABLE_NAME_ENTRY_, ~, ParentClassName##_METHODS, __VA_ARGS__) \
     }; \
+    VTABLE_OVERRIDES_END_ \
+    \
+    _Static_assert(VTABLE_LOOKUP_SLOTS_OK_(ParentClassName##_METHODS, __VA_ARGS__), \
+                   #ClassName ": method slots (MethodName_INDEX) must be below 64"); \
+    static const int ClassName##_lookupIsPerfect __attribute__((unused)) = \
+        VTABLE_LOOKUP_PERFECT_(ParentClassName##_METHODS, __VA_ARGS__) ? 1 : VTABLE_LOOKUP_COLLISION_; \
+    \
+    static const uint8_t ClassName##_lookup[VTABLE_LOOKUP_BUCKETS] = \
+        VTABLE_LOOKUP_TABLE_(ParentClassName##_METHODS, __VA_ARGS__); \
     \
-    static VTable ClassName##_vtable = { \
+    static const VTable ClassName##_vtable = { \
         .className = #ClassName, \
         .constructor = ClassName##_constructor, \
         .destructor = ClassName##_destructor, \
         .methods = ClassName##_methods, \
         .methodCount = sizeof(ClassName##_methods) / sizeof(MethodPtr), \
-        .thisData = NULL \
+        .slab = ClassName##_slab, \
+        .methodNames = ClassName##_methodNames, \
+        .lookup = ClassName##_lookup \
     }
 
+// Slot of the method called `name` in `vt`, or -1: one hash, one bucket and one strcmp, as
+// INIT_CLASS guarantees each method a bucket of its own. Resolve once and keep the slot: calls
+// through vt->methods[slot] then cost the same as CALL.
+static inline int vtable_find_method(const VTable* vt, const char* name) {
+    size_t len = strlen(name);
+    unsigned slot = vt->lookup[VTABLE_BUCKET_OF_(vtable_name_hash(name, len))];
+    return slot && strcmp(vt->methodNames[slot - 1], name) == 0 ? (int)slot - 1 : -1;
+}
+
+// Object storage for NEW_WITH_DATA / DELETE. Build with -DVTABLE_SLAB_ALLOC to take objects
+// from a per-class, per-thread slab (O(1), lock-free, contiguous) instead of malloc. An
+// object may be deleted on another thread; its slot then goes back to the slab it came from
+// (see vtable_alloc.h), whose thread must not have exited.
+#ifdef VTABLE_SLAB_ALLOC
+#define VTABLE_OBJ_ALLOC(ClassName) vslab_alloc(ClassName##_slab())
+#define VTABLE_OBJ_FREE(obj) vslab_free((obj)->vtable->slab(), (obj))
+#else
+#define VTABLE_OBJ_ALLOC(ClassName) malloc(sizeof(ClassName))
+#define VTABLE_OBJ_FREE(obj) free(obj)
+#endif
+
+// New objects start with one reference when built with -DVTABLE_REFCOUNT
+#ifdef VTABLE_REFCOUNT
+#define VTABLE_INIT_REFS(obj) atomic_init(&AS_OBJECT(obj)->refs, 1)
+#else
+#define VTABLE_INIT_REFS(obj) ((void)0)
+#endif
+
 // Macro to create a new instance with data
 #define NEW_WITH_DATA(ClassName, DataType, data) \
     ({ \
-        ClassName* obj = (ClassName*)malloc(sizeof(ClassName)); \
+        ClassName* obj = (ClassName*)VTABLE_OBJ_ALLOC(ClassName); \
         if (obj) { \
             ClassName##_constructor(obj, data); \
+            VTABLE_INIT_REFS(obj); \
+        } \
+        obj; \
+    })
+
+// Macro to create an instance in a VArena. Never DELETE it: varena_reset() releases every
+// object in the arena at once, without running destructors.
+#define NEW_IN_ARENA(arena, ClassName, DataType, data) \
+    ({ \
+        ClassName* obj = (ClassName*)varena_alloc((arena), sizeof(ClassName)); \
+        if (obj) { \
+            ClassName##_constructor(obj, data); \
+            VTABLE_INIT_REFS(obj); \
         } \
         obj; \
     })
@@ -88,15 +180,80 @@ typedef struct {
 // Macro to delete an instance
 #define DELETE(obj) \
     do { \
-        if (obj) { \
-            obj->vtable->destructor(obj, obj->vtable->thisData); \
-            free(obj); \
+        Object* _delObj = AS_OBJECT(obj); \
+        if (_delObj) { \
+            _delObj->vtable->destructor(_delObj, _delObj->thisData); \
+            VTABLE_OBJ_FREE(_delObj); \
         } \
     } while(0)
 
-// Macro to call a method
+// Destroy and free an object, as DELETE; usable as a vepoch_retire() callback
+static inline void vtable_delete_object(void* p) {
+    DELETE(p);
+}
+
+// Shared ownership, with -DVTABLE_REFCOUNT. RETAIN takes a reference; RELEASE drops one and
+// deletes the object with the last. With -DVTABLE_EPOCH as well, the last RELEASE retires the
+// object instead (see vtable_epoch.h), so threads reading it inside vepoch_enter/exit without
+// references of their own are never left holding freed memory.
+#ifdef VTABLE_REFCOUNT
+#define RETAIN(obj) \
+    ({ \
+        __typeof__(obj) _retainObj = (obj); \
+        atomic_fetch_add_explicit(&AS_OBJECT(_retainObj)->refs, 1, memory_order_relaxed); \
+        _retainObj; \
+    })
+
+#ifdef VTABLE_EPOCH
+#define VTABLE_RECLAIM(obj) vepoch_retire((obj), vtable_delete_object)
+#else
+#define VTABLE_RECLAIM(obj) vtable_delete_object(obj)
+#endif
+
+#define RELEASE(obj) \
+    do { \
+        Object* _releaseObj = AS_OBJECT(obj); \
+        if (_releaseObj && atomic_fetch_sub_explicit(&_releaseObj->refs, 1, memory_order_release) == 1) { \
+            atomic_thread_fence(memory_order_acquire); \
+            VTABLE_RECLAIM(_releaseObj); \
+        } \
+    } while(0)
+#endif
+
+// Profiling hook for the CALL macros (see vtable_profile.h); nothing unless -DVTABLE_PROFILE
+#ifdef VTABLE_PROFILE
+#define VTABLE_PROFILE_CALL(vtable, method) VPROF_SCOPE((vtable), (method))
+#else
+#define VTABLE_PROFILE_CALL(vtable, method) ((void)0)
+#endif
+
+// Macro to call a method; `obj` is evaluated once and its own thisData is passed along
 #define CALL(obj, MethodName, ...) \
-    ((obj)->vtable->methods[MethodName##_INDEX])(obj, (obj)->vtable->thisData, ##__VA_ARGS__)
+    ({ \
+        Object* _callObj = AS_OBJECT(obj); \
+        VTABLE_PROFILE_CALL(_callObj->vtable, MethodName##_INDEX); \
+        _callObj->vtable->methods[MethodName##_INDEX](_callObj, _callObj->thisData, ##__VA_ARGS__); \
+    })
+
+// Macro to call ClassName's own implementation directly, bypassing the vtable. Use it where
+// the class of `obj` is known: the call gets the method's real prototype (a float argument
+// stays a float) and can be inlined.
+#define CALL_STATIC(ClassName, obj, MethodName, ...) \
+    ({ \
+        Object* _callObj = AS_OBJECT(obj); \
+        VTABLE_PROFILE_CALL(&ClassName##_vtable, MethodName##_INDEX); \
+        ClassName##_##MethodName(_callObj, _callObj->thisData, ##__VA_ARGS__); \
+    })
+
+// Macro to call through the vtable with ClassName's prototype for MethodName. Still dispatched
+// at run time, but arguments are passed as declared; every override must share that prototype.
+#define CALL_AS(ClassName, obj, MethodName, ...) \
+    ({ \
+        Object* _callObj = AS_OBJECT(obj); \
+        VTABLE_PROFILE_CALL(_callObj->vtable, MethodName##_INDEX); \
+        ((ClassName##_##MethodName##_fn)_callObj->vtable->methods[MethodName##_INDEX])( \
+            _callObj, _callObj->thisData, ##__VA_ARGS__); \
+    })
 
 // Example usage:
 /*
@@ -121,15 +278,16 @@ DEFINE_CLASS(Dog, Animal, DogData);
 DEFINE_METHOD(Dog, makeSound, void);
 DEFINE_METHOD(Dog, wagTail, void);
 
-// Initialize classes
-INIT_CLASS(Animal, Object,
-    ADD_METHOD(Animal, makeSound),
+// Initialize classes; Animal is inherited from, so it names its method list
+#define Animal_METHODS \
+    ADD_METHOD(Animal, makeSound), \
     ADD_METHOD(Animal, move)
-);
 
+INIT_CLASS(Animal, Object, Animal_METHODS);
+
+// Dog inherits Animal_move and overrides makeSound
 INIT_CLASS(Dog, Animal,
     ADD_METHOD(Dog, makeSound),
-    ADD_METHOD(Dog, move),
     ADD_METHOD(Dog, wagTail)
 );
 
@@ -141,7 +299,18 @@ DogData dogData = {
 Dog* dog = NEW_WITH_DATA(Dog, DogData, &dogData);
 CALL(dog, makeSound);
 CALL(dog, wagTail);
+CALL_STATIC(Dog, dog, wagTail);  // Known to be a Dog: direct, inlinable call
+int slot = vtable_find_method(AS_OBJECT(dog)->vtable, "wagTail");  // By name, e.g. from a script
+AS_OBJECT(dog)->vtable->methods[slot](dog, AS_OBJECT(dog)->thisData);
 DELETE(dog);
 */
 
+#ifdef VTABLE_PROFILE
+#include "vtable_profile.h"
+#endif
+
+#ifdef VTABLE_EPOCH
+#include "vtable_epoch.h"
+#endif
+
 #endif // VTABLE_H 
\ No newline at end of file
@@ -0,0 +1,180 @@
+#ifndef VTABLE_ALLOC_H
+#define VTABLE_ALLOC_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+// Allocation backends for vtable.h objects.
+//
+// VSlab: fixed-size slots carved from blocks of VSLAB_BLOCK_OBJECTS, recycled through an
+// intrusive free list. Alloc and free are O(1), objects of one slab sit contiguously, and
+// there are no locks: a slab belongs to one thread (vtable.h keeps one per class per thread),
+// and only that thread allocates from it. Each slot records its slab, so an object freed on
+// another thread is pushed onto its own slab's atomic remote-free list, which the owner takes
+// back whole the next time its local list runs dry. A slab must outlive its objects: a
+// thread's slabs live in its thread-local storage, so objects it allocated must be freed
+// before it exits. Blocks are only returned to the system by vslab_destroy().
+//
+// VArena: a bump allocator over chunks of at least VARENA_CHUNK_BYTES. Objects are never
+// freed one by one; varena_reset() drops them all at once (without running destructors)
+// and keeps the memory for the next round.
+
+#define VSLAB_BLOCK_OBJECTS 256
+#define VARENA_CHUNK_BYTES (64 * 1024)
+#define VALLOC_ALIGN _Alignof(max_align_t)
+#define VALLOC_ROUND(size) (((size) + VALLOC_ALIGN - 1) / VALLOC_ALIGN * VALLOC_ALIGN)
+
+// ---- Slabs ----
+
+typedef union VSlabBlock {
+    union VSlabBlock* next;
+    max_align_t align;  // keeps the slots after the header aligned
+} VSlabBlock;
+
+struct VSlab;
+
+// Header in front of every slot
+typedef union {
+    struct VSlab* owner;
+    max_align_t align;  // keeps the object after the header aligned
+} VSlabSlot;
+
+typedef struct VSlab {
+    size_t slotSize;  // Header included
+    void* freeList;
+    VSlabBlock* blocks;
+    size_t live;  // Objects currently allocated, less remote frees not yet taken back
+    _Atomic(void*) remoteFree;  // Pushed by other threads, taken whole by the owner
+} VSlab;
+
+// Static initializer for a slab of objects of `size` bytes
+#define VSLAB_INIT(size) \
+    { sizeof(VSlabSlot) + VALLOC_ROUND((size) < sizeof(void*) ? sizeof(void*) : (size)), \
+      NULL, NULL, 0, NULL }
+
+// The slab `p` was allocated from
+static inline VSlab* vslab_owner(const void* p) {
+    return ((const VSlabSlot*)p - 1)->owner;
+}
+
+// Allocate from `slab`; only its owning thread may call this
+static inline void* vslab_alloc(VSlab* slab) {
+    if (!slab->freeList) {
+        // Take back every object other threads have freed since the last time
+        void* remote = atomic_exchange_explicit(&slab->remoteFree, NULL, memory_order_acquire);
+        for (void* p = remote; p; p = *(void**)p) slab->live--;
+        slab->freeList = remote;
+    }
+    if (!slab->freeList) {
+        VSlabBlock* block = (VSlabBlock*)malloc(sizeof(VSlabBlock) + slab->slotSize * VSLAB_BLOCK_OBJECTS);
+        if (!block) return NULL;
+        block->next = slab->blocks;
+        slab->blocks = block;
+        // Thread the new slots onto the free list in address order
+        char* slots = (char*)(block + 1);
+        for (size_t i = VSLAB_BLOCK_OBJECTS; i-- > 0;) {
+            VSlabSlot* slot = (VSlabSlot*)(slots + i * slab->slotSize);
+            slot->owner = slab;
+            *(void**)(slot + 1) = slab->freeList;
+            slab->freeList = slot + 1;
+        }
+    }
+    void* p = slab->freeList;
+    slab->freeList = *(void**)p;
+    slab->live++;
+    return p;
+}
+
+// Free `p` from the calling thread, whose own slab for the class is `slab`. An object from
+// another thread's slab goes onto that slab's remote-free list.
+static inline void vslab_free(VSlab* slab, void* p) {
+    VSlab* owner = vslab_owner(p);
+    if (owner == slab) {
+        *(void**)p = slab->freeList;
+        slab->freeList = p;
+        slab->live--;
+        return;
+    }
+    void* head = atomic_load_explicit(&owner->remoteFree, memory_order_relaxed);
+    do {
+        *(void**)p = head;
+    } while (!atomic_compare_exchange_weak_explicit(&owner->remoteFree, &head, p,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+// Release every block; all objects from the slab become invalid, and no other thread may
+// still be freeing into it
+static inline void vslab_destroy(VSlab* slab) {
+    while (slab->blocks) {
+        VSlabBlock* next = slab->blocks->next;
+        free(slab->blocks);
+        slab->blocks = next;
+    }
+    slab->freeList = NULL;
+    slab->live = 0;
+    atomic_store_explicit(&slab->remoteFree, NULL, memory_order_relaxed);
+}
+
+// ---- Arenas ----
+
+typedef struct VArenaChunk {
+    struct VArenaChunk* next;
+    size_t size;  // Usable bytes after the header
+    size_t used;
+} VArenaChunk;
+
+// Chunks after `current` are always empty; a reset rewinds `current` to `first`.
+typedef struct {
+    VArenaChunk* first;
+    VArenaChunk* current;
+} VArena;
+
+#define VARENA_INIT { NULL, NULL }
+
+// Header size rounded up so the first allocation in a chunk is aligned
+#define VARENA_HEADER VALLOC_ROUND(sizeof(VArenaChunk))
+
+static inline void* varena_alloc(VArena* arena, size_t size) {
+    size = VALLOC_ROUND(size ? size : 1);
+    VArenaChunk* chunk = arena->current;
+    if (!chunk || chunk->size - chunk->used < size) {
+        VArenaChunk* next = chunk ? chunk->next : arena->first;
+        while (next && next->size < size) next = next->next;
+        if (!next) {
+            size_t bytes = size > VARENA_CHUNK_BYTES ? size : VARENA_CHUNK_BYTES;
+            next = (VArenaChunk*)malloc(VARENA_HEADER + bytes);
+            if (!next) return NULL;
+            next->size = bytes;
+            next->used = 0;
+            if (chunk) {
+                next->next = chunk->next;
+                chunk->next = next;
+            } else {
+                next->next = arena->first;
+                arena->first = next;
+            }
+        }
+        arena->current = chunk = next;
+    }
+    void* p = (char*)chunk + VARENA_HEADER + chunk->used;
+    chunk->used += size;
+    return p;
+}
+
+// Drop every object at once; the chunks are kept for reuse
+static inline void varena_reset(VArena* arena) {
+    for (VArenaChunk* c = arena->first; c; c = c->next) c->used = 0;
+    arena->current = arena->first;
+}
+
+static inline void varena_destroy(VArena* arena) {
+    while (arena->first) {
+        VArenaChunk* next = arena->first->next;
+        free(arena->first);
+        arena->first = next;
+    }
+    arena->current = NULL;
+}
+
+#endif // VTABLE_ALLOC_H
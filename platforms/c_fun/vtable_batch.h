@@ -0,0 +1,169 @@
+#ifndef VTABLE_BATCH_H
+#define VTABLE_BATCH_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "vtable.h"
+
+// Struct-of-arrays batch classes: N instances' fields stored as parallel arrays, with methods
+// that run over the whole batch. CALL_BATCH dispatches once per batch, not once per instance,
+// and the loop inside the method walks contiguous arrays the compiler can vectorize.
+//
+// The fields to batch are an X-macro list of X(type, name, path), where `path` is the member
+// of DataType the field mirrors (nested members are fine). Fields left out (e.g. names) do
+// not take part in the batch. See the example at the end of this file.
+//
+// A batch is an Object whose thisData points at itself, so the method slots (and their
+// *_INDEX macros) can line up with the per-instance class they mirror.
+
+// Arrays are aligned (and padded) to this many bytes for full-width vector loads
+#define BATCH_ALIGN 64
+#define BATCH_MIN_CAPACITY 64
+
+#define BATCH_DECLARE_FIELD_(type, name, path) type* name;
+#define BATCH_FREE_FIELD_(type, name, path) free(batch->name);
+#define BATCH_GROW_FIELD_(type, name, path) \
+    if (ok) { \
+        type* grown = (type*)batch_alloc_array_(capacity * sizeof(type)); \
+        if (grown) { \
+            if (batch->count) memcpy(grown, batch->name, batch->count * sizeof(type)); \
+            free(batch->name); \
+            batch->name = grown; \
+        } else { \
+            ok = 0; \
+        } \
+    }
+#define BATCH_STORE_FIELD_(type, name, path) batch->name[index] = data->path;
+#define BATCH_LOAD_FIELD_(type, name, path) out->path = batch->name[index];
+
+static inline void* batch_alloc_array_(size_t bytes) {
+    return aligned_alloc(BATCH_ALIGN, (bytes + BATCH_ALIGN - 1) / BATCH_ALIGN * BATCH_ALIGN);
+}
+
+// Loop over every instance of a batch, telling the compiler iterations are independent
+#if defined(__clang__)
+#define BATCH_FOR(batch, i) \
+    _Pragma("clang loop vectorize(assume_safety)") \
+    for (size_t i = 0, i##_count = (batch)->count; i < i##_count; i++)
+#elif defined(__GNUC__)
+#define BATCH_FOR(batch, i) \
+    _Pragma("GCC ivdep") \
+    for (size_t i = 0, i##_count = (batch)->count; i < i##_count; i++)
+#else
+#define BATCH_FOR(batch, i) \
+    for (size_t i = 0, i##_count = (batch)->count; i < i##_count; i++)
+#endif
+
+// Macro to define a batch class mirroring the FIELDS of DataType
+#define DEFINE_BATCH_CLASS(BatchName, DataType, FIELDS) \
+    typedef struct { \
+        Object parent; \
+        size_t count; \
+        size_t capacity; \
+        FIELDS(BATCH_DECLARE_FIELD_) \
+    } BatchName; \
+    \
+    static const VTable BatchName##_vtable; \
+    \
+    static VSlab* BatchName##_slab(void) { \
+        static _Thread_local VSlab slab = VSLAB_INIT(sizeof(BatchName)); \
+        return &slab; \
+    } \
+    \
+    static void* BatchName##_constructor(void* self, void* thisData, ...) { \
+        BatchName* batch = (BatchName*)self; \
+        (void)thisData; \
+        memset(batch, 0, sizeof(*batch)); \
+        batch->parent.vtable = &BatchName##_vtable; \
+        batch->parent.thisData = batch; \
+        return batch; \
+    } \
+    \
+    static void BatchName##_destructor(void* self, void* thisData) { \
+        BatchName* batch = (BatchName*)self; \
+        (void)thisData; \
+        FIELDS(BATCH_FREE_FIELD_) \
+    } \
+    \
+    /* Make room for `capacity` instances; 0 on success, -1 if out of memory */ \
+    static inline int BatchName##_reserve(BatchName* batch, size_t capacity) { \
+        int ok = 1; \
+        if (capacity <= batch->capacity) return 0; \
+        FIELDS(BATCH_GROW_FIELD_) \
+        if (!ok) return -1; \
+        batch->capacity = capacity; \
+        return 0; \
+    } \
+    \
+    /* Append one instance's fields; returns its index, or (size_t)-1 if out of memory */ \
+    static inline size_t BatchName##_push(BatchName* batch, const DataType* data) { \
+        if (batch->count == batch->capacity && \
+            BatchName##_reserve(batch, batch->capacity ? batch->capacity * 2 : BATCH_MIN_CAPACITY)) { \
+            return (size_t)-1; \
+        } \
+        size_t index = batch->count++; \
+        FIELDS(BATCH_STORE_FIELD_) \
+        return index; \
+    } \
+    \
+    static inline void BatchName##_set(BatchName* batch, size_t index, const DataType* data) { \
+        FIELDS(BATCH_STORE_FIELD_) \
+    } \
+    \
+    /* Copy instance `index` back into `out`; members outside FIELDS are left alone */ \
+    static inline void BatchName##_get(const BatchName* batch, size_t index, DataType* out) { \
+        FIELDS(BATCH_LOAD_FIELD_) \
+    }
+
+// GCC at -O2 only vectorizes loops that need no scalar remainder, which a batch of any size
+// does; batch methods get the full cost model (clang vectorizes them at -O2 as it is)
+#if defined(__GNUC__) && !defined(__clang__)
+#define BATCH_VECTORIZE_ __attribute__((optimize("tree-vectorize", "vect-cost-model=dynamic")))
+#else
+#define BATCH_VECTORIZE_
+#endif
+
+// Macro to define a batch method; the body sees `batch` (the whole batch) in place of thisData
+#define DEFINE_BATCH_METHOD(BatchName, MethodName, ReturnType, ...) \
+    typedef ReturnType (*BatchName##_##MethodName##_fn)(void* self, BatchName* batch, ##__VA_ARGS__); \
+    \
+    static ReturnType BatchName##_##MethodName(void* self, BatchName* batch, ##__VA_ARGS__) BATCH_VECTORIZE_; \
+    \
+    static ReturnType BatchName##_##MethodName(void* self, BatchName* batch, ##__VA_ARGS__)
+
+// Macro to call a method once over every instance of a batch
+#define CALL_BATCH(batch, MethodName, ...) \
+    CALL(batch, MethodName, ##__VA_ARGS__)
+
+// Same, when the batch class is known: a direct call with the real prototype (see CALL_STATIC)
+#define CALL_BATCH_STATIC(BatchName, batch, MethodName, ...) \
+    CALL_STATIC(BatchName, batch, MethodName, ##__VA_ARGS__)
+
+// Example usage:
+/*
+#define ZONE_FIELDS(X) \
+    X(float, temperature, env.temperature) \
+    X(float, stabilityScore, stabilityScore) \
+    X(bool, isActive, isActive)
+
+DEFINE_BATCH_CLASS(ZoneBatch, ZoneData, ZONE_FIELDS);
+
+DEFINE_BATCH_METHOD(ZoneBatch, applyStabilization, void, double targetStability) {
+    (void)self;
+    float* restrict score = batch->stabilityScore;
+    BATCH_FOR(batch, i) score[i] += (float)((targetStability - score[i]) * 0.1);
+}
+
+INIT_CLASS(ZoneBatch, Object,
+    ADD_METHOD(ZoneBatch, applyStabilization)
+);
+
+ZoneBatch* zones = NEW(ZoneBatch);
+ZoneBatch_push(zones, &zoneData);         // copies the listed fields in
+CALL_BATCH(zones, applyStabilization, 95.0);
+ZoneBatch_get(zones, 0, &zoneData);       // and back out
+DELETE(zones);
+*/
+
+#endif // VTABLE_BATCH_H
@@ -0,0 +1,132 @@
+// Epochs and per-thread retire lists for vtable_epoch.h. Link this file into builds that use
+// -DVTABLE_EPOCH.
+#define _POSIX_C_SOURCE 200809L
+#include <sched.h>
+#include <stdlib.h>
+
+#include "vtable_epoch.h"
+
+typedef struct {
+    void* p;
+    void (*reclaim)(void*);
+} Retired;
+
+// Objects retired by one thread in one epoch (mod 3)
+typedef struct {
+    Retired* items;
+    size_t count;
+    size_t capacity;
+    uint64_t epoch;
+} Limbo;
+
+_Thread_local VEpochThread* vepoch_self_;
+
+static _Atomic uint64_t globalEpoch = 1;
+
+// Every thread that has entered a section, newest first; records are never freed, and a
+// record of an exited thread announces 0, so it never holds the epoch back
+static _Atomic(VEpochThread*) threads;
+
+static _Thread_local Limbo limbo[3];
+static _Thread_local size_t sinceAdvance;
+
+VEpochThread* vepoch_register_(void) {
+    VEpochThread* self = (VEpochThread*)calloc(1, sizeof(VEpochThread));
+    if (!self) abort();  // Readers have no way to proceed safely without a record
+    self->next = atomic_load_explicit(&threads, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&threads, &self->next, self,
+                                                  memory_order_release, memory_order_relaxed)) {
+    }
+    vepoch_self_ = self;
+    return self;
+}
+
+void vepoch_enter_slow_(VEpochThread* self) {
+    uint64_t epoch = atomic_load_explicit(&globalEpoch, memory_order_seq_cst);
+    // seq_cst: the announcement must be visible before this thread reads any shared pointer
+    atomic_store_explicit(&self->announced, (epoch << 1) | 1, memory_order_seq_cst);
+}
+
+// Move the global epoch on if every thread inside a section has seen it; returns the epoch
+static uint64_t try_advance(void) {
+    uint64_t epoch = atomic_load_explicit(&globalEpoch, memory_order_seq_cst);
+    for (VEpochThread* t = atomic_load_explicit(&threads, memory_order_acquire); t; t = t->next) {
+        uint64_t announced = atomic_load_explicit(&t->announced, memory_order_seq_cst);
+        if ((announced & 1) && (announced >> 1) != epoch) return epoch;
+    }
+    if (atomic_compare_exchange_strong_explicit(&globalEpoch, &epoch, epoch + 1,
+                                                memory_order_seq_cst, memory_order_seq_cst)) {
+        return epoch + 1;
+    }
+    return epoch;  // Someone else advanced it; `epoch` now holds the new value
+}
+
+static void free_limbo(Limbo* l) {
+    // Reclaimers may retire more objects, so take the batch out first
+    Retired* items = l->items;
+    size_t count = l->count, capacity = l->capacity;
+    l->items = NULL;
+    l->count = l->capacity = 0;
+    for (size_t i = 0; i < count; i++) items[i].reclaim(items[i].p);
+    if (l->items) {
+        free(items);  // A reclaimer started a new list here
+    } else {
+        l->items = items;
+        l->capacity = capacity;
+    }
+}
+
+// Free every list retired at least two epochs before `epoch`; returns objects left waiting
+static size_t free_ready(uint64_t epoch) {
+    size_t waiting = 0;
+    for (int b = 0; b < 3; b++) {
+        if (limbo[b].count && limbo[b].epoch + 2 <= epoch) free_limbo(&limbo[b]);
+        waiting += limbo[b].count;
+    }
+    return waiting;
+}
+
+static void wait_for_readers(void) {
+    uint64_t start = atomic_load_explicit(&globalEpoch, memory_order_seq_cst);
+    while (try_advance() < start + 2) sched_yield();
+}
+
+int vepoch_retire(void* p, void (*reclaim)(void*)) {
+    if (!p) return 0;
+    uint64_t epoch = atomic_load_explicit(&globalEpoch, memory_order_seq_cst);
+    Limbo* l = &limbo[epoch % 3];
+    // A list from an older epoch with the same slot is at least three epochs old
+    if (l->count && l->epoch != epoch) free_limbo(l);
+    l->epoch = epoch;
+    if (l->count == l->capacity) {
+        size_t grown = l->capacity ? l->capacity * 2 : VEPOCH_RETIRE_BATCH;
+        Retired* items = (Retired*)realloc(l->items, grown * sizeof(Retired));
+        if (!items) {
+            // Inside a section our own announcement pins the epoch, so waiting would never end
+            VEpochThread* self = vepoch_self_;
+            if (self && self->depth) return -1;
+            wait_for_readers();
+            reclaim(p);
+            return -1;
+        }
+        l->items = items;
+        l->capacity = grown;
+    }
+    l->items[l->count++] = (Retired){ p, reclaim };
+    if (++sinceAdvance >= VEPOCH_RETIRE_BATCH) vepoch_poll();
+    return 0;
+}
+
+size_t vepoch_poll(void) {
+    sinceAdvance = 0;
+    return free_ready(try_advance());
+}
+
+void vepoch_drain(void) {
+    while (vepoch_poll()) sched_yield();
+    for (int b = 0; b < 3; b++) {
+        free(limbo[b].items);
+        limbo[b].items = NULL;
+        limbo[b].capacity = 0;
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef VTABLE_EPOCH_H
+#define VTABLE_EPOCH_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "vtable.h"
+
+// Epoch-based reclamation for objects shared between threads, enabled by building with
+// -DVTABLE_EPOCH and linking vtable_epoch.c.
+//
+// Readers bracket their use of shared objects with vepoch_enter() / vepoch_exit(): no locks
+// and no refcount traffic, just one store and a fence per section. A writer that unlinks an
+// object (swaps it out of a shared slot) hands it to RETIRE instead of DELETE; it is deleted
+// once every thread that could still be reading it has left its section. Sections may nest,
+// must not block for long (they hold back reclamation for everyone), and an object must not
+// be reached again once retired.
+//
+//   // reader                          // writer
+//   vepoch_enter();                     Zone* old = atomic_exchange(&shared, fresh);
+//   Zone* z = atomic_load(&shared);     RETIRE(old);
+//   CALL(z, monitorStability);
+//   vepoch_exit();
+//
+// The scheme is the classic three-epoch one: objects retired in epoch e are freed once the
+// global epoch reaches e + 2, and the epoch only advances when every thread inside a section
+// has seen the current one. Retired objects are kept per thread and freed by that thread.
+
+// Retired objects a thread buffers before it tries to advance the epoch
+#define VEPOCH_RETIRE_BATCH 64
+
+typedef struct VEpochThread VEpochThread;
+
+extern _Thread_local VEpochThread* vepoch_self_;
+VEpochThread* vepoch_register_(void);
+void vepoch_enter_slow_(VEpochThread* self);
+
+// Per-thread state; only the owning thread writes it, apart from `announced`
+struct VEpochThread {
+    _Atomic uint64_t announced;  // (epoch << 1) | 1 inside a section, 0 outside
+    VEpochThread* next;
+    unsigned depth;
+};
+
+static inline void vepoch_enter(void) {
+    VEpochThread* self = vepoch_self_ ? vepoch_self_ : vepoch_register_();
+    if (self->depth++ == 0) vepoch_enter_slow_(self);
+}
+
+static inline void vepoch_exit(void) {
+    VEpochThread* self = vepoch_self_;
+    if (--self->depth == 0) atomic_store_explicit(&self->announced, 0, memory_order_release);
+}
+
+// Free `p` with `reclaim(p)` once no reader can still hold it; -1 if out of memory. Outside
+// a section the thread then waits for the current readers and frees `p` at once; inside one
+// `p` is left alone, and the caller should retire it again after vepoch_exit()
+int vepoch_retire(void* p, void (*reclaim)(void*));
+
+// Try to advance the epoch and free what this thread has retired; returns how many of its
+// objects are still waiting
+size_t vepoch_poll(void);
+
+// Block until everything this thread retired has been freed. Call before a thread that
+// retired objects exits, and never from inside a section.
+void vepoch_drain(void);
+
+// Retire a vtable.h object: DELETE it once no reader can still be using it
+#define RETIRE(obj) vepoch_retire(AS_OBJECT(obj), vtable_delete_object)
+
+#endif // VTABLE_EPOCH_H
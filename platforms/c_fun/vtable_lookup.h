@@ -0,0 +1,192 @@
+#ifndef VTABLE_LOOKUP_H
+#define VTABLE_LOOKUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Method-name hashing for vtable.h: INIT_CLASS hashes each method name at compile time into a
+// VTABLE_LOOKUP_BUCKETS-entry table of slot numbers, and vtable_find_method() hashes the name
+// it is given the same way, so a lookup is one hash, one table load and one strcmp to confirm
+// the name (a name the class does not have can still land in a taken bucket). INIT_CLASS also
+// checks at compile time that no two methods of the class share a bucket, so every method is
+// found that way, with no fallback. A class that fails the check needs a method renamed or
+// the whole build moved to another -DVTABLE_LOOKUP_SEED.
+//
+// The hash mixes the length with the characters at a few fixed positions (the first four,
+// the middle and the last two), which keeps the expression small enough to fold in a static
+// initializer. Names must be string literals at compile time; positions past the end read the
+// terminating '\0', at run time as at compile time.
+
+#define VTABLE_LOOKUP_BITS 6
+#define VTABLE_LOOKUP_BUCKETS (1u << VTABLE_LOOKUP_BITS)
+
+#define VTABLE_HASH_STEP_(h, c) (((h) ^ (uint32_t)(unsigned char)(c)) * 16777619u)
+#define VTABLE_HASH_AT_(S, i) (S)[(i) < sizeof(S) ? (i) : sizeof(S) - 1]
+
+// Hash of a string literal, as a constant expression
+#define VTABLE_NAME_HASH(S) \
+    VTABLE_HASH_STEP_(VTABLE_HASH_STEP_(VTABLE_HASH_STEP_(VTABLE_HASH_STEP_( \
+    VTABLE_HASH_STEP_(VTABLE_HASH_STEP_(VTABLE_HASH_STEP_( \
+        2166136261u ^ (uint32_t)(sizeof(S) - 1), \
+        VTABLE_HASH_AT_(S, 0)), VTABLE_HASH_AT_(S, 1)), VTABLE_HASH_AT_(S, 2)), VTABLE_HASH_AT_(S, 3)), \
+        VTABLE_HASH_AT_(S, (sizeof(S) - 1) / 2)), VTABLE_HASH_AT_(S, sizeof(S) - 2)), \
+        VTABLE_HASH_AT_(S, sizeof(S) - 3))
+
+#ifndef VTABLE_LOOKUP_SEED
+#define VTABLE_LOOKUP_SEED 0xC2B2AE35u  // Separates the methods of every class in this tree
+#endif
+
+#define VTABLE_BUCKET_OF_(hash) \
+    ((uint32_t)(((hash) ^ (uint32_t)(VTABLE_LOOKUP_SEED)) * 0x9E3779B1u) >> (32 - VTABLE_LOOKUP_BITS))
+
+// Same hash at run time; `len` is strlen(s)
+static inline uint32_t vtable_name_hash(const char* s, size_t len) {
+    size_t size = len + 1;
+#define VTABLE_RT_AT_(i) s[(i) < size ? (i) : size - 1]
+    uint32_t h = 2166136261u ^ (uint32_t)len;
+    h = VTABLE_HASH_STEP_(h, VTABLE_RT_AT_(0));
+    h = VTABLE_HASH_STEP_(h, VTABLE_RT_AT_(1));
+    h = VTABLE_HASH_STEP_(h, VTABLE_RT_AT_(2));
+    h = VTABLE_HASH_STEP_(h, VTABLE_RT_AT_(3));
+    h = VTABLE_HASH_STEP_(h, VTABLE_RT_AT_(len / 2));
+    h = VTABLE_HASH_STEP_(h, VTABLE_RT_AT_(size - 2));
+    h = VTABLE_HASH_STEP_(h, VTABLE_RT_AT_(size - 3));
+#undef VTABLE_RT_AT_
+    return h;
+}
+
+// ---- Iterating over ADD_METHOD lists ----
+//
+// ADD_METHOD(ClassName, MethodName) expands to the entry (1, ClassName, MethodName), and
+// VTABLE_EACH_(F, arg, ...) expands F(arg, entry) for each of up to VTABLE_MAX_LISTED entries.
+// An entry starting with 0 (Object_METHODS) stands for no method and expands to nothing.
+
+#define VTABLE_MAX_LISTED 32
+
+#define VTABLE_APPLY_(m, args) m args
+#define VTABLE_UNPACK_(listed, ClassName, MethodName) listed, ClassName, MethodName
+#define VTABLE_IF_(listed) VTABLE_CAT_(VTABLE_IF_, listed)
+#define VTABLE_IF_0(...)
+#define VTABLE_IF_1(...) __VA_ARGS__
+
+#define VTABLE_COUNT_(...) VTABLE_COUNT2_(__VA_ARGS__, \
+    32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, \
+    16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define VTABLE_COUNT2_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, \
+    _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, n, ...) n
+
+#define VTABLE_CAT_(a, b) VTABLE_CAT2_(a, b)
+#define VTABLE_CAT2_(a, b) a##b
+
+#define VTABLE_EACH_(F, arg, ...) VTABLE_CAT_(VTABLE_EACH_, VTABLE_COUNT_(__VA_ARGS__))(F, arg, __VA_ARGS__)
+#define VTABLE_EACH_1(F, a, x) F(a, x)
+#define VTABLE_EACH_2(F, a, x, ...) F(a, x) VTABLE_EACH_1(F, a, __VA_ARGS__)
+#define VTABLE_EACH_3(F, a, x, ...) F(a, x) VTABLE_EACH_2(F, a, __VA_ARGS__)
+#define VTABLE_EACH_4(F, a, x, ...) F(a, x) VTABLE_EACH_3(F, a, __VA_ARGS__)
+#define VTABLE_EACH_5(F, a, x, ...) F(a, x) VTABLE_EACH_4(F, a, __VA_ARGS__)
+#define VTABLE_EACH_6(F, a, x, ...) F(a, x) VTABLE_EACH_5(F, a, __VA_ARGS__)
+#define VTABLE_EACH_7(F, a, x, ...) F(a, x) VTABLE_EACH_6(F, a, __VA_ARGS__)
+#define VTABLE_EACH_8(F, a, x, ...) F(a, x) VTABLE_EACH_7(F, a, __VA_ARGS__)
+#define VTABLE_EACH_9(F, a, x, ...) F(a, x) VTABLE_EACH_8(F, a, __VA_ARGS__)
+#define VTABLE_EACH_10(F, a, x, ...) F(a, x) VTABLE_EACH_9(F, a, __VA_ARGS__)
+#define VTABLE_EACH_11(F, a, x, ...) F(a, x) VTABLE_EACH_10(F, a, __VA_ARGS__)
+#define VTABLE_EACH_12(F, a, x, ...) F(a, x) VTABLE_EACH_11(F, a, __VA_ARGS__)
+#define VTABLE_EACH_13(F, a, x, ...) F(a, x) VTABLE_EACH_12(F, a, __VA_ARGS__)
+#define VTABLE_EACH_14(F, a, x, ...) F(a, x) VTABLE_EACH_13(F, a, __VA_ARGS__)
+#define VTABLE_EACH_15(F, a, x, ...) F(a, x) VTABLE_EACH_14(F, a, __VA_ARGS__)
+#define VTABLE_EACH_16(F, a, x, ...) F(a, x) VTABLE_EACH_15(F, a, __VA_ARGS__)
+#define VTABLE_EACH_17(F, a, x, ...) F(a, x) VTABLE_EACH_16(F, a, __VA_ARGS__)
+#define VTABLE_EACH_18(F, a, x, ...) F(a, x) VTABLE_EACH_17(F, a, __VA_ARGS__)
+#define VTABLE_EACH_19(F, a, x, ...) F(a, x) VTABLE_EACH_18(F, a, __VA_ARGS__)
+#define VTABLE_EACH_20(F, a, x, ...) F(a, x) VTABLE_EACH_19(F, a, __VA_ARGS__)
+#define VTABLE_EACH_21(F, a, x, ...) F(a, x) VTABLE_EACH_20(F, a, __VA_ARGS__)
+#define VTABLE_EACH_22(F, a, x, ...) F(a, x) VTABLE_EACH_21(F, a, __VA_ARGS__)
+#define VTABLE_EACH_23(F, a, x, ...) F(a, x) VTABLE_EACH_22(F, a, __VA_ARGS__)
+#define VTABLE_EACH_24(F, a, x, ...) F(a, x) VTABLE_EACH_23(F, a, __VA_ARGS__)
+#define VTABLE_EACH_25(F, a, x, ...) F(a, x) VTABLE_EACH_24(F, a, __VA_ARGS__)
+#define VTABLE_EACH_26(F, a, x, ...) F(a, x) VTABLE_EACH_25(F, a, __VA_ARGS__)
+#define VTABLE_EACH_27(F, a, x, ...) F(a, x) VTABLE_EACH_26(F, a, __VA_ARGS__)
+#define VTABLE_EACH_28(F, a, x, ...) F(a, x) VTABLE_EACH_27(F, a, __VA_ARGS__)
+#define VTABLE_EACH_29(F, a, x, ...) F(a, x) VTABLE_EACH_28(F, a, __VA_ARGS__)
+#define VTABLE_EACH_30(F, a, x, ...) F(a, x) VTABLE_EACH_29(F, a, __VA_ARGS__)
+#define VTABLE_EACH_31(F, a, x, ...) F(a, x) VTABLE_EACH_30(F, a, __VA_ARGS__)
+#define VTABLE_EACH_32(F, a, x, ...) F(a, x) VTABLE_EACH_31(F, a, __VA_ARGS__)
+
+// One bucket of the lookup table: 1 + the slot of the first listed method hashing to it, or 0
+#define VTABLE_BUCKET_MATCH_(bucket, entry) VTABLE_APPLY_(VTABLE_BUCKET_MATCH2_, (bucket, VTABLE_UNPACK_ entry))
+#define VTABLE_BUCKET_MATCH2_(bucket, listed, ClassName, MethodName) VTABLE_IF_(listed)( \
+    VTABLE_BUCKET_OF_(VTABLE_NAME_HASH(#MethodName)) == (bucket) ? MethodName##_INDEX + 1 :)
+#define VTABLE_BUCKET_(bucket, ...) (VTABLE_EACH_(VTABLE_BUCKET_MATCH_, bucket, __VA_ARGS__) 0)
+
+// Bit n set for every listed method in slot n that hashes to `bucket`
+#define VTABLE_BUCKET_SLOTS_MATCH_(bucket, entry) \
+    VTABLE_APPLY_(VTABLE_BUCKET_SLOTS_MATCH2_, (bucket, VTABLE_UNPACK_ entry))
+#define VTABLE_BUCKET_SLOTS_MATCH2_(bucket, listed, ClassName, MethodName) VTABLE_IF_(listed)( \
+    (VTABLE_BUCKET_OF_(VTABLE_NAME_HASH(#MethodName)) == (bucket) ? 1ull << (MethodName##_INDEX % 64) : 0) |)
+#define VTABLE_BUCKET_SLOTS_(bucket, ...) (VTABLE_EACH_(VTABLE_BUCKET_SLOTS_MATCH_, bucket, __VA_ARGS__) 0ull)
+
+// Whether at most one slot hashes to `bucket`; entries for one slot (an override) share a name
+#define VTABLE_BUCKET_FREE_(bucket, ...) \
+    ((VTABLE_BUCKET_SLOTS_(bucket, __VA_ARGS__) & (VTABLE_BUCKET_SLOTS_(bucket, __VA_ARGS__) - 1)) == 0)
+
+#define VTABLE_BUCKETS_FREE_8_(base, ...) \
+    VTABLE_BUCKET_FREE_((base) + 0, __VA_ARGS__) && VTABLE_BUCKET_FREE_((base) + 1, __VA_ARGS__) && \
+    VTABLE_BUCKET_FREE_((base) + 2, __VA_ARGS__) && VTABLE_BUCKET_FREE_((base) + 3, __VA_ARGS__) && \
+    VTABLE_BUCKET_FREE_((base) + 4, __VA_ARGS__) && VTABLE_BUCKET_FREE_((base) + 5, __VA_ARGS__) && \
+    VTABLE_BUCKET_FREE_((base) + 6, __VA_ARGS__) && VTABLE_BUCKET_FREE_((base) + 7, __VA_ARGS__)
+
+// Constant expression: no two methods of an ADD_METHOD list share a lookup bucket
+#define VTABLE_LOOKUP_PERFECT_(...) ( \
+    VTABLE_BUCKETS_FREE_8_(0, __VA_ARGS__) && VTABLE_BUCKETS_FREE_8_(8, __VA_ARGS__) && \
+    VTABLE_BUCKETS_FREE_8_(16, __VA_ARGS__) && VTABLE_BUCKETS_FREE_8_(24, __VA_ARGS__) && \
+    VTABLE_BUCKETS_FREE_8_(32, __VA_ARGS__) && VTABLE_BUCKETS_FREE_8_(40, __VA_ARGS__) && \
+    VTABLE_BUCKETS_FREE_8_(48, __VA_ARGS__) && VTABLE_BUCKETS_FREE_8_(56, __VA_ARGS__))
+
+// The name hash indexes string literals, which C allows in a static initializer but not in a
+// _Static_assert, so INIT_CLASS checks VTABLE_LOOKUP_PERFECT_ in an initializer instead: a
+// collision leaves it reading this never-defined variable, and "initializer element is not
+// constant" names the class being initialized.
+extern const int VTABLE_LOOKUP_COLLISION_;
+
+// Constant expression: every slot of an ADD_METHOD list is below 64, as the check above needs
+#define VTABLE_SLOT_BELOW_64_(unused, entry) VTABLE_APPLY_(VTABLE_SLOT_BELOW_64_2_, (VTABLE_UNPACK_ entry))
+#define VTABLE_SLOT_BELOW_64_2_(listed, ClassName, MethodName) VTABLE_IF_(listed)((MethodName##_INDEX) < 64 &&)
+#define VTABLE_LOOKUP_SLOTS_OK_(...) (VTABLE_EACH_(VTABLE_SLOT_BELOW_64_, ~, __VA_ARGS__) 1)
+
+#define VTABLE_BUCKETS_8_(base, ...) \
+    VTABLE_BUCKET_((base) + 0, __VA_ARGS__), VTABLE_BUCKET_((base) + 1, __VA_ARGS__), \
+    VTABLE_BUCKET_((base) + 2, __VA_ARGS__), VTABLE_BUCKET_((base) + 3, __VA_ARGS__), \
+    VTABLE_BUCKET_((base) + 4, __VA_ARGS__), VTABLE_BUCKET_((base) + 5, __VA_ARGS__), \
+    VTABLE_BUCKET_((base) + 6, __VA_ARGS__), VTABLE_BUCKET_((base) + 7, __VA_ARGS__)
+
+// Initializer for a VTABLE_LOOKUP_BUCKETS-entry table over an ADD_METHOD list
+#define VTABLE_LOOKUP_TABLE_(...) { \
+    VTABLE_BUCKETS_8_(0, __VA_ARGS__), VTABLE_BUCKETS_8_(8, __VA_ARGS__), \
+    VTABLE_BUCKETS_8_(16, __VA_ARGS__), VTABLE_BUCKETS_8_(24, __VA_ARGS__), \
+    VTABLE_BUCKETS_8_(32, __VA_ARGS__), VTABLE_BUCKETS_8_(40, __VA_ARGS__), \
+    VTABLE_BUCKETS_8_(48, __VA_ARGS__), VTABLE_BUCKETS_8_(56, __VA_ARGS__) }
+
+// VTABLE_EACH_ bodies for the method and name arrays: designated by slot, so a later entry
+// for the same slot (an override) replaces an earlier one (the inherited method)
+#define VTABLE_METHOD_ENTRY_(unused, entry) VTABLE_APPLY_(VTABLE_METHOD_ENTRY2_, (VTABLE_UNPACK_ entry))
+#define VTABLE_METHOD_ENTRY2_(listed, ClassName, MethodName) \
+    VTABLE_IF_(listed)([MethodName##_INDEX] = (MethodPtr)ClassName##_##MethodName,)
+#define VTABLE_NAME_ENTRY_(unused, entry) VTABLE_APPLY_(VTABLE_NAME_ENTRY2_, (VTABLE_UNPACK_ entry))
+#define VTABLE_NAME_ENTRY2_(listed, ClassName, MethodName) VTABLE_IF_(listed)([MethodName##_INDEX] = #MethodName,)
+
+// Overriding an initialized element is the point of the tables above; keep the compiler quiet
+#if defined(__clang__)
+#define VTABLE_OVERRIDES_BEGIN_ \
+    _Pragma("clang diagnostic push") _Pragma("clang diagnostic ignored \"-Winitializer-overrides\"")
+#define VTABLE_OVERRIDES_END_ _Pragma("clang diagnostic pop")
+#elif defined(__GNUC__)
+#define VTABLE_OVERRIDES_BEGIN_ \
+    _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Woverride-init\"")
+#define VTABLE_OVERRIDES_END_ _Pragma("GCC diagnostic pop")
+#else
+#define VTABLE_OVERRIDES_BEGIN_
+#define VTABLE_OVERRIDES_END_
+#endif
+
+#endif // VTABLE_LOOKUP_H
@@ -0,0 +1,129 @@
+// Registry and reports for vtable_profile.h. Link this file into builds that use -DVTABLE_PROFILE.
+#include <stdlib.h>
+#include <string.h>
+
+#include "vtable_profile.h"
+
+_Thread_local VProfTable* vprof_table_;
+
+// Every thread's table, newest first; tables are never freed
+static _Atomic(VProfTable*) tables;
+
+// Absorbs calls once a thread's table is full (or failed to allocate); never reported
+static VProfSite overflow;
+
+VProfTable* vprof_register_(void) {
+    VProfTable* table = (VProfTable*)calloc(1, sizeof(VProfTable));
+    if (!table) return NULL;
+    table->next = atomic_load_explicit(&tables, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&tables, &table->next, table,
+                                                  memory_order_release, memory_order_relaxed)) {
+    }
+    vprof_table_ = table;
+    return table;
+}
+
+VProfSite* vprof_overflow_(void) {
+    return &overflow;
+}
+
+const char* vprof_tick_unit(void) {
+    return VPROF_TICK_UNIT;
+}
+
+static size_t find_stats(VProfStats* out, size_t n, const VTable* vtable, size_t method) {
+    for (size_t i = 0; i < n; i++) {
+        if (out[i].vtable == vtable && out[i].method == method) return i;
+    }
+    return n;
+}
+
+size_t vprof_collect(VProfStats* out, size_t max) {
+    // Merge into a scratch list holding every site, then copy out the first `max`
+    size_t n = 0, capacity = 0;
+    VProfStats* all = NULL;
+    for (VProfTable* t = atomic_load_explicit(&tables, memory_order_acquire); t; t = t->next) {
+        for (size_t s = 0; s < VPROF_SITES; s++) {
+            VProfSite* site = &t->sites[s];
+            const VTable* vtable = atomic_load_explicit(&site->vtable, memory_order_acquire);
+            if (!vtable) continue;
+            size_t i = find_stats(all, n, vtable, site->method);
+            if (i == n) {
+                if (n == capacity) {
+                    size_t grown = capacity ? capacity * 2 : 64;
+                    VProfStats* p = (VProfStats*)realloc(all, grown * sizeof(VProfStats));
+                    if (!p) {
+                        free(all);
+                        return 0;
+                    }
+                    all = p;
+                    capacity = grown;
+                }
+                memset(&all[n], 0, sizeof(VProfStats));
+                all[n].vtable = vtable;
+                all[n].className = vtable->className;
+                all[n].method = site->method;
+                n++;
+            }
+            all[i].calls += atomic_load_explicit(&site->calls, memory_order_relaxed);
+            all[i].ticks += atomic_load_explicit(&site->ticks, memory_order_relaxed);
+            for (int b = 0; b < VPROF_BUCKETS; b++) {
+                all[i].histogram[b] += atomic_load_explicit(&site->histogram[b], memory_order_relaxed);
+            }
+        }
+    }
+    if (out && n) memcpy(out, all, (n < max ? n : max) * sizeof(VProfStats));
+    free(all);
+    return n;
+}
+
+// Upper bound of the histogram bucket holding the q-th quantile call
+static uint64_t bucket_quantile(const VProfStats* s, double q) {
+    if (!s->calls) return 0;
+    uint64_t want = (uint64_t)(q * (double)s->calls + 0.5), seen = 0;
+    for (int b = 0; b < VPROF_BUCKETS; b++) {
+        seen += s->histogram[b];
+        if (seen >= want && seen) return b ? (uint64_t)1 << b : 0;
+    }
+    return (uint64_t)1 << (VPROF_BUCKETS - 1);
+}
+
+int vprof_report(FILE* f) {
+    size_t n = vprof_collect(NULL, 0);
+    VProfStats* stats = (VProfStats*)malloc((n ? n : 1) * sizeof(VProfStats));
+    if (!stats) return -1;
+    // Sites registered since the first pass are left for the next report
+    n = vprof_collect(stats, n);
+    int rc = 0;
+    for (size_t i = 0; i < n && rc == 0; i++) {
+        const VProfStats* s = &stats[i];
+        if (fprintf(f, "{\"class\":\"%s\",\"method\":%zu,\"calls\":%llu,\"ticks\":%llu,\"unit\":\"%s\","
+                       "\"p50\":%llu,\"p99\":%llu,\"histogram\":[",
+                    s->className, s->method, (unsigned long long)s->calls, (unsigned long long)s->ticks,
+                    VPROF_TICK_UNIT, (unsigned long long)bucket_quantile(s, 0.50),
+                    (unsigned long long)bucket_quantile(s, 0.99)) < 0) {
+            rc = -1;
+        }
+        int last = VPROF_BUCKETS - 1;
+        while (last > 0 && !s->histogram[last]) last--;
+        for (int b = 0; b <= last && rc == 0; b++) {
+            if (fprintf(f, "%s%llu", b ? "," : "", (unsigned long long)s->histogram[b]) < 0) rc = -1;
+        }
+        if (rc == 0 && fputs("]}\n", f) < 0) rc = -1;
+    }
+    free(stats);
+    return rc;
+}
+
+void vprof_reset(void) {
+    for (VProfTable* t = atomic_load_explicit(&tables, memory_order_acquire); t; t = t->next) {
+        for (size_t s = 0; s < VPROF_SITES; s++) {
+            VProfSite* site = &t->sites[s];
+            atomic_store_explicit(&site->calls, 0, memory_order_relaxed);
+            atomic_store_explicit(&site->ticks, 0, memory_order_relaxed);
+            for (int b = 0; b < VPROF_BUCKETS; b++) {
+                atomic_store_explicit(&site->histogram[b], 0, memory_order_relaxed);
+            }
+        }
+    }
+}
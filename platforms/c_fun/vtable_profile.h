@@ -0,0 +1,127 @@
+#ifndef VTABLE_PROFILE_H
+#define VTABLE_PROFILE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "vtable.h"
+
+// Call-site profiling for vtable.h, enabled by building with -DVTABLE_PROFILE and linking
+// vtable_profile.c. Every CALL, CALL_AS and CALL_STATIC then counts the call and its latency
+// in ticks (the TSC on x86, the virtual counter on aarch64, nanoseconds elsewhere) into a
+// log2 histogram for its (class, method slot). Without the flag nothing here is compiled in.
+//
+// Counters live in a table per thread, so recording takes no locks and shares no cache lines.
+// Each thread's table is registered once, on its first call, and kept after the thread exits
+// so its calls still show up in reports. vprof_collect() merges all tables per site.
+
+#define VPROF_SITES 1024   // Distinct (class, method) pairs tracked per thread
+#define VPROF_BUCKETS 48   // Bucket b counts calls that took [2^(b-1), 2^b) ticks; bucket 0 is 0
+
+typedef struct {
+    _Atomic(const VTable*) vtable;  // NULL while the slot is free; published last
+    size_t method;
+    _Atomic uint64_t calls;
+    _Atomic uint64_t ticks;
+    _Atomic uint64_t histogram[VPROF_BUCKETS];
+} VProfSite;
+
+typedef struct VProfTable {
+    struct VProfTable* next;
+    VProfSite sites[VPROF_SITES];
+} VProfTable;
+
+// Merged counters for one (class, method) pair
+typedef struct {
+    const VTable* vtable;
+    const char* className;
+    size_t method;  // Slot index, as in MethodName_INDEX
+    uint64_t calls;
+    uint64_t ticks;
+    uint64_t histogram[VPROF_BUCKETS];
+} VProfStats;
+
+extern _Thread_local VProfTable* vprof_table_;
+VProfTable* vprof_register_(void);
+VProfSite* vprof_overflow_(void);
+
+// Fill up to `max` entries of `out` with every site seen by any thread, merged; returns the
+// number of sites, which may exceed `max`
+size_t vprof_collect(VProfStats* out, size_t max);
+
+// Write one JSON object per site to `f`; returns 0, or -1 on a write or allocation error
+int vprof_report(FILE* f);
+
+// Zero every counter (sites stay registered). Calls racing with a reset may be half-counted.
+void vprof_reset(void);
+
+// What one tick is: "tsc", "cntvct" or "ns"
+const char* vprof_tick_unit(void);
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t vprof_now(void) { return __rdtsc(); }
+#define VPROF_TICK_UNIT "tsc"
+#elif defined(__aarch64__)
+static inline uint64_t vprof_now(void) {
+    uint64_t t;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+}
+#define VPROF_TICK_UNIT "cntvct"
+#else
+#include <time.h>
+static inline uint64_t vprof_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+#define VPROF_TICK_UNIT "ns"
+#endif
+
+// This thread's counters for (vtable, method), claimed on first use
+static inline VProfSite* vprof_site(const VTable* vtable, size_t method) {
+    VProfTable* table = vprof_table_ ? vprof_table_ : vprof_register_();
+    if (!table) return vprof_overflow_();
+    size_t h = (((uintptr_t)vtable >> 4) * 31 + method) * 0x9E3779B97F4A7C15ull >> 7;
+    for (size_t probe = 0; probe < VPROF_SITES; probe++) {
+        VProfSite* site = &table->sites[(h + probe) % VPROF_SITES];
+        const VTable* owner = atomic_load_explicit(&site->vtable, memory_order_relaxed);
+        if (owner == vtable && site->method == method) return site;
+        if (!owner) {
+            site->method = method;
+            atomic_store_explicit(&site->vtable, vtable, memory_order_release);
+            return site;
+        }
+    }
+    return vprof_overflow_();
+}
+
+// Only this thread writes its sites, so plain load/store (no locked RMW) is enough
+#define VPROF_BUMP_(counter, by) \
+    atomic_store_explicit(&(counter), atomic_load_explicit(&(counter), memory_order_relaxed) + (by), \
+                          memory_order_relaxed)
+
+typedef struct {
+    VProfSite* site;
+    uint64_t start;
+} VProfScope;
+
+static inline void vprof_scope_end(VProfScope* scope) {
+    uint64_t ticks = vprof_now() - scope->start;
+    VProfSite* site = scope->site;
+    unsigned bucket = ticks ? 64u - (unsigned)__builtin_clzll(ticks) : 0u;
+    if (bucket >= VPROF_BUCKETS) bucket = VPROF_BUCKETS - 1;
+    VPROF_BUMP_(site->calls, 1);
+    VPROF_BUMP_(site->ticks, ticks);
+    VPROF_BUMP_(site->histogram[bucket], 1);
+}
+
+// Times the rest of the enclosing block (the CALL statement expression) against the site
+#define VPROF_SCOPE(vtable, method) \
+    __attribute__((cleanup(vprof_scope_end))) VProfScope _vprofScope = { vprof_site((vtable), (method)), 0 }; \
+    _vprofScope.start = vprof_now()
+
+#endif // VTABLE_PROFILE_H